@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "bjson_enc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Batch encoding: many independent documents spread over worker threads
+ * (FreeRTOS tasks pinned to the cores in turn on ESP-IDF, pthreads on a
+ * host); the calling thread is worker 0. Workers claim the next item
+ * from a shared counter, so one large document does not hold up the
+ * small ones queued behind it. Each worker encodes through its own
+ * context; passing the same contexts again reuses their grown arenas.
+ *
+ * The encoders keep no global state. Keys are classified as plain ASCII
+ * (no <ctype.h> locale tables); the only locale-dependent call left is
+ * strtod/strtof for numbers the fast path cannot round, which expects
+ * the "C" decimal point (the only one newlib has; host programs must not
+ * switch LC_NUMERIC while encoding).
+ */
+
+/** Most worker threads bjson_encode_batch starts (calling thread included). */
+#define BJSON_BATCH_THREADS_MAX 8
+#ifndef BJSON_BATCH_STACK
+#define BJSON_BATCH_STACK 6144   /**< worker task stack in bytes (ESP-IDF) */
+#endif
+
+/** One document of a batch. */
+typedef struct {
+  const char* json;          // in: NUL-terminated JSON text
+  uint8_t* out; size_t cap;  // in: output buffer
+  size_t len;                // out: encoded length
+  bjson_err_t err;           // out: result of this document
+} bjson_batch_item_t;
+
+/**
+ * Encode `n` documents with up to `nthreads` workers. `ctx` is an array
+ * of `nthreads` contexts (bjson_enc_ctx_init), or NULL for temporary
+ * heap-backed ones. Returns the error of the first failing item.
+ */
+bjson_err_t bjson_encode_batch(bjson_batch_item_t* items, size_t n, const bjson_enc_opts_t* opts,
+                               bjson_enc_ctx_t* ctx, int nthreads);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "bjson.h"
+#include "bjson_enc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Conversion between the aligned profile (what the encoders write) and
+ * the compact wire profile (BJD_F_COMPACT: varint lengths, no padding,
+ * no reserve). Both walk the source once; bjd_* reads either form.
+ *
+ * bjson_compact keeps BJD_F_CRC, BJD_F_DICT (same key IDs and hash),
+ * BJD_F_SREF (string back-references) and BJD_F_CPLIMIT, drops the key index and the
+ * string reserve. bjson_expand writes what the encoder would have written
+ * with `flags` (BJSON_ENC_F_INDEX, _CRC, _RESERVE, _DEDUP); a BJD_F_DICT
+ * source stays a BJD_F_DICT document, a BJD_F_CPLIMIT one BJD_F_CPLIMIT. With
+ * _RESERVE, strings of a compact source get the STR_N limit of their
+ * key, which needs the dictionary attached (bjd_use_dict) for key IDs.
+ */
+
+/** Write `doc` (a bjd_open root, either profile) in the compact profile. */
+bjson_err_t bjson_compact(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len);
+/** Write `doc` (a bjd_open root, either profile) in the aligned profile with encoder `flags`. */
+bjson_err_t bjson_expand(const bjd_doc_t* doc, uint32_t flags, uint8_t* out, size_t cap, size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
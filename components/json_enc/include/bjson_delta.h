@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "bjson.h"
+#include "bjson_enc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Delta between two BJSON documents, itself a BJSON document (CRC
+ * trailer, readable with bjd_open / bjd_validate / bjd_to_json):
+ *
+ *   UINT16_FLAGS     header flags of the new document
+ *   UINT32_BASE      bjd_crc32 of the old document (without its CRC trailer)
+ *   del { K:{} ...}  old entries to drop, in old order (K:[] for ARR_ keys)
+ *   set { K:v  ...}  old entries replaced by the new entry K, in old order
+ *   sub { K:{del,set,sub,add} ...}  objects patched recursively, in old order
+ *   add { K:v  ...}  new entries, in new order
+ *   ARR_UINT32_AT    per add entry, the old entry index it goes before
+ *                    (absent: every add is appended after the old entries)
+ *
+ * Unchanged entries are not in the patch; empty sections are left out.
+ * Entries are addressed by key, so a level where a patched key occurs
+ * twice in the old document falls back to dropping and re-adding all of
+ * its entries. Between BJD_F_DICT documents the patch uses the same key
+ * IDs and carries the dictionary hash. `old` and `nw` must be aligned
+ * documents; the patch itself may be compacted (bjson_compact).
+ */
+
+/** Build the patch turning `old` into `nw` (`out` gets a CRC-checked BJSON document). */
+bjson_err_t bjson_diff(const bjd_doc_t* old, const bjd_doc_t* nw, uint8_t* out, size_t cap, size_t* len);
+/** Apply a bjson_diff patch to `old` in one pass; `out` gets the new document byte for byte. */
+bjson_err_t bjson_patch(const bjd_doc_t* old, const bjd_doc_t* patch, uint8_t* out, size_t cap, size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
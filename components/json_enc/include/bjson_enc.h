@@ -12,11 +12,147 @@ typedef enum {
   BJSON_EBUF, 
   BJSON_ESYNTAX, 
   BJSON_ETYPE, 
-  BJSON_ERANGE
+  BJSON_ERANGE,
+  BJSON_ENOMEM,        // encoder arena exhausted and could not grow
+  BJSON_EUTF8          // malformed UTF-8 in a key or string (BJSON_ENC_F_UTF8)
 } bjson_err_t;
 
+/** Encoder option flags (`bjson_enc_opts_t.flags`). */
+#define BJSON_ENC_F_INDEX   0x0001u  /**< append a hashed key index section (BJD_F_INDEX) */
+#define BJSON_ENC_F_DIRECT  0x0002u  /**< single pass: write entries while parsing, no AST/arena */
+#define BJSON_ENC_F_CRC     0x0004u  /**< append a CRC-32 trailer (BJD_F_CRC) checked by bjd_validate */
+#define BJSON_ENC_F_RESERVE 0x0008u  /**< reserve the full STR_N bytes per string for bjd_set_str (BJD_F_RESERVE) */
+#define BJSON_ENC_F_UTF8    0x0010u  /**< strict: keys and strings must be well-formed UTF-8 (else BJSON_EUTF8) */
+#define BJSON_ENC_F_CPLIMIT 0x0020u  /**< STR_N counts code points, not bytes (implies BJSON_ENC_F_UTF8) */
+#define BJSON_ENC_F_DEDUP   0x0040u  /**< repeated strings become back-references (BJD_F_SREF); ignored with BJSON_ENC_F_RESERVE */
+
+struct bjd_dict_s;
+
+typedef struct {
+  uint32_t flags;      // BJSON_ENC_F_*
+  const struct bjd_dict_s* dict;  // store listed keys as key IDs (BJD_F_DICT), NULL = off
+} bjson_enc_opts_t;
+
+/** Optional allocator hooks used to grow an encoder arena in chunks. */
+typedef struct {
+  void* (*alloc)(size_t n, void* user);
+  void  (*free)(void* p, void* user);
+  void*  user;
+  size_t chunk;        // minimum bytes per grown chunk (0 = 4096)
+} bjson_alloc_t;
+
+typedef struct bjson_arena_chunk_s {
+  struct bjson_arena_chunk_s* next;
+  size_t cap;
+} bjson_arena_chunk_t;
+
+/**
+ * Reusable encoder context. The arena starts in the caller-supplied block
+ * (static RAM, PSRAM, ...) and, when allocator hooks are given, continues
+ * into grown chunks that are kept for the next call. After warm-up,
+ * repeated encodes do no heap traffic. Fields are private except the
+ * statistics.
+ */
+typedef struct {
+  uint8_t* base; size_t cap;          // caller block, may be NULL/0
+  bjson_alloc_t al;                   // al.alloc == NULL: no growth
+  bjson_arena_chunk_t* chunks;        // grown chunks, kept across calls
+  bjson_arena_chunk_t* cur_chunk;     // NULL while allocating from `base`
+  uint8_t* blk; size_t blk_cap, blk_used;
+  size_t used;                        // arena bytes used by the last encode
+  size_t high_water;                  // max `used` over all encodes
+  size_t grown;                       // total bytes obtained from al.alloc
+} bjson_enc_ctx_t;
+
+/** Deepest container nesting accepted by the encoders (root object = 0). */
+#define BJSON_ENC_DEPTH_MAX 16
+
+/** Recent string values remembered for back-references (power of two). */
+#define BJSON_ENC_DEDUP_SLOTS 64
+
+/**
+ * String values seen so far (BJSON_ENC_F_DEDUP; fields are private). One
+ * value per slot, the newest wins: a repeat whose slot was taken since is
+ * stored in full again, which costs size but never correctness.
+ */
+typedef struct {
+  uint32_t hash[BJSON_ENC_DEDUP_SLOTS];
+  uint32_t off[BJSON_ENC_DEDUP_SLOTS];    // value offset in the document, 0: empty
+  uint16_t len[BJSON_ENC_DEDUP_SLOTS];
+} bjson_dedup_t;
+
+/** BJSON writer state shared by the encoders (internal; fields are private). */
+typedef struct {
+  uint8_t* out; uint8_t* cur; uint8_t* end;   // cur = start of the next entry
+  uint32_t flags;
+  const struct bjd_dict_s* dict;              // emit_dict: key IDs for listed keys
+  uint8_t  hdr;                               // header size (first entry offset)
+  uint32_t count;                             // entries in the innermost open container
+  uint8_t  depth;                             // open containers
+  uint32_t open[BJSON_ENC_DEPTH_MAX];         // entry offset of each open container
+  uint32_t saved[BJSON_ENC_DEPTH_MAX];        // parent's count while a child is open
+  bjson_dedup_t dd;                           // BJSON_ENC_F_DEDUP only
+} bjson_emit_t;
+
+/** Longest value token accepted for fixed-size types (numbers, bools). */
+#define BJSON_ENC_TOKEN_MAX 64
+
+/**
+ * Resumable push encoder state for bjson_enc_begin/feed/end (fields are
+ * private). Holds no input: keys and string values are written straight
+ * into the output buffer, so RAM use does not depend on the input size.
+ */
+typedef struct {
+  bjson_emit_t em;
+  uint8_t  st;         // parser state
+  uint8_t  esc;        // inside an escape: 1 after '\\', 2 in \uXXXX, 3/4 before the low surrogate's "\u"
+  uint8_t  nhex;       // \uXXXX digits so far
+  uint16_t hi;         // pending high surrogate
+  uint16_t cp;         // \uXXXX value so far
+  uint8_t  type;       // classified value type of the pending entry
+  uint8_t  nnum;
+  uint16_t nlen;
+  uint16_t param;      // STR_N limit or FIX scale of the pending entry
+  uint32_t vlen;       // string bytes / packed elements so far
+  char     num[BJSON_ENC_TOKEN_MAX];  // pending value token
+  bjson_err_t err;     // sticky error
+} bjson_enc_stream_t;
+
 /** JSON(관용 허용) 텍스트 → BJSON 바이너리 */
 bjson_err_t bjson_encode_from_json(const char* json, uint8_t* out, size_t out_cap, size_t* out_len);
+/** Same as bjson_encode_from_json with explicit options (`opts` may be NULL). */
+bjson_err_t bjson_encode_from_json_ex(const char* json, const bjson_enc_opts_t* opts,
+                                      uint8_t* out, size_t out_cap, size_t* out_len);
+
+/**
+ * Context-based encoding. `arena`/`arena_cap` may be NULL/0 when `al`
+ * provides allocator hooks; `al` may be NULL for a fixed arena.
+ */
+void        bjson_enc_ctx_init(bjson_enc_ctx_t* ctx, void* arena, size_t arena_cap, const bjson_alloc_t* al);
+bjson_err_t bjson_encode_ctx(bjson_enc_ctx_t* ctx, const char* json, const bjson_enc_opts_t* opts,
+                             uint8_t* out, size_t out_cap, size_t* out_len);
+void        bjson_enc_ctx_release(bjson_enc_ctx_t* ctx);   // frees grown chunks
+
+/**
+ * Chunked encoding: begin, feed the text in pieces split anywhere (even
+ * inside a token), then end. Produces the same bytes as
+ * bjson_encode_from_json_ex on the concatenated input.
+ */
+bjson_err_t bjson_enc_begin(bjson_enc_stream_t* s, const bjson_enc_opts_t* opts, uint8_t* out, size_t out_cap);
+bjson_err_t bjson_enc_feed(bjson_enc_stream_t* s, const char* chunk, size_t n);
+bjson_err_t bjson_enc_end(bjson_enc_stream_t* s, size_t* out_len);
+
+/**
+ * Binary inputs: one CBOR (RFC 8949) or MessagePack map encoded straight
+ * into BJSON in a single pass, without a JSON text hop and without
+ * allocating. Keys follow the JSON key rules; values get the same type
+ * and range checks as their text tokens (docs/bjson_format.md).
+ * BJSON_ENC_F_DIRECT is implied.
+ */
+bjson_err_t bjson_encode_from_cbor(const uint8_t* in, size_t n, const bjson_enc_opts_t* opts,
+                                   uint8_t* out, size_t out_cap, size_t* out_len);
+bjson_err_t bjson_encode_from_msgpack(const uint8_t* in, size_t n, const bjson_enc_opts_t* opts,
+                                      uint8_t* out, size_t out_cap, size_t* out_len);
 
 #ifdef __cplusplus
 }
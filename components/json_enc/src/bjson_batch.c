@@ -0,0 +1,120 @@
+#include "bjson_batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#endif
+
+/** Shared batch state; `next` is the only field written by the workers. */
+typedef struct {
+  bjson_batch_item_t* items; size_t n;
+  const bjson_enc_opts_t* opts;
+  size_t next;               // next unclaimed item (atomic)
+#ifdef ESP_PLATFORM
+  SemaphoreHandle_t done;    // given once by every started task
+#endif
+} batch_t;
+
+typedef struct {
+  batch_t* b;
+  bjson_enc_ctx_t* ctx;
+#ifndef ESP_PLATFORM
+  pthread_t th;
+#endif
+} worker_t;
+
+static void* std_alloc(size_t n, void* user){ (void)user; return malloc(n); }
+static void  std_free(void* p, void* user){ (void)user; free(p); }
+
+/**
+ * @brief Worker loop: claim items until none are left.
+ *
+ * Items are claimed one at a time. A relaxed counter is enough: results
+ * are read by the caller only after the task/thread join.
+ *
+ * @param b Batch.
+ * @param ctx This worker's encoder context.
+ */
+static void run(batch_t* b, bjson_enc_ctx_t* ctx){
+  size_t i;
+  while ((i = __atomic_fetch_add(&b->next, 1, __ATOMIC_RELAXED)) < b->n){
+    bjson_batch_item_t* it = &b->items[i];
+    it->len = 0;
+    it->err = bjson_encode_ctx(ctx, it->json, b->opts, it->out, it->cap, &it->len);
+  }
+}
+
+#ifdef ESP_PLATFORM
+static void worker_task(void* arg){
+  worker_t* w = (worker_t*)arg;
+  run(w->b, w->ctx);
+  xSemaphoreGive(w->b->done);
+  vTaskDelete(NULL);
+}
+
+/** @brief Start worker `k` (>= 1) on the core after the caller's, in turn. */
+static int start(worker_t* w, int k){
+  BaseType_t core = (BaseType_t)((xPortGetCoreID() + k) % portNUM_PROCESSORS);
+  return xTaskCreatePinnedToCore(worker_task, "bjson_enc", BJSON_BATCH_STACK, w, uxTaskPriorityGet(NULL), NULL, core) == pdPASS;
+}
+#else
+static void* worker_thread(void* arg){
+  worker_t* w = (worker_t*)arg;
+  run(w->b, w->ctx);
+  return NULL;
+}
+
+static int start(worker_t* w, int k){ (void)k; return pthread_create(&w->th, NULL, worker_thread, w) == 0; }
+#endif
+
+/**
+ * @brief Encode a batch of documents on several cores.
+ *
+ * Every item gets its own result (`len`, `err`); outputs are the same
+ * bytes bjson_encode_ctx produces for each document alone. A worker
+ * that cannot be started is skipped, the others take over its share.
+ *
+ * @param items Documents (json, out, cap in; len, err out).
+ * @param n Number of items.
+ * @param opts Encoder options for every item, may be NULL.
+ * @param ctx `nthreads` contexts, ctx[k] used by worker k (reused
+ *            arenas), or NULL for temporary heap-backed ones.
+ * @param nthreads Workers including the calling thread, 1..BJSON_BATCH_THREADS_MAX
+ *                 (fewer are started when there are fewer items).
+ * @return BJSON_OK when every item encoded, the `err` of the first failing
+ *         item otherwise, BJSON_EINVAL on bad arguments.
+ */
+bjson_err_t bjson_encode_batch(bjson_batch_item_t* items, size_t n, const bjson_enc_opts_t* opts,
+                               bjson_enc_ctx_t* ctx, int nthreads){
+  if ((!items && n) || nthreads < 1 || nthreads > BJSON_BATCH_THREADS_MAX) return BJSON_EINVAL;
+  bjson_enc_ctx_t own[BJSON_BATCH_THREADS_MAX];
+  worker_t w[BJSON_BATCH_THREADS_MAX];
+  batch_t b = { items, n, opts, 0 };
+  int nw = (size_t)nthreads < n ? nthreads : (int)(n ? n : 1);
+  if (!ctx){
+    bjson_alloc_t al = { std_alloc, std_free, NULL, 0 };
+    for (int k=0; k<nw; k++) bjson_enc_ctx_init(&own[k], NULL, 0, &al);
+  }
+#ifdef ESP_PLATFORM
+  StaticSemaphore_t sem;
+  b.done = xSemaphoreCreateCountingStatic(BJSON_BATCH_THREADS_MAX, 0, &sem);
+#endif
+  uint8_t up[BJSON_BATCH_THREADS_MAX] = {0};
+  for (int k=0; k<nw; k++){ w[k].b = &b; w[k].ctx = ctx ? &ctx[k] : &own[k]; }
+  for (int k=1; k<nw; k++) up[k] = (uint8_t)start(&w[k], k);
+  run(&b, w[0].ctx);   // the caller is worker 0
+#ifdef ESP_PLATFORM
+  for (int k=1; k<nw; k++) if (up[k]) xSemaphoreTake(b.done, portMAX_DELAY);
+  vSemaphoreDelete(b.done);
+#else
+  for (int k=1; k<nw; k++) if (up[k]) pthread_join(w[k].th, NULL);
+#endif
+  if (!ctx) for (int k=0; k<nw; k++) bjson_enc_ctx_release(&own[k]);
+  for (size_t i=0; i<n; i++) if (items[i].err != BJSON_OK) return items[i].err;
+  return BJSON_OK;
+}
@@ -0,0 +1,192 @@
+#include "bjson_compact.h"
+#include "bjson_enc_internal.h"
+#include <string.h>
+
+/*
+ * bjson_compact / bjson_expand. Compacting copies names and values
+ * as they are and only rewrites the framing: a container's length is
+ * known once its children are written, so they go after a 5-byte gap
+ * (the longest varint) and are moved back over the unused part. An
+ * aligned source never needs more room than its own length. Expanding
+ * re-emits every entry through the encoder's writer (emit_copy), so
+ * the output is the byte image the encoder produces for the same JSON.
+ *
+ * A BJD_F_SREF source comes out with its strings deduplicated again
+ * against the compact output (the same decisions as the encoder, which
+ * saw the same strings in the same order). Moving a container's children
+ * back also moves the strings they hold, so the references and
+ * remembered offsets into the moved bytes are shifted with them.
+ */
+
+/** Compact writer state. */
+typedef struct {
+  uint8_t* out; uint8_t* cur; uint8_t* end;
+  bjson_dedup_t* dd;   // BJD_F_SREF source, else NULL
+} cw_t;
+
+static int varint_len(uint32_t v){ int n=1; while (v >= 0x80){ v >>= 7; n++; } return n; }
+
+static int put_varint(uint8_t* p, uint32_t v){
+  int n=0;
+  while (v >= 0x80){ p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+/** @brief Root document check (bjson_compact/bjson_expand do not take bjd_enter views). */
+static int is_root(const bjd_doc_t* d){
+  size_t hdr = (d->flags & BJD_F_DICT) ? BJD_DICT_HDR_SIZE : BJD_HDR_SIZE;
+  return d->len >= hdr && d->entries == d->base + hdr;
+}
+
+static const uint8_t* take_varint(const uint8_t* p, uint32_t* v){
+  uint32_t x = 0; unsigned sh = 0;
+  do { x |= (uint32_t)(*p & 0x7F) << sh; sh += 7; } while (*p++ & 0x80);
+  *v = x;
+  return p;
+}
+
+static uint32_t rd32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+/**
+ * @brief Shift back-references at or past `from` down by `d`, in `n` entries just written.
+ *
+ * @param p First entry (compact layout, produced by put_ent).
+ * @param n Number of entries.
+ * @param from Document offset where the moved bytes started.
+ * @param d Distance they moved back.
+ */
+static void shift_refs(uint8_t* p, uint32_t n, uint32_t from, uint32_t d){
+  while (n--){
+    uint32_t vlen, cnt;
+    uint8_t* val = (uint8_t*)take_varint(p + 2 + p[1], &vlen);
+    if (p[0] == BJD_T_SREF){ uint32_t t = rd32(val); if (t >= from) enc_put_le(val, 4, t - d); }
+    else if (p[0] == BJD_T_OBJ || p[0] == BJD_T_ARR){
+      uint8_t* c = (uint8_t*)take_varint(val, &cnt);
+      shift_refs(c, cnt, from, d);
+    }
+    p = val + vlen;
+  }
+}
+
+static int put_level(cw_t* w, const bjd_doc_t* d, int depth);
+
+/**
+ * @brief Write one entry (and its children) in the compact profile.
+ *
+ * @param w Writer state.
+ * @param s Source entry.
+ * @param depth Nesting depth of `s`.
+ * @return 1 on success, 0 if it does not fit, -1 if the source is corrupt
+ *         or nests deeper than BJSON_ENC_DEPTH_MAX.
+ */
+static int put_ent(cw_t* w, const bjd_entry_t* s, int depth){
+  if ((size_t)(w->end - w->cur) < 2u + s->name_len) return 0;
+  w->cur[0] = (uint8_t)s->type; w->cur[1] = s->name_len;
+  memcpy(w->cur+2, s->name, s->name_len);
+  w->cur += 2 + s->name_len;
+  if (s->type == BJD_T_OBJ || s->type == BJD_T_ARR){
+    bjd_doc_t sub;
+    if (depth >= BJSON_ENC_DEPTH_MAX || bjd_enter(s, &sub) != BJD_OK) return -1;
+    if (w->end - w->cur < 5 || (size_t)(w->end - w->cur - 5) < (size_t)varint_len(sub.count)) return 0;
+    uint8_t* at = w->cur;
+    w->cur = at + 5;
+    w->cur += put_varint(w->cur, sub.count);
+    int r = put_level(w, &sub, depth+1);
+    if (r <= 0) return r;
+    uint32_t vlen = (uint32_t)(w->cur - (at + 5));
+    int k = put_varint(at, vlen);   // k <= 5: the value moves back over the rest of the gap
+    memmove(at + k, at + 5, vlen);
+    w->cur = at + k + vlen;
+    if (w->dd && k < 5){
+      uint32_t from = (uint32_t)(at + 5 - w->out), dist = (uint32_t)(5 - k);
+      shift_refs(at + k + varint_len(sub.count), sub.count, from, dist);
+      for (int i=0;i<BJSON_ENC_DEDUP_SLOTS;i++) if (w->dd->off[i] >= from) w->dd->off[i] -= dist;
+    }
+    return 1;
+  }
+  const uint8_t* v = s->val; uint32_t n = s->val_len; uint8_t ref[8];
+  if (w->dd && s->type == BJD_T_STR && n >= ENC_SREF_MIN){
+    uint32_t off = enc_dedup(w->dd, w->out, v, n, (uint32_t)(w->cur + varint_len(n) - w->out));
+    if (off){ w->cur[-2 - (int)s->name_len] = BJD_T_SREF; enc_put_le(ref, 4, off); enc_put_le(ref+4, 4, n); v = ref; n = 8; }
+  }
+  int k = varint_len(n);
+  if (w->end - w->cur < k || (size_t)(w->end - w->cur - k) < n) return 0;
+  w->cur += put_varint(w->cur, n);
+  if (n) memcpy(w->cur, v, n);
+  w->cur += n;
+  return 1;
+}
+
+static int put_level(cw_t* w, const bjd_doc_t* d, int depth){
+  bjd_iter_t it; bjd_entry_t e; int r;
+  bjd_iter_init(&it, d);
+  while ((r = bjd_iter_next(&it, &e)) > 0) if ((r = put_ent(w, &e, depth)) <= 0) return r;
+  return r < 0 ? -1 : 1;
+}
+
+/**
+ * @brief Write `doc` in the compact profile (BJD_F_COMPACT).
+ *
+ * Names (key IDs included), values and the entry order are kept; the
+ * header keeps BJD_F_CRC (new trailer) and BJD_F_DICT (same hash), the
+ * key index and string reserve are dropped, BJD_F_SREF is kept (strings
+ * deduplicated again), and so is BJD_F_CPLIMIT. `cap >= doc->len` always suffices for an aligned
+ * source written by the encoder.
+ *
+ * @param doc Root document (bjd_open; bjd_validate it first if untrusted).
+ * @param out Output buffer.
+ * @param cap Capacity of `out`.
+ * @param len[out] Compact document length on success.
+ * @return BJSON_OK, BJSON_EBUF if `out` is too small, BJSON_EINVAL on bad
+ *         arguments or corrupt input.
+ */
+bjson_err_t bjson_compact(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len){
+  if (!doc || !out || !len || !is_root(doc)) return BJSON_EINVAL;
+  size_t hdr = (size_t)(doc->entries - doc->base);
+  if (cap < hdr) return BJSON_EBUF;
+  memcpy(out, doc->base, hdr);   // magic, version, count (and dictionary hash)
+  uint16_t flags = (uint16_t)((doc->flags & (BJD_F_CRC | BJD_F_DICT | BJD_F_SREF | BJD_F_CPLIMIT)) | BJD_F_COMPACT);
+  out[6] = (uint8_t)flags; out[7] = (uint8_t)(flags >> 8);
+  bjson_dedup_t dd;
+  cw_t w = { out, out + hdr, out + cap, NULL };
+  if (flags & BJD_F_SREF){ memset(&dd, 0, sizeof(dd)); w.dd = &dd; }
+  int r = put_level(&w, doc, 0);
+  if (r <= 0) return r == 0 ? BJSON_EBUF : BJSON_EINVAL;
+  if (flags & BJD_F_CRC){
+    if (w.end - w.cur < 4) return BJSON_EBUF;
+    uint32_t c = bjd_crc32(0, out, (size_t)(w.cur - out));
+    enc_put_le(w.cur, 4, c);
+    w.cur += 4;
+  }
+  *len = (size_t)(w.cur - out);
+  return BJSON_OK;
+}
+
+/**
+ * @brief Write `doc` in the aligned profile, as the encoder would.
+ *
+ * @param doc Root document (bjd_open, either profile).
+ * @param flags BJSON_ENC_F_INDEX, BJSON_ENC_F_CRC, BJSON_ENC_F_RESERVE and/or
+ *              BJSON_ENC_F_DEDUP; BJSON_ENC_F_CPLIMIT follows the source.
+ * @param out Output buffer.
+ * @param cap Capacity of `out`.
+ * @param len[out] Aligned document length on success.
+ * @return BJSON_OK, BJSON_EBUF if `out` is too small, BJSON_EINVAL on bad
+ *         arguments or corrupt input.
+ */
+bjson_err_t bjson_expand(const bjd_doc_t* doc, uint32_t flags, uint8_t* out, size_t cap, size_t* len){
+  if (!doc || !out || !len || !is_root(doc)) return BJSON_EINVAL;
+  bjson_emit_t em; bjd_iter_t it; bjd_entry_t e; int r;
+  flags &= BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC | BJSON_ENC_F_RESERVE | BJSON_ENC_F_DEDUP;
+  if (doc->flags & BJD_F_CPLIMIT) flags |= BJSON_ENC_F_CPLIMIT;   // reserve in code points
+  if (!emit_begin(&em, flags, out, cap)) return BJSON_EBUF;
+  if (doc->flags & BJD_F_DICT){   // names are key IDs already: keep them and the hash
+    const uint8_t* h = doc->base + BJD_HDR_SIZE;
+    if (!emit_dict(&em, NULL, (uint32_t)h[0] | ((uint32_t)h[1]<<8) | ((uint32_t)h[2]<<16) | ((uint32_t)h[3]<<24))) return BJSON_EBUF;
+  }
+  bjd_iter_init(&it, doc);
+  while ((r = bjd_iter_next(&it, &e)) > 0) if ((r = emit_copy(&em, &e)) <= 0) return r == 0 ? BJSON_EBUF : BJSON_EINVAL;
+  if (r < 0) return BJSON_EINVAL;
+  return emit_end(&em, len) ? BJSON_OK : BJSON_EBUF;
+}
@@ -0,0 +1,375 @@
+#include "bjson_delta.h"
+#include "bjson_enc_internal.h"
+#include <string.h>
+
+/*
+ * bjson_diff / bjson_patch. Both sides walk one container level at a
+ * time. The diff pairs entries greedily: each new entry is looked up
+ * forward from the last paired old entry; one that is not found goes to
+ * `add`, positioned right after that pair (ARR_UINT32_AT), and pairing
+ * goes on with the next new entry. Old entries left unpaired go to
+ * `del`. Pairs that differ go to `set`, or to `sub` when both are
+ * objects. Everything is emitted in old order (`add` in new order), so
+ * the patch applies in a single merge pass over the old document.
+ * Output is written with the encoder's own writer, so the result is the
+ * byte image the encoder produces for the new document.
+ */
+
+enum { EV_END=0, EV_DEL, EV_KEEP, EV_ADD, EV_ERR=-1 };
+
+/** Pairing walk over one level of the old and new documents (see pw_next). */
+typedef struct {
+  bjd_iter_t o, n;        // next unpaired old entry, next new entry
+  bjd_iter_t after;       // old cursor after the pending pair
+  bjd_entry_t ko, kn;     // pending pair
+  uint32_t skip;          // old entries to drop before the pending pair
+  uint32_t oi, ocount;    // index of the next unpaired old entry, old entry count
+  uint32_t at;            // EV_ADD: old index the entry goes before (ocount: appended)
+  uint8_t  keep;          // pending pair valid
+  uint8_t  adding;        // 1: every new entry is appended, 2: new side done
+} pw_t;
+
+static int same_name(const bjd_entry_t* a, const bjd_entry_t* b){
+  return a->name_len == b->name_len && memcmp(a->name, b->name, a->name_len) == 0;
+}
+
+static uint8_t rsv_of(const bjd_entry_t* e){ return ((const uint8_t*)e->name - 8)[3]; }
+
+static uint32_t rd32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+static void pw_init(pw_t* w, const bjd_doc_t* o, const bjd_doc_t* n){
+  memset(w, 0, sizeof(*w));
+  bjd_iter_init(&w->o, o); bjd_iter_init(&w->n, n);
+  w->ocount = o->count;
+}
+
+/**
+ * @brief Next pairing event of one level.
+ *
+ * EV_DEL and EV_KEEP come in old order, EV_ADD in new order; `w->at`
+ * says which old entry an added one goes before. Old entries after the
+ * last pair are reported last as EV_DEL. A new entry that is not found
+ * costs one scan of the rest of the old level.
+ *
+ * @param w Walk state from pw_init.
+ * @param oe[out] Old entry (EV_DEL, EV_KEEP).
+ * @param ne[out] New entry (EV_KEEP, EV_ADD).
+ * @return EV_* event, EV_END when both sides are done, EV_ERR if corrupt.
+ */
+static int pw_next(pw_t* w, bjd_entry_t* oe, bjd_entry_t* ne){
+  int r;
+  if (w->skip){ w->skip--; w->oi++; return bjd_iter_next(&w->o, oe) > 0 ? EV_DEL : EV_ERR; }
+  if (w->keep){ w->keep = 0; *oe = w->ko; *ne = w->kn; w->o = w->after; w->oi++; return EV_KEEP; }
+  if (w->adding != 2){
+    if ((r = bjd_iter_next(&w->n, ne)) < 0) return EV_ERR;
+    if (r > 0 && w->adding){ w->at = w->ocount; return EV_ADD; }
+    if (r > 0){
+      bjd_iter_t s = w->o; bjd_entry_t c; uint32_t k = 0;
+      while ((r = bjd_iter_next(&s, &c)) > 0){
+        if (same_name(&c, ne)){ w->skip = k; w->keep = 1; w->ko = c; w->kn = *ne; w->after = s; return pw_next(w, oe, ne); }
+        k++;
+      }
+      if (r < 0) return EV_ERR;
+      w->at = w->oi;   // after the last pair
+      return EV_ADD;
+    }
+    w->adding = 2;
+  }
+  r = bjd_iter_next(&w->o, oe);
+  return r > 0 ? EV_DEL : r == 0 ? EV_END : EV_ERR;
+}
+
+/**
+ * @brief Deep equality of two entries (name, type, value, reserve).
+ *
+ * Packed element padding is not compared: it follows from the position
+ * and is recomputed when an entry is written.
+ */
+static int ent_eq(const bjd_entry_t* a, const bjd_entry_t* b, int depth){
+  if (a->type != b->type || !same_name(a, b)) return 0;
+  if (a->type != BJD_T_OBJ && a->type != BJD_T_ARR)
+    return a->val_len == b->val_len && rsv_of(a) == rsv_of(b) && memcmp(a->val, b->val, a->val_len) == 0;
+  bjd_doc_t sa, sb; bjd_iter_t ia, ib; bjd_entry_t ca, cb; int ra, rb;
+  if (depth >= BJSON_ENC_DEPTH_MAX || bjd_enter(a, &sa) != BJD_OK || bjd_enter(b, &sb) != BJD_OK || sa.count != sb.count) return 0;
+  bjd_iter_init(&ia, &sa); bjd_iter_init(&ib, &sb);
+  while ((ra = bjd_iter_next(&ia, &ca)) > 0 && (rb = bjd_iter_next(&ib, &cb)) > 0)
+    if (!ent_eq(&ca, &cb, depth+1)) return 0;
+  return ra == 0;
+}
+
+/** @brief 1 if no other entry of the level has `e`'s name. */
+static int unique(const bjd_doc_t* lvl, const bjd_entry_t* e){
+  bjd_iter_t it; bjd_entry_t c; int n = 0;
+  bjd_iter_init(&it, lvl);
+  while (bjd_iter_next(&it, &c) > 0) n += same_name(&c, e);
+  return n == 1;
+}
+
+/** @brief Open an empty-object marker / section container named `s`. */
+static int open_named(bjson_emit_t* em, const char* s){ return emit_open(em, BJD_T_OBJ, s, strlen(s)); }
+
+/** @brief Close a section, or drop it when it stayed empty. */
+static void close_section(bjson_emit_t* em){ if (em->count) emit_close(em); else emit_drop(em); }
+
+static int diff_level(bjson_emit_t* em, const bjd_doc_t* o, const bjd_doc_t* n, int depth);
+
+/**
+ * @brief Write one section of a level's patch.
+ *
+ * @param em Writer, positioned inside the level's patch container.
+ * @param o Old level.
+ * @param n New level.
+ * @param sec 'd'el, 's'et, 'u' (sub) or 'a'dd.
+ * @param all Fallback mode: drop every old entry, add every new one.
+ * @param depth Level nesting.
+ * @return 1 on success, 0 if the output is full, -1 on corrupt input.
+ */
+static int diff_section(bjson_emit_t* em, const bjd_doc_t* o, const bjd_doc_t* n, char sec, int all, int depth){
+  static const char* const names[] = { "del", "set", "sub", "add" };
+  const char* name = names[sec=='d' ? 0 : sec=='s' ? 1 : sec=='u' ? 2 : 3];
+  if (em->depth >= BJSON_ENC_DEPTH_MAX) return -1;
+  if (!open_named(em, name)) return 0;
+  pw_t w; bjd_entry_t oe, ne; int ev, r = 1;
+  pw_init(&w, o, n);
+  if (all) w.adding = 1;   // every new entry is added, every old one dropped
+  while (r > 0 && (ev = pw_next(&w, &oe, &ne)) != EV_END){
+    if (ev == EV_ERR) return -1;
+    if (ev == EV_DEL && sec == 'd'){
+      // marker the encoder accepts for the key: [] for ARR_ prefixes, else {}
+      uint8_t nl; const char* nm = bjd_entry_name(&oe, &nl);
+      const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+      if (pr && BJD_IS_PACKED(pr->type)) r = emit_packed(em, pr->type, oe.name, oe.name_len, bjd_type_info(BJD_ELEM_TYPE(pr->type))->width, NULL, 0);
+      else if (em->depth >= BJSON_ENC_DEPTH_MAX) return -1;
+      else if ((r = emit_open(em, BJD_T_OBJ, oe.name, oe.name_len))) emit_close(em);
+    } else if (ev == EV_ADD && sec == 'a'){
+      r = emit_copy(em, &ne);
+    } else if (ev == EV_KEEP && (sec == 's' || sec == 'u') && !ent_eq(&oe, &ne, depth)){
+      int nest = oe.type == BJD_T_OBJ && ne.type == BJD_T_OBJ && em->depth + 3 <= BJSON_ENC_DEPTH_MAX;
+      if (sec == 's' && !nest) r = emit_copy(em, &ne);
+      else if (sec == 'u' && nest){
+        bjd_doc_t so, sn;
+        if (bjd_enter(&oe, &so) != BJD_OK || bjd_enter(&ne, &sn) != BJD_OK) return -1;
+        if (!emit_open(em, BJD_T_OBJ, oe.name, oe.name_len)) return 0;
+        if ((r = diff_level(em, &so, &sn, depth+1)) > 0) emit_close(em);
+      }
+    }
+  }
+  if (r <= 0) return r;
+  close_section(em);
+  return 1;
+}
+
+/**
+ * @brief Write the ARR_UINT32_AT positions of a level's `add` entries.
+ *
+ * One u32 per added entry, in `add` order: the index of the old entry it
+ * goes before (old count: appended). Elements are written in place while
+ * walking, so nothing is buffered.
+ */
+static int diff_at(bjson_emit_t* em, const bjd_doc_t* o, const bjd_doc_t* n){
+  static const char key[] = "ARR_UINT32_AT";
+  if ((size_t)(em->end - em->cur) < 8 + sizeof(key) - 1) return 0;
+  memcpy(em->cur + 8, key, sizeof(key) - 1);
+  uint8_t nl = (uint8_t)emit_key_id(em, sizeof(key) - 1);
+  uint8_t* dat = emit_packed_data(em, nl, 4);
+  pw_t w; bjd_entry_t oe, ne; int ev; uint32_t k = 0;
+  if (!dat) return 0;
+  pw_init(&w, o, n);
+  while ((ev = pw_next(&w, &oe, &ne)) != EV_END){
+    if (ev == EV_ERR) return -1;
+    if (ev != EV_ADD) continue;
+    if ((size_t)(em->end - dat) / 4 <= k) return 0;
+    enc_put_le(dat + 4*k++, 4, w.at);
+  }
+  return emit_commit_packed(em, BJD_T_ARR_U32, nl, 4, k);
+}
+
+/**
+ * @brief Write the del/set/sub/add sections turning level `o` into `n`.
+ *
+ * A first pass checks that every old entry the patch names is the only
+ * one with that name (otherwise the level is rewritten whole), and
+ * whether an added entry goes anywhere but the end (then the level gets
+ * ARR_UINT32_AT).
+ */
+static int diff_level(bjson_emit_t* em, const bjd_doc_t* o, const bjd_doc_t* n, int depth){
+  pw_t w; bjd_entry_t oe, ne; int ev, all = 0, pos = 0;
+  pw_init(&w, o, n);
+  while (!all && (ev = pw_next(&w, &oe, &ne)) != EV_END){
+    if (ev == EV_ERR) return -1;
+    if ((ev == EV_DEL || (ev == EV_KEEP && !ent_eq(&oe, &ne, depth))) && !unique(o, &oe)) all = 1;
+    if (ev == EV_ADD && w.at != w.ocount) pos = 1;
+  }
+  static const char secs[] = "dsua";
+  for (int i=0;i<4;i++){
+    int r = diff_section(em, o, n, secs[i], all, depth);
+    if (r <= 0) return r;
+  }
+  return (pos && !all) ? diff_at(em, o, n) : 1;
+}
+
+/** @brief Map document header flags to the encoder options that write them. */
+static uint32_t enc_flags(uint16_t f){
+  return ((f & BJD_F_INDEX) ? BJSON_ENC_F_INDEX : 0) | ((f & BJD_F_CRC) ? BJSON_ENC_F_CRC : 0)
+       | ((f & BJD_F_RESERVE) ? BJSON_ENC_F_RESERVE : 0) | ((f & BJD_F_SREF) ? BJSON_ENC_F_DEDUP : 0)
+       | ((f & BJD_F_CPLIMIT) ? BJSON_ENC_F_CPLIMIT : 0);
+}
+
+/**
+ * @brief CRC-32 identifying a base document.
+ *
+ * The BJD_F_CRC trailer is left out: a CRC over data plus its own CRC is
+ * the same constant for every document.
+ */
+static uint32_t base_crc(const bjd_doc_t* d){
+  return bjd_crc32(0, d->base, d->len - ((d->flags & BJD_F_CRC) ? 4 : 0));
+}
+
+/** @brief Dictionary hash stored after the header of a BJD_F_DICT document. */
+static uint32_t dict_hash(const bjd_doc_t* d){ return rd32(d->base + BJD_HDR_SIZE); }
+
+static bjson_err_t to_err(int r){ return r == 0 ? BJSON_EBUF : BJSON_EINVAL; }
+
+/**
+ * @brief Build a patch that turns `old` into `nw`.
+ *
+ * The patch holds only what changed (see bjson_delta.h), plus the new
+ * header flags and the CRC-32 of `old` so it is never applied to another
+ * base. It always carries a CRC trailer. Cost is one walk of both
+ * documents per section, plus a uniqueness check per changed key.
+ * For a BJD_F_DICT target the patch is a dictionary document too, with
+ * the same key IDs; attach the dictionary to all documents involved.
+ *
+ * @param old Base document.
+ * @param nw Target document.
+ * @param out Patch buffer.
+ * @param cap Capacity of `out`.
+ * @param len[out] Patch length on success.
+ * @return BJSON_OK, BJSON_EBUF if `out` is too small, BJSON_EINVAL on bad
+ *         arguments, corrupt input or nesting too deep for a patch.
+ */
+bjson_err_t bjson_diff(const bjd_doc_t* old, const bjd_doc_t* nw, uint8_t* out, size_t cap, size_t* len){
+  if (!old || !nw || !out || !len || old->compact || nw->compact) return BJSON_EINVAL;
+  bjson_emit_t em; uint8_t v[4];
+  if (!emit_begin(&em, BJSON_ENC_F_CRC | (nw->flags & BJD_F_RESERVE ? BJSON_ENC_F_RESERVE : 0), out, cap)) return BJSON_EBUF;
+  if ((nw->flags & BJD_F_DICT) && !emit_dict(&em, nw->dict, dict_hash(nw))) return BJSON_EBUF;
+  enc_put_le(v, 2, nw->flags);
+  if (!emit_entry(&em, BJD_T_U16, "UINT16_FLAGS", 12, v, 2)) return BJSON_EBUF;
+  enc_put_le(v, 4, base_crc(old));
+  if (!emit_entry(&em, BJD_T_U32, "UINT32_BASE", 11, v, 4)) return BJSON_EBUF;
+  int r = diff_level(&em, old, nw, 0);
+  if (r <= 0) return to_err(r);
+  return emit_end(&em, len) ? BJSON_OK : BJSON_EBUF;
+}
+
+/** Section cursor of one patch level: head entry of `it`, if any. */
+typedef struct { bjd_iter_t it; bjd_entry_t e; int has; } sec_t;
+
+static int sec_next(sec_t* s){ int r = bjd_iter_next(&s->it, &s->e); s->has = r > 0; return r; }
+
+/**
+ * @brief Open the section named `name` of a patch level (may be absent).
+ * @return 1 on success, -1 if present but not an object.
+ */
+static int sec_init(sec_t* s, const bjd_doc_t* p, const char* name){
+  bjd_entry_t e; bjd_doc_t v;
+  s->has = 0;
+  if (bjd_find(p, name, &e) < 0) return 1;
+  if (e.type != BJD_T_OBJ || bjd_enter(&e, &v) != BJD_OK) return -1;
+  bjd_iter_init(&s->it, &v);
+  return sec_next(s) < 0 ? -1 : 1;
+}
+
+/**
+ * @brief Write the pending `add` entries that go before old entry `oi`.
+ *
+ * @param add Add section cursor.
+ * @param at ARR_UINT32_AT elements (`nat` of them), NULL: every add is appended.
+ * @param ai[in,out] Index of `add`'s head entry.
+ * @param oi Old entry index reached (the old count at the end).
+ * @param end Old entry count.
+ * @return 1 on success, 0 if the output is full, -1 if positions are out of order.
+ */
+static int put_adds(bjson_emit_t* em, sec_t* add, const uint8_t* at, uint32_t nat, uint32_t* ai, uint32_t oi, uint32_t end){
+  int r;
+  while (add->has){
+    uint32_t p = at ? (*ai < nat ? rd32(at + 4 * *ai) : UINT32_MAX) : end;
+    if (p > oi) return p > end ? -1 : 1;
+    if (p < oi) return -1;
+    if ((r = emit_copy(em, &add->e)) <= 0) return r;
+    if (sec_next(add) < 0) return -1;
+    (*ai)++;
+  }
+  return 1;
+}
+
+/**
+ * @brief Write level `o` with the patch level `p` applied.
+ *
+ * One pass over the old entries; the del/set/sub heads are matched by
+ * name as the walk reaches them, and each add is written before the old
+ * entry its ARR_UINT32_AT position names (appended without one).
+ *
+ * @return 1 on success, 0 if the output is full, -1 if the patch does not
+ *         fit `o` or an input is corrupt.
+ */
+static int apply_level(bjson_emit_t* em, const bjd_doc_t* o, const bjd_doc_t* p, int depth){
+  sec_t del, set, sub, add;
+  if (sec_init(&del, p, "del") < 0 || sec_init(&set, p, "set") < 0 ||
+      sec_init(&sub, p, "sub") < 0 || sec_init(&add, p, "add") < 0) return -1;
+  bjd_iter_t it; bjd_entry_t oe; int r;
+  const uint8_t* at = NULL; uint32_t nat = 0, ai = 0, oi = 0;
+  if (bjd_find(p, "ARR_UINT32_AT", &oe) >= 0){
+    if (oe.type != BJD_T_ARR_U32 || oe.val_len % 4) return -1;
+    at = oe.val; nat = oe.val_len / 4;   // read bytewise: a compacted patch is not aligned
+  }
+  bjd_iter_init(&it, o);
+  while ((r = bjd_iter_next(&it, &oe)) > 0){
+    if ((r = put_adds(em, &add, at, nat, &ai, oi++, o->count)) <= 0) return r;
+    if (del.has && same_name(&del.e, &oe)){ if (sec_next(&del) < 0) return -1; continue; }
+    if (set.has && same_name(&set.e, &oe)){
+      if ((r = emit_copy(em, &set.e)) <= 0 || sec_next(&set) < 0) return r <= 0 ? r : -1;
+    } else if (sub.has && same_name(&sub.e, &oe)){
+      bjd_doc_t so, sp;
+      if (oe.type != BJD_T_OBJ || depth+1 >= BJSON_ENC_DEPTH_MAX || bjd_enter(&oe, &so) != BJD_OK || bjd_enter(&sub.e, &sp) != BJD_OK) return -1;
+      if (!emit_open(em, BJD_T_OBJ, oe.name, oe.name_len)) return 0;
+      if ((r = apply_level(em, &so, &sp, depth+1)) <= 0) return r;
+      emit_close(em);
+      if (sec_next(&sub) < 0) return -1;
+    } else if ((r = emit_copy(em, &oe)) <= 0) return r;
+  }
+  if (r < 0 || del.has || set.has || sub.has) return -1;
+  if ((r = put_adds(em, &add, at, nat, &ai, o->count, o->count)) <= 0) return r;
+  return (add.has || (at && ai != nat)) ? -1 : 1;
+}
+
+/**
+ * @brief Apply a bjson_diff patch to its base document.
+ *
+ * Checks the base CRC-32 recorded in the patch, then writes the new
+ * document in one pass over `old`, with its index section and CRC
+ * trailer when the new header flags call for them. The output equals
+ * the document the patch was made from, byte for byte (both buffers
+ * 8-byte aligned, as for any encoder output with 8-byte packed arrays).
+ *
+ * @param old Base document the patch was made against.
+ * @param patch Patch from bjson_diff (validate it first if it came over a link).
+ * @param out Output buffer.
+ * @param cap Capacity of `out`.
+ * @param len[out] New document length on success.
+ * @return BJSON_OK, BJSON_EBUF if `out` is too small, BJSON_EINVAL if the
+ *         patch is malformed, belongs to another base, or an input is corrupt.
+ */
+bjson_err_t bjson_patch(const bjd_doc_t* old, const bjd_doc_t* patch, uint8_t* out, size_t cap, size_t* len){
+  if (!old || !patch || !out || !len || old->compact) return BJSON_EINVAL;
+  uint32_t flags, base;
+  if (bjd_get_u32(patch, "UINT16_FLAGS", &flags) != 0 || bjd_get_u32(patch, "UINT32_BASE", &base) != 0 ||
+      base != base_crc(old)) return BJSON_EINVAL;
+  if ((flags & BJD_F_DICT) && !(patch->flags & BJD_F_DICT)) return BJSON_EINVAL;
+  bjson_emit_t em;
+  if (!emit_begin(&em, enc_flags((uint16_t)flags), out, cap)) return BJSON_EBUF;
+  if ((flags & BJD_F_DICT) && !emit_dict(&em, patch->dict, dict_hash(patch))) return BJSON_EBUF;
+  int r = apply_level(&em, old, patch, 0);
+  if (r <= 0) return to_err(r);
+  return emit_end(&em, len) ? BJSON_OK : BJSON_EBUF;
+}
@@ -0,0 +1,454 @@
+#include "bjson_enc.h"
+#include "bjson_enc_internal.h"
+#include "bjson.h"
+#include <string.h>
+
+/* --------- BJSON writer shared by all encoder front-ends --------- */
+static void w32(uint8_t* p, uint32_t v){ p[0]=v&0xFF; p[1]=(v>>8)&0xFF; p[2]=(v>>16)&0xFF; p[3]=(v>>24)&0xFF; }
+static uint32_t r32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+static const uint8_t* align4p(const uint8_t* p){ uintptr_t x=(uintptr_t)p; return (const uint8_t*)((x+3)&~(uintptr_t)3); }
+
+/**
+ * @brief Start a document: write the header and reserve the count.
+ *
+ * @param e Writer state to initialize.
+ * @param flags BJSON_ENC_F_* option bits.
+ * @param out Output buffer.
+ * @param cap Capacity of `out`.
+ * @return 1 on success, 0 if the header does not fit.
+ */
+int emit_begin(bjson_emit_t* e, uint32_t flags, uint8_t* out, size_t cap){
+  if (flags & BJSON_ENC_F_RESERVE) flags &= ~BJSON_ENC_F_DEDUP;   // reserved strings are patched one by one
+  e->out=out; e->cur=out; e->end=out+cap; e->flags=flags; e->count=0; e->depth=0;
+  e->dict=NULL; e->hdr=BJD_HDR_SIZE;
+  if (flags & BJSON_ENC_F_DEDUP) memset(&e->dd, 0, sizeof(e->dd));
+  if (cap < BJD_HDR_SIZE) return 0;
+  uint16_t hflags = ((flags & BJSON_ENC_F_INDEX) ? BJD_F_INDEX : 0) | ((flags & BJSON_ENC_F_CRC) ? BJD_F_CRC : 0)
+                  | ((flags & BJSON_ENC_F_RESERVE) ? BJD_F_RESERVE : 0) | ((flags & BJSON_ENC_F_DEDUP) ? BJD_F_SREF : 0)
+                  | ((flags & BJSON_ENC_F_CPLIMIT) ? BJD_F_CPLIMIT : 0);
+  memcpy(out,"BJSN",4);
+  out[4]=1; out[5]=1; out[6]=hflags&0xFF; out[7]=hflags>>8;
+  w32(out+8, 0);
+  e->cur = out + BJD_HDR_SIZE;
+  return 1;
+}
+
+/**
+ * @brief Switch the document to key IDs (BJD_F_DICT), right after emit_begin.
+ *
+ * Sets the header flag and stores the dictionary hash after the header;
+ * from here on the writers store keys listed in `dict` as key IDs.
+ *
+ * @param e Writer state with no entries yet.
+ * @param dict Dictionary to translate keys with, or NULL when the names
+ *             are already key IDs (entries copied from a BJD_F_DICT doc).
+ * @param hash Dictionary hash to record (bjd_dict_t.hash).
+ * @return 1 on success, 0 if the extended header does not fit.
+ */
+int emit_dict(bjson_emit_t* e, const bjd_dict_t* dict, uint32_t hash){
+  if ((size_t)(e->end - e->out) < BJD_DICT_HDR_SIZE) return 0;
+  e->out[6] |= BJD_F_DICT & 0xFF;
+  w32(e->out + BJD_HDR_SIZE, hash);
+  e->dict = dict; e->hdr = BJD_DICT_HDR_SIZE;
+  e->cur = e->out + BJD_DICT_HDR_SIZE;
+  return 1;
+}
+
+/**
+ * @brief Stored form of a key: its key ID when the dictionary lists it.
+ *
+ * @param e Writer state.
+ * @param key Key bytes.
+ * @param klen[in,out] Key length; BJD_KEY_ID_LEN when an ID is returned.
+ * @param id Scratch for the ID bytes.
+ * @return `key` or `id`.
+ */
+static const char* stored_name(const bjson_emit_t* e, const char* key, size_t* klen, char* id){
+  int i = e->dict ? bjd_dict_id(e->dict, key, *klen) : -1;
+  if (i < 0) return key;
+  id[0]=0; id[1]=(char)(uint8_t)i; id[2]=(char)(uint8_t)(i>>8);
+  *klen = BJD_KEY_ID_LEN;
+  return id;
+}
+
+/**
+ * @brief Replace a name already in place with its key ID, if listed.
+ *
+ * Dictionary keys are longer than an ID (bjd_dict_init), so the ID
+ * always fits where the name was.
+ *
+ * @param e Writer state (`nlen` name bytes at `e->cur + 8`).
+ * @param nlen Name length.
+ * @return New name length.
+ */
+int emit_key_id(bjson_emit_t* e, uint8_t nlen){
+  char id[BJD_KEY_ID_LEN]; size_t n = nlen;
+  if (stored_name(e, (const char*)e->cur + 8, &n, id) != id) return nlen;
+  memcpy(e->cur + 8, id, BJD_KEY_ID_LEN);
+  return BJD_KEY_ID_LEN;
+}
+
+/**
+ * @brief Finish the entry whose name and value are already in place.
+ *
+ * The caller has written `nlen` name bytes followed by `vlen` value bytes
+ * at `e->cur + 8`; this writes the 8-byte entry header, zero-pads to the
+ * next 4-byte boundary and advances to the next entry.
+ *
+ * @param e Writer state.
+ * @param type Wire type (bjd_type_t).
+ * @param nlen Name length.
+ * @param vlen Value length.
+ * @return 1 on success, 0 if the padded entry does not fit.
+ */
+int emit_commit(bjson_emit_t* e, uint8_t type, uint8_t nlen, uint32_t vlen){
+  uint8_t* cur = e->cur;
+  if ((size_t)(e->end-cur) < 8 || (size_t)(e->end-cur-8) < (size_t)nlen + vlen) return 0;
+  uint8_t* nxt = (uint8_t*)align4p(cur + 8 + nlen + vlen);
+  if (nxt > e->end) return 0;
+  cur[0]=type; cur[1]=nlen; cur[2]=0; cur[3]=0;
+  w32(cur+4, vlen);
+  for (uint8_t* p=cur+8+nlen+vlen; p<nxt; p++) *p=0;
+  e->cur = nxt; e->count++;
+  return 1;
+}
+
+/**
+ * @brief Write one complete entry.
+ *
+ * @param e Writer state.
+ * @param type Wire type (bjd_type_t).
+ * @param key Key bytes.
+ * @param klen Key length (<= 255).
+ * @param val Value bytes.
+ * @param vlen Value length.
+ * @return 1 on success, 0 if the entry does not fit.
+ */
+int emit_entry(bjson_emit_t* e, uint8_t type, const char* key, size_t klen, const void* val, uint32_t vlen){
+  char id[BJD_KEY_ID_LEN]; key = stored_name(e, key, &klen, id);
+  if ((size_t)(e->end-e->cur) < 8 || (size_t)(e->end-e->cur-8) < klen + vlen) return 0;
+  memcpy(e->cur+8, key, klen);
+  if (vlen) memcpy(e->cur+8+klen, val, vlen);
+  return emit_commit(e, type, (uint8_t)klen, vlen);
+}
+
+/**
+ * @brief Look up a string value among the ones already written, or remember it.
+ *
+ * The hash samples the length and the first and last 8 bytes, so it
+ * costs the same for any string; a hit is confirmed with memcmp against
+ * the earlier bytes in the document. Bytes are read little-endian, so the
+ * slots, and with them the output, are the same on every host.
+ *
+ * @param t Table (zeroed at the start of the document).
+ * @param doc Document start.
+ * @param s String bytes, n >= ENC_SREF_MIN.
+ * @param n String length.
+ * @param at Offset the string is (or will be) stored at when it is new.
+ * @return Offset of an earlier copy of the string, or 0 (then `at` is remembered).
+ */
+uint32_t enc_dedup(bjson_dedup_t* t, const uint8_t* doc, const uint8_t* s, uint32_t n, uint32_t at){
+  uint64_t a = r32(s) | (uint64_t)r32(s+4) << 32, b = r32(s+n-8) | (uint64_t)r32(s+n-4) << 32;
+  uint64_t x = (a ^ n) * 0x9E3779B97F4A7C15ull ^ b * 0xC2B2AE3D27D4EB4Full;
+  uint32_t h = (uint32_t)(x >> 32), k = (h ^ (uint32_t)x) & (BJSON_ENC_DEDUP_SLOTS-1);
+  if (t->off[k] && t->hash[k] == h && t->len[k] == n && memcmp(doc + t->off[k], s, n) == 0) return t->off[k];
+  t->hash[k] = h; t->off[k] = at; t->len[k] = (uint16_t)n;
+  return 0;
+}
+
+/**
+ * @brief Finish a string entry, reserving room up to `cap` value bytes.
+ *
+ * Without BJSON_ENC_F_RESERVE this is emit_commit. With it, the 4-byte
+ * words between the padded value and `cap` bytes are zero-filled and
+ * counted in header byte 3, so bjd_set_str can later grow the string to
+ * its STR_N limit without moving the entries after it (at most 255
+ * words; callers pass ENC_STR_BYTES of the limit). With
+ * BJSON_ENC_F_DEDUP, a string already written earlier in the document
+ * is replaced by a BJD_T_SREF entry pointing at that copy.
+ *
+ * @param e Writer state.
+ * @param nlen Name length.
+ * @param vlen String length (name and value already in place).
+ * @param cap Value capacity to reserve in bytes (the STR_N limit).
+ * @return 1 on success, 0 if the entry and its reserve do not fit.
+ */
+int emit_commit_str(bjson_emit_t* e, uint8_t nlen, uint32_t vlen, uint32_t cap){
+  uint8_t* hdr = e->cur;
+  if ((e->flags & BJSON_ENC_F_DEDUP) && vlen >= ENC_SREF_MIN && (size_t)(e->end-hdr) >= 8u + nlen + vlen){
+    uint8_t* v = hdr + 8 + nlen;
+    uint32_t off = enc_dedup(&e->dd, e->out, v, vlen, (uint32_t)(v - e->out));
+    if (off){ w32(v, off); w32(v+4, vlen); return emit_commit(e, BJD_T_SREF, nlen, 8); }
+  }
+  if (!emit_commit(e, BJD_T_STR, nlen, vlen)) return 0;
+  if (!(e->flags & BJSON_ENC_F_RESERVE) || cap <= vlen) return 1;
+  uint8_t* nxt = (uint8_t*)align4p(hdr + 8 + nlen + cap);
+  if (nxt - e->cur > 255*4) nxt = e->cur + 255*4;   // STR_256_ in code points: 1024 bytes
+  if (nxt > e->end) return 0;
+  memset(e->cur, 0, (size_t)(nxt - e->cur));
+  hdr[3] = (uint8_t)((nxt - e->cur) / 4);
+  e->cur = nxt;
+  return 1;
+}
+
+/**
+ * @brief Write one complete string entry with reserved capacity.
+ *
+ * @param e Writer state.
+ * @param key Key bytes.
+ * @param klen Key length (<= 255).
+ * @param s String bytes.
+ * @param n String length.
+ * @param cap Value capacity to reserve (see emit_commit_str).
+ * @return 1 on success, 0 if the entry does not fit.
+ */
+int emit_str(bjson_emit_t* e, const char* key, size_t klen, const char* s, uint32_t n, uint32_t cap){
+  char id[BJD_KEY_ID_LEN]; key = stored_name(e, key, &klen, id);
+  if ((size_t)(e->end-e->cur) < 8 || (size_t)(e->end-e->cur-8) < klen + n) return 0;
+  memcpy(e->cur+8, key, klen);
+  if (n) memcpy(e->cur+8+klen, s, n);
+  return emit_commit_str(e, (uint8_t)klen, n, cap);
+}
+
+/**
+ * @brief Element start of a packed array whose name is already in place.
+ *
+ * The elements are naturally aligned (by address) after the name; the
+ * gap becomes the leading value pad (header byte 2) in
+ * emit_commit_packed.
+ *
+ * @param e Writer state.
+ * @param nlen Name length.
+ * @param w Element width (power of two).
+ * @return Element start, or NULL if it lies past the end of the output.
+ */
+uint8_t* emit_packed_data(bjson_emit_t* e, uint8_t nlen, int w){
+  uint8_t* val = e->cur + 8 + nlen;
+  uint8_t* dat = val + ((0u - (uintptr_t)val) & (uintptr_t)(w-1));
+  return (dat <= e->end) ? dat : NULL;
+}
+
+/**
+ * @brief Finish a packed array whose name and `n` elements are in place.
+ *
+ * @param e Writer state.
+ * @param type Packed wire type (BJD_T_ARR_*).
+ * @param nlen Name length.
+ * @param w Element width.
+ * @param n Element count.
+ * @return 1 on success, 0 if the padded entry does not fit.
+ */
+int emit_commit_packed(bjson_emit_t* e, uint8_t type, uint8_t nlen, int w, uint32_t n){
+  uint8_t* hdr = e->cur;
+  uint8_t* val = hdr + 8 + nlen;
+  uint8_t* dat = emit_packed_data(e, nlen, w);
+  if (!dat) return 0;
+  uint64_t vlen = (uint64_t)(dat - val) + (uint64_t)n * (uint64_t)w;
+  if (vlen > UINT32_MAX || !emit_commit(e, type, nlen, (uint32_t)vlen)) return 0;
+  hdr[2] = (uint8_t)(dat - val);
+  memset(val, 0, (size_t)(dat - val));
+  return 1;
+}
+
+/**
+ * @brief Write one complete packed array entry.
+ *
+ * @param e Writer state.
+ * @param type Packed wire type (BJD_T_ARR_*).
+ * @param key Key bytes.
+ * @param klen Key length (<= 255).
+ * @param w Element width.
+ * @param data `n` little-endian elements.
+ * @param n Element count.
+ * @return 1 on success, 0 if the entry does not fit.
+ */
+int emit_packed(bjson_emit_t* e, uint8_t type, const char* key, size_t klen, int w, const void* data, uint32_t n){
+  char id[BJD_KEY_ID_LEN]; key = stored_name(e, key, &klen, id);
+  if ((size_t)(e->end-e->cur) < 8 + klen) return 0;
+  memcpy(e->cur+8, key, klen);
+  uint8_t* dat = emit_packed_data(e, (uint8_t)klen, w);
+  if (!dat || (size_t)(e->end-dat) / (size_t)w < n) return 0;
+  if (n) memcpy(dat, data, (size_t)n*(size_t)w);
+  return emit_commit_packed(e, type, (uint8_t)klen, w, n);
+}
+
+/**
+ * @brief Open a container entry whose name is already in place.
+ *
+ * Like emit_commit, the caller has written `nlen` name bytes at
+ * `e->cur + 8`. The value starts with zero padding (length in header
+ * byte 2) so the u32 child count and the children are 4-byte aligned.
+ * Children are then written with the usual calls until emit_close.
+ *
+ * @param e Writer state (depth < BJSON_ENC_DEPTH_MAX, checked by the parser).
+ * @param type BJD_T_OBJ or BJD_T_ARR.
+ * @param nlen Name length (0 for array elements).
+ * @return 1 on success, 0 if the container header does not fit.
+ */
+int emit_push(bjson_emit_t* e, uint8_t type, uint8_t nlen){
+  uint8_t* cur = e->cur;
+  uint8_t* val = cur + 8 + nlen;
+  uint8_t pad = (uint8_t)(align4p(val) - val);
+  if ((size_t)(e->end-cur) < 8 + (size_t)nlen + pad + 4) return 0;
+  cur[0]=type; cur[1]=nlen; cur[2]=pad; cur[3]=0;
+  w32(cur+4, 0);
+  memset(val, 0, (size_t)pad + 4);
+  e->open[e->depth] = (uint32_t)(cur - e->out);
+  e->saved[e->depth++] = e->count;
+  e->count = 0;
+  e->cur = val + pad + 4;
+  return 1;
+}
+
+/**
+ * @brief Open a container entry.
+ *
+ * @param e Writer state.
+ * @param type BJD_T_OBJ or BJD_T_ARR.
+ * @param key Key bytes.
+ * @param klen Key length (<= 255, 0 for array elements).
+ * @return 1 on success, 0 if the container header does not fit.
+ */
+int emit_open(bjson_emit_t* e, uint8_t type, const char* key, size_t klen){
+  char id[BJD_KEY_ID_LEN]; key = stored_name(e, key, &klen, id);
+  if ((size_t)(e->end-e->cur) < 8 + klen) return 0;
+  memcpy(e->cur+8, key, klen);
+  return emit_push(e, type, (uint8_t)klen);
+}
+
+/**
+ * @brief Close the innermost open container.
+ *
+ * Patches the child count and the value length; the value length spans
+ * the whole subtree, so readers skip a container in O(1).
+ *
+ * @param e Writer state with depth > 0.
+ */
+void emit_close(bjson_emit_t* e){
+  uint8_t* hdr = e->out + e->open[--e->depth];
+  uint8_t* val = hdr + 8 + hdr[1];
+  w32(val + hdr[2], e->count);
+  w32(hdr+4, (uint32_t)(e->cur - val));
+  e->count = e->saved[e->depth] + 1;
+}
+
+/**
+ * @brief Discard the innermost open container (used when it stayed empty).
+ *
+ * @param e Writer state with depth > 0.
+ */
+void emit_drop(bjson_emit_t* e){
+  e->cur = e->out + e->open[--e->depth];
+  e->count = e->saved[e->depth];
+}
+
+/**
+ * @brief Re-emit an entry decoded from another document.
+ *
+ * Goes through the regular writers rather than copying bytes, so packed
+ * element padding is recomputed for the new position and the result is
+ * what the encoder would have written there. Containers are copied
+ * child by child; a string keeps its reserved capacity (with
+ * BJSON_ENC_F_RESERVE), or gets its STR_N limit when the source is a
+ * BJD_F_COMPACT entry, which has none on the wire. Back-references
+ * arrive resolved and are written again as the writer's flags decide.
+ *
+ * @param e Writer state.
+ * @param s Source entry (bjd_iter_next, bjd_find, ...).
+ * @return 1 on success, 0 if it does not fit, -1 if the source is corrupt
+ *         or nests deeper than BJSON_ENC_DEPTH_MAX.
+ */
+int emit_copy(bjson_emit_t* e, const bjd_entry_t* s){
+  if (BJD_IS_PACKED(s->type)){
+    const bjd_type_info_t* ti = bjd_type_info(BJD_ELEM_TYPE(s->type));
+    if (!ti || !ti->width || s->val_len % ti->width) return -1;
+    return emit_packed(e, (uint8_t)s->type, s->name, s->name_len, ti->width, s->val, s->val_len / ti->width);
+  }
+  if (s->type == BJD_T_OBJ || s->type == BJD_T_ARR){
+    bjd_doc_t sub; bjd_iter_t it; bjd_entry_t c; int r;
+    if (e->depth >= BJSON_ENC_DEPTH_MAX || bjd_enter(s, &sub) != BJD_OK) return -1;
+    if (!emit_open(e, (uint8_t)s->type, s->name, s->name_len)) return 0;
+    bjd_iter_init(&it, &sub);
+    while ((r = bjd_iter_next(&it, &c)) > 0) if ((r = emit_copy(e, &c)) <= 0) return r;
+    if (r < 0) return -1;
+    emit_close(e);
+    return 1;
+  }
+  if (s->type == BJD_T_STR){
+    uint32_t cap;
+    if (s->compact){   // no rsv on the wire: reserve up to the STR_N limit of the key
+      uint8_t nl; const char* nm = bjd_entry_name(s, &nl);
+      const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+      cap = pr ? (uint32_t)ENC_STR_BYTES(e->flags, pr->limit) : 0;
+    } else {
+      const uint8_t* h = (const uint8_t*)s->name - 8;
+      cap = (uint32_t)(align4p(s->val + s->val_len) + 4u*h[3] - s->val);
+    }
+    return emit_str(e, s->name, s->name_len, (const char*)s->val, s->val_len, cap);
+  }
+  return emit_entry(e, (uint8_t)s->type, s->name, s->name_len, s->val, s->val_len);
+}
+
+/**
+ * @brief Append the hashed key index section after the encoded entries.
+ *
+ * Walks the top-level entries already written (containers are skipped
+ * whole through their value length) to collect their offsets, fills
+ * open-addressed slots {bjd_hash(name), index+1} (load factor <= 1/2),
+ * then the offset table and the trailing section offset. See
+ * `open_index` in libbjson for the matching reader.
+ *
+ * @param e Writer state positioned after the last entry.
+ * @return 1 on success, 0 if the buffer is too small.
+ */
+static int emit_index(bjson_emit_t* e){
+  uint32_t cnt=e->count, nslots=1; while (nslots < 2*cnt) nslots<<=1;
+  size_t need = 4 + (size_t)nslots*8 + (size_t)cnt*4 + 4;
+  if ((size_t)(e->end-e->cur) < need) return 0;
+  uint8_t* sec=e->cur; uint8_t* slots=sec+4; uint8_t* offs=slots+(size_t)nslots*8;
+  w32(sec, nslots);
+  memset(slots, 0, (size_t)nslots*8);
+  const uint8_t* p = e->out + e->hdr;
+  for (uint32_t i=0;i<cnt;i++){
+    uint8_t nlen=p[1]; uint32_t vlen=r32(p+4);
+    uint32_t h = bjd_hash((const char*)(p+8), nlen), mask=nslots-1, k=h&mask;
+    while (r32(slots+(size_t)k*8+4)) k=(k+1)&mask;
+    w32(slots+(size_t)k*8, h); w32(slots+(size_t)k*8+4, i+1);
+    w32(offs+(size_t)i*4, (uint32_t)(p-e->out));
+    p = align4p(p+8+nlen+vlen) + 4u*p[3];
+  }
+  w32(offs+(size_t)cnt*4, (uint32_t)(sec-e->out));
+  e->cur = sec+need;
+  return 1;
+}
+
+/**
+ * @brief Finish the document: patch the count and append optional sections
+ *        (index, then the CRC trailer last).
+ *
+ * @param e Writer state.
+ * @param out_len[out] Total document length on success.
+ * @return 1 on success, 0 if an optional section does not fit.
+ */
+int emit_end(bjson_emit_t* e, size_t* out_len){
+  w32(e->out+8, e->count);
+  if ((e->flags & BJSON_ENC_F_INDEX) && !emit_index(e)) return 0;
+  if (e->flags & BJSON_ENC_F_CRC){ // trailer covers everything before it
+    if (e->end - e->cur < 4) return 0;
+    w32(e->cur, bjd_crc32(0, e->out, (size_t)(e->cur - e->out)));
+    e->cur += 4;
+  }
+  *out_len = (size_t)(e->cur - e->out);
+  return 1;
+}
+
+/**
+ * @brief Store `w` bytes of a fixed-size value little-endian.
+ *
+ * @param p Destination.
+ * @param w Width in bytes (1..8).
+ * @param v Payload bits (already converted and range-checked).
+ */
+void enc_put_le(uint8_t* p, int w, uint64_t v){
+  for (int i=0;i<w;i++){ p[i]=(uint8_t)v; v >>= 8; }
+}
@@ -1,22 +1,25 @@
 #include "bjson_enc.h"
 #include "bjson_enc_internal.h"
+#include "bjson.h"
+#include "bjson_scan.h"
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
 
 #define ARENA_CAP (4096)
-static int is_ident0(int c){ return isalpha(c) || (c=='_'); }
-static int is_ident(int c){ return isalnum(c) || (c=='_'); }
+// ASCII only: <ctype.h> classes follow the current locale (non-ASCII bytes, per-thread state)
+int enc_is_ident0(int c){ return (unsigned)((c | 0x20) - 'a') < 26u || c=='_'; }
+int enc_is_ident(int c){ return enc_is_ident0(c) || (unsigned)(c - '0') < 10u; }
 
 /**
  * @brief Skip whitespace in the parser context.
  *
- * Advances `p->pos` past spaces, tabs, CR and LF.
+ * Advances `p->pos` past spaces, tabs, CR and LF, a word at a time
+ * (see bjson_scan.h).
  *
  * @param p Parser context.
  * @return Always returns 0 (helper convenience).
  */
-static int  ws(pctx_t* p){ while (p->pos<p->len && (p->json[p->pos]==' '||p->json[p->pos]=='\t'||p->json[p->pos]=='\r'||p->json[p->pos]=='\n')) p->pos++; return 0; }
+static int  ws(pctx_t* p){ p->pos += scan_ws(p->json + p->pos, p->len - p->pos); return 0; }
 /**
  * @brief Peek current character or -1 if at end.
  *
@@ -33,79 +36,252 @@ static int  ch(pctx_t* p){ return (p->pos<p->len)? (unsigned char)p->json[p->pos
  */
 static int  eat(pctx_t* p, char c){ ws(p); if (ch(p)==c){ p->pos++; return 1; } return 0; }
 
+/**
+ * @brief Allocate from the context arena, growing it when hooks allow.
+ *
+ * Allocations are 8-byte aligned so AST nodes can be accessed directly.
+ * When the current block is full the next kept chunk is reused; a new
+ * chunk of at least `al.chunk` bytes is allocated only if none fits.
+ *
+ * @param p Parser context.
+ * @param n Number of bytes.
+ * @return Pointer into the arena, or NULL (sets `p->enomem`).
+ */
 static void* a_alloc(pctx_t* p, size_t n){
-  if (p->arena_used + n > p->arena_cap) return NULL;
-  void* r = p->arena + p->arena_used; p->arena_used += n; return r;
+  bjson_enc_ctx_t* c = p->ctx;
+  n = (n + 7) & ~(size_t)7;
+  if (c->blk_used + n > c->blk_cap){
+    bjson_arena_chunk_t* nx = c->cur_chunk ? c->cur_chunk->next : c->chunks;
+    if (!nx || nx->cap < n){
+      if (!c->al.alloc){ p->enomem=1; return NULL; }
+      size_t cap = c->al.chunk ? c->al.chunk : ARENA_CAP;
+      if (cap < n) cap = n;
+      nx = (bjson_arena_chunk_t*)c->al.alloc(sizeof(bjson_arena_chunk_t) + cap, c->al.user);
+      if (!nx){ p->enomem=1; return NULL; }
+      nx->cap = cap; c->grown += cap;
+      if (c->cur_chunk){ nx->next = c->cur_chunk->next; c->cur_chunk->next = nx; }
+      else { nx->next = c->chunks; c->chunks = nx; }
+    }
+    c->cur_chunk = nx; c->blk = (uint8_t*)(nx + 1); c->blk_cap = nx->cap; c->blk_used = 0;
+  }
+  void* r = c->blk + c->blk_used; c->blk_used += n; c->used += n;
+  if (c->used > c->high_water) c->high_water = c->used;
+  return r;
 }
-static char* a_dup(pctx_t* p, const char* s, size_t n){
-  char* r = (char*)a_alloc(p, n+1); if(!r) return NULL; memcpy(r,s,n); r[n]=0; return r;
+
+/** @brief Value of a hex digit, or -1. */
+int enc_hex(int c){
+  if ((unsigned)(c - '0') < 10u) return c - '0';
+  if ((unsigned)((c | 0x20) - 'a') < 6u) return (c | 0x20) - 'a' + 10;
+  return -1;
 }
 
 /**
- * @brief Parse a string or unquoted identifier and duplicate into arena.
+ * @brief UTF-8 encoding of a code point (no surrogates, <= 0x10FFFF).
  *
- * Handles quoted strings with simple escape skipping. For unquoted
- * identifiers it accepts [A-Za-z_][A-Za-z0-9_]*.
+ * @param cp Code point.
+ * @param u[out] 1 to 4 bytes.
+ * @return Number of bytes.
+ */
+int enc_utf8(uint32_t cp, uint8_t* u){
+  if (cp < 0x80){ u[0]=(uint8_t)cp; return 1; }
+  if (cp < 0x800){ u[0]=(uint8_t)(0xC0 | cp>>6); u[1]=(uint8_t)(0x80 | (cp & 0x3F)); return 2; }
+  if (cp < 0x10000){ u[0]=(uint8_t)(0xE0 | cp>>12); u[1]=(uint8_t)(0x80 | ((cp>>6) & 0x3F)); u[2]=(uint8_t)(0x80 | (cp & 0x3F)); return 3; }
+  u[0]=(uint8_t)(0xF0 | cp>>18); u[1]=(uint8_t)(0x80 | ((cp>>12) & 0x3F));
+  u[2]=(uint8_t)(0x80 | ((cp>>6) & 0x3F)); u[3]=(uint8_t)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+/**
+ * @brief Byte a one-character escape stands for.
+ *
+ * @param c Character after the backslash.
+ * @return The byte, or -1 if `c` is not \" \\ \/ \b \f \n \r \t.
+ */
+int enc_esc_char(int c){
+  switch (c){
+    case '"': case '\\': case '/': return c;
+    case 'b': return '\b';
+    case 'f': return '\f';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    case 't': return '\t';
+    default:  return -1;
+  }
+}
+
+/** @brief Four hex digits at `s` (`n` bytes readable), or -1. */
+static long hex4(const char* s, size_t n){
+  long v = 0;
+  if (n < 4) return -1;
+  for (int k=0;k<4;k++){ int h = enc_hex((unsigned char)s[k]); if (h < 0) return -1; v = v<<4 | h; }
+  return v;
+}
+
+/**
+ * @brief Decode the escapes of a quoted string slice (slow path).
+ *
+ * Runs without a backslash are copied whole; \uXXXX becomes UTF-8, a
+ * surrogate pair one 4-byte sequence. Decoding never grows the text.
+ *
+ * @param s Slice between the quotes.
+ * @param n Slice length.
+ * @param dst Output (at least min(n, cap) bytes), or NULL to only measure.
+ * @param cap Most decoded bytes accepted.
+ * @return Decoded length, or -1 on a bad escape, a lone surrogate or
+ *         more than `cap` bytes.
+ */
+long enc_unescape(const char* s, size_t n, char* dst, size_t cap){
+  size_t i=0, o=0;
+  while (i < n){
+    const char* bs = (const char*)memchr(s+i, '\\', n-i);
+    size_t run = bs ? (size_t)(bs - (s+i)) : n-i;
+    if (run > cap - o) return -1;
+    if (dst) memcpy(dst+o, s+i, run);
+    o += run; i += run;
+    if (i >= n) break;
+    if (++i >= n) return -1;
+    int c = (unsigned char)s[i++];
+    long cp = enc_esc_char(c);
+    if (c == 'u'){
+      if ((cp = hex4(s+i, n-i)) < 0 || (cp >= 0xDC00 && cp <= 0xDFFF)) return -1;
+      i += 4;
+      if (cp >= 0xD800 && cp <= 0xDBFF){   // high surrogate: the low half must follow
+        long lo = (n-i >= 6 && s[i]=='\\' && s[i+1]=='u') ? hex4(s+i+2, 4) : -1;
+        if (lo < 0xDC00 || lo > 0xDFFF) return -1;
+        i += 6;
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+      }
+    } else if (cp < 0) return -1;
+    uint8_t u[4]; int k = enc_utf8((uint32_t)cp, u);
+    if ((size_t)k > cap - o) return -1;
+    if (dst) memcpy(dst+o, u, (size_t)k);
+    o += (size_t)k;
+  }
+  return (long)o;
+}
+
+/**
+ * @brief BJSON_ENC_F_UTF8 / BJSON_ENC_F_CPLIMIT checks of a decoded key or string.
+ *
+ * Text without a byte >= 0x80 leaves scan_utf8 a word/vector at a time;
+ * nothing is checked when neither flag is set.
+ *
+ * @param flags BJSON_ENC_F_* option bits.
+ * @param s Decoded bytes.
+ * @param n Length.
+ * @param limit STR_N code-point limit (BJSON_ENC_F_CPLIMIT), 0 for keys.
+ * @return BJSON_OK, BJSON_EUTF8 on malformed UTF-8, BJSON_ESYNTAX over the limit.
+ */
+bjson_err_t enc_check_text(uint32_t flags, const char* s, size_t n, size_t limit){
+  if (!(flags & (BJSON_ENC_F_UTF8 | BJSON_ENC_F_CPLIMIT))) return BJSON_OK;
+  if (scan_utf8(s, n) != n) return BJSON_EUTF8;
+  if ((flags & BJSON_ENC_F_CPLIMIT) && limit && n > limit && utf8_count(s, n) > limit) return BJSON_ESYNTAX;
+  return BJSON_OK;
+}
+
+/**
+ * @brief Run enc_check_text in the parser (sets `p->eutf8`).
+ *
+ * @return 1 if accepted, 0 otherwise.
+ */
+static int check_text(pctx_t* p, const char* s, size_t n, size_t limit){
+  bjson_err_t rc = enc_check_text(p->flags, s, n, limit);
+  if (rc == BJSON_EUTF8) p->eutf8 = 1;
+  return rc == BJSON_OK;
+}
+
+/**
+ * @brief Parse a string or unquoted identifier as a slice of the input.
+ *
+ * Runs between quotes/backslashes are skipped in one `scan_str` jump;
+ * escapes are only stepped over here and flagged in `*esc` for
+ * enc_unescape. For unquoted identifiers it accepts
+ * [A-Za-z_][A-Za-z0-9_]*. Nothing is copied; the slice points into
+ * `p->json`.
  *
  * @param p Parser context.
- * @param ok[out] Set to 1 on success, 0 on parse failure.
- * @return Pointer into arena containing NUL-terminated string on
- *         success, or NULL on allocation/parse error.
+ * @param s[out] Start of the string contents on success.
+ * @param n[out] Length of the string contents on success.
+ * @param esc[out] 1 if the slice contains a backslash escape.
+ * @return 1 on success, 0 on parse failure.
  */
-static char* parse_string(pctx_t* p, int* ok){
-  *ok=0; ws(p);
+static int parse_span(pctx_t* p, const char** s, size_t* n, int* esc){
+  ws(p);
+  *esc = 0;
   if (eat(p,'"')){ // quoted
     size_t start = p->pos;
     while (p->pos < p->len){
+      p->pos += scan_str(p->json + p->pos, p->len - p->pos);
+      if (p->pos >= p->len) break;
       char c = p->json[p->pos++];
-      if (c=='"'){ size_t n = (p->pos-1) - start; char* s=a_dup(p,&p->json[start],n); if(!s) return NULL; *ok=1; return s; }
-      if (c=='\\'){ if (p->pos>=p->len) return NULL; p->pos++; } // simple escape skip
+      if (c=='"'){ *s=&p->json[start]; *n=(p->pos-1) - start; return 1; }
+      if (c=='\\'){ if (p->pos>=p->len) return 0; p->pos++; *esc=1; } // decoded later (enc_unescape)
     }
-    return NULL;
+    return 0;
   }
   // unquoted identifier
-  if (!is_ident0(ch(p))) return NULL;
+  if (!enc_is_ident0(ch(p))) return 0;
   size_t start = p->pos++;
-  while (p->pos<p->len && is_ident(ch(p))) p->pos++;
-  *ok=1; return a_dup(p, &p->json[start], p->pos-start);
+  while (p->pos<p->len && enc_is_ident(ch(p))) p->pos++;
+  *s=&p->json[start]; *n=p->pos-start; return 1;
 }
 
 /**
- * @brief Parse an integer literal from the current position.
+ * @brief Decode an escaped key into the arena (AST) or `p->kbuf` (direct).
  *
- * Supports optional +/-, and returns 0 on parse failure.
+ * @param p Parser context.
+ * @param key Raw key slice.
+ * @param klen[in,out] Raw length in, decoded length out.
+ * @return Decoded key, or NULL on a bad escape, a NUL byte (key IDs
+ *         start with one), more than 255 bytes or a full arena.
+ */
+static const char* unescape_key(pctx_t* p, const char* key, size_t* klen){
+  long n = enc_unescape(key, *klen, NULL, sizeof(p->kbuf));
+  char* d = (n < 0) ? NULL : p->em ? p->kbuf : (char*)a_alloc(p, (size_t)n);
+  if (!d) return NULL;
+  enc_unescape(key, *klen, d, (size_t)n);
+  if (memchr(d, 0, (size_t)n)) return NULL;
+  *klen = (size_t)n;
+  return d;
+}
+
+/**
+ * @brief Scan a value token for a fixed-size type from the current position.
+ *
+ * The token is the maximal run accepted by enc_is_token; conversion and
+ * validation happen in enc_value_from_text (bjson_num.c).
  *
  * @param p Parser context.
- * @param out[out] Parsed integer on success.
- * @return 1 on success, 0 on failure.
+ * @param s[out] Token start (points into the input).
+ * @param n[out] Token length.
+ * @return 1 if a non-empty token was found, 0 otherwise.
  */
-static int parse_int(pctx_t* p, long long* out){
+static int parse_token(pctx_t* p, const char** s, size_t* n){
   ws(p);
-  size_t start = p->pos; int c=ch(p);
-  if (c=='-' || c=='+'){ p->pos++; }
-  if (!isdigit(ch(p))) return 0;
-  while (isdigit(ch(p))) p->pos++;
-  // no trailing alpha
-  size_t n = p->pos - start;
-  char buf[32]; if (n>=sizeof(buf)) return 0;
-  memcpy(buf, &p->json[start], n); buf[n]=0;
-  char* endp=NULL; long long v = strtoll(buf,&endp,10);
-  if (!endp || *endp!=0) return 0;
-  *out = v; return 1;
+  size_t start = p->pos;
+  while (p->pos<p->len && enc_is_token(ch(p))) p->pos++;
+  *s=&p->json[start]; *n=p->pos-start;
+  return *n > 0;
 }
 
-static int prefix_match(const char* key, const char* pref){ size_t k=strlen(pref); return strncmp(key,pref,k)==0; }
-
-static int classify_key(const char* key, ast_type_t* t, int* smax, int* isz){
-  if (prefix_match(key,"STR_32_"))  { *t=AST_T_STR; *smax=32;  return 1; }
-  if (prefix_match(key,"STR_64_"))  { *t=AST_T_STR; *smax=64;  return 1; }
-  if (prefix_match(key,"STR_128_")) { *t=AST_T_STR; *smax=128; return 1; }
-  if (prefix_match(key,"STR_256_")) { *t=AST_T_STR; *smax=256; return 1; }
-  if (prefix_match(key,"INT16_"))   { *t=AST_T_I16; *isz=2;    return 1; }
-  if (prefix_match(key,"UINT16_"))  { *t=AST_T_U16; *isz=2;    return 1; }
-  if (prefix_match(key,"INT32_"))   { *t=AST_T_I32; *isz=4;    return 1; }
-  if (prefix_match(key,"UINT32_"))  { *t=AST_T_U32; *isz=4;    return 1; }
-  return 0;
+/**
+ * @brief Classify a key through the type registry (bjson_types.h).
+ *
+ * @param key Key bytes.
+ * @param klen Key length.
+ * @param t[out] Wire type.
+ * @param param[out] STR_N byte limit (strings) or decimal scale (FIX types).
+ * @param isz[out] Value width in bytes (fixed-size types and packed elements).
+ * @return 1 if the key has a registered prefix (and a valid scale), 0 otherwise.
+ */
+int enc_classify_key(const char* key, size_t klen, bjd_type_t* t, int* param, int* isz){
+  const bjd_prefix_t* pr = bjd_classify_key(key, klen);
+  if (!pr) return 0;
+  const bjd_type_info_t* ti = bjd_type_info(BJD_ELEM_TYPE(pr->type));
+  *t = (bjd_type_t)pr->type; *param = pr->limit; *isz = ti->width;
+  if (ti->kind == BJD_K_FIX && (*param = bjd_key_scale(key, klen, pr)) < 0) return 0;
+  return 1;
 }
 
 static int push_kv(pctx_t* p, ast_kv_t kv){
@@ -116,12 +292,106 @@ static int push_kv(pctx_t* p, ast_kv_t kv){
   return 1;
 }
 
+static int parse_object(pctx_t* p, int* err);
+static int parse_array(pctx_t* p, int* err);
+
+/**
+ * @brief Parse a '{...}' or '[...]' value as a container entry.
+ *
+ * In AST mode the container is recorded as an open node, its children,
+ * and an AST_CLOSE node; in direct mode it is opened and closed on the
+ * writer around the children.
+ *
+ * @param p Parser context positioned at '{' or '['.
+ * @param key Container name ("" for array elements).
+ * @param klen Name length.
+ * @param err[out] Non-zero on error.
+ * @return 1 on success, 0 on parse, depth, output or allocation error.
+ */
+static int parse_container(pctx_t* p, const char* key, size_t klen, int* err){
+  uint8_t t = (ch(p)=='{') ? BJD_T_OBJ : BJD_T_ARR;
+  if (++p->depth > BJSON_ENC_DEPTH_MAX){ *err=1; return 0; }
+  if (p->em){
+    if (!emit_open(p->em, t, key, klen)){ p->ebuf=1; *err=1; return 0; }
+  } else {
+    ast_kv_t kv = {0}; kv.type=(bjd_type_t)t;
+    kv.key = key; kv.klen = (uint8_t)klen;
+    if (!push_kv(p, kv)){ *err=1; return 0; }
+  }
+  if (!(t==BJD_T_OBJ ? parse_object(p,err) : parse_array(p,err))) return 0;
+  p->depth--;
+  if (p->em){ emit_close(p->em); return 1; }
+  ast_kv_t kv = {0}; kv.type=AST_CLOSE;
+  if (!push_kv(p, kv)){ *err=1; return 0; }
+  return 1;
+}
+
 /**
- * @brief Parse a single object member (key:value) into the AST.
+ * @brief Parse '[' number (',' number)* ']' into a packed array entry.
  *
- * Validates key format via `classify_key` and performs range checks
- * for integer types. On allocation or parse error `*err` is set and
- * the function returns 0.
+ * Direct mode converts each element straight into the output. AST mode
+ * first bounds the element count by the commas before ']' so the
+ * elements can be stored in one arena block.
+ *
+ * @param p Parser context.
+ * @param t Packed wire type (BJD_T_ARR_*).
+ * @param key Key bytes.
+ * @param klen Key length.
+ * @param w Element width.
+ * @param err[out] Non-zero on error.
+ * @return 1 on success, 0 on parse, range, output or allocation error.
+ */
+static int parse_packed(pctx_t* p, bjd_type_t t, const char* key, size_t klen, int w, int* err){
+  if (!eat(p,'[')){ *err=1; return 0; }
+  uint8_t* dat; size_t cap;
+  if (p->em){
+    bjson_emit_t* e = p->em;
+    if ((size_t)(e->end-e->cur) < 8 + klen){ p->ebuf=1; *err=1; return 0; }
+    memcpy(e->cur+8, key, klen);
+    klen = (size_t)emit_key_id(e, (uint8_t)klen);
+    if (!(dat = emit_packed_data(e, (uint8_t)klen, w))){ p->ebuf=1; *err=1; return 0; }
+    cap = (size_t)(e->end - dat) / (size_t)w;
+  } else {
+    cap = 1;
+    for (size_t q=p->pos; q<p->len && p->json[q]!=']'; q++) cap += (p->json[q]==',');
+    if (!(dat = (uint8_t*)a_alloc(p, cap*(size_t)w))){ *err=1; return 0; }
+  }
+  uint32_t n=0;
+  ws(p);
+  if (!eat(p,']')){
+    for(;;){
+      const char* tok; size_t tlen; uint64_t raw;
+      if (!parse_token(p,&tok,&tlen) || !enc_value_from_text((bjd_type_t)BJD_ELEM_TYPE(t), 0, tok, tlen, &raw)){ *err=1; return 0; }
+      if (n >= cap || n == UINT32_MAX){ p->ebuf = (p->em != NULL); *err=1; return 0; }
+      enc_put_le(dat + (size_t)n*(size_t)w, w, raw); n++;
+      if (eat(p,']')) break;
+      if (!eat(p,',')){ *err=1; return 0; }
+    }
+  }
+  if (p->em){
+    if (!emit_commit_packed(p->em, (uint8_t)t, (uint8_t)klen, w, n)){ p->ebuf=1; *err=1; return 0; }
+    return 1;
+  }
+  ast_kv_t kv = {0}; kv.type=t; kv.isz=w; kv.sval=(const char*)dat; kv.slen=n;
+  kv.key = key; kv.klen = (uint8_t)klen;
+  if (!push_kv(p, kv)){ *err=1; return 0; }
+  return 1;
+}
+
+/**
+ * @brief Parse a single object member (key:value).
+ *
+ * An ARR_* key takes a packed array of numbers; otherwise a '{' or '['
+ * value makes the member a container (any key name), and the key format is validated via `enc_classify_key` and
+ * fixed-size values are converted with `enc_value_from_text` (range
+ * checked). Keys and strings without escapes stay slices of the input
+ * (the AST points at them, direct mode copies them once into the
+ * output); escaped ones are decoded on the side, into the arena or, in
+ * direct mode, straight into the output. STR_N limits count decoded
+ * bytes, or code points with BJSON_ENC_F_CPLIMIT; strict UTF-8 checks
+ * (check_text) also run on the decoded text.
+ * On allocation, output or parse error `*err` is set and the function
+ * returns 0.
  *
  * @param p Parser context.
  * @param err[out] Non-zero on error.
@@ -129,31 +399,62 @@ static int push_kv(pctx_t* p, ast_kv_t kv){
  */
 static int parse_member(pctx_t* p, int* err){
   *err=0;
-  int ok=0; char* key = parse_string(p,&ok); if (!ok || !key){ *err=1; return 0; }
+  const char* key; size_t klen; int esc;
+  if (!parse_span(p,&key,&klen,&esc)){ *err=1; return 0; }
+  if (esc && !(key = unescape_key(p, key, &klen))){ *err=1; return 0; }
+  if (klen > 255 || !check_text(p, key, klen, 0)){ *err=1; return 0; }
   if (!eat(p,':')){ *err=1; return 0; }
 
-  ast_type_t t=0; int smax=0, isz=0;
-  if (!classify_key(key,&t,&smax,&isz)){ *err=1; return 0; }
-
-  ast_kv_t kv = {0}; kv.type=t; kv.key=key; kv.smax=smax; kv.isz=isz;
+  bjd_type_t t=0; int param=0, isz=0;
+  int known = enc_classify_key(key,klen,&t,&param,&isz);
+  ws(p);
+  if (known && BJD_IS_PACKED(t)) return parse_packed(p, t, key, klen, isz, err);
+  if (ch(p)=='{' || ch(p)=='[') return parse_container(p, key, klen, err);
+  if (!known){ *err=1; return 0; }
 
-  if (t==AST_T_STR){
-    int ok2=0; char* sval = parse_string(p,&ok2);
-    if (!ok2 || !sval){ *err=1; return 0; }
-    // UTF-8 바이트 수 기준
-    if ((int)strlen(sval) > smax){ *err=1; return 0; }
-    kv.sval = sval;
+  const char* sval=NULL; size_t slen=0; uint64_t raw=0; long dlen=-1;
+  if (t==BJD_T_STR){
+    if (!parse_span(p,&sval,&slen,&esc)){ *err=1; return 0; }
+    // UTF-8 바이트 수 기준 (escape 해제 후), CPLIMIT이면 code point 수로 다시 확인
+    size_t bmax = ENC_STR_BYTES(p->flags, param);
+    if (esc ? (dlen = enc_unescape(sval, slen, NULL, bmax)) < 0 : slen > bmax){ *err=1; return 0; }
+    if (!esc && !check_text(p, sval, slen, (size_t)param)){ *err=1; return 0; }
   } else {
-    long long v=0; if (!parse_int(p,&v)){ *err=1; return 0; }
-    // 범위 체크
-    switch (t){
-      case AST_T_I16: if (v < -32768 || v > 32767) { *err=1; return 0; } break;
-      case AST_T_U16: if (v < 0 || v > 65535)      { *err=1; return 0; } break;
-      case AST_T_I32: if (v < (long long)INT32_MIN || v > (long long)INT32_MAX) { *err=1; return 0; } break;
-      case AST_T_U32: if (v < 0 || v > 0xFFFFFFFFLL){ *err=1; return 0; } break;
-      default: break;
+    const char* tok; size_t tlen;
+    // 변환 + 범위 체크
+    if (!parse_token(p,&tok,&tlen) || !enc_value_from_text(t, param, tok, tlen, &raw)){ *err=1; return 0; }
+  }
+
+  if (p->em){ // direct emit
+    uint8_t iv[8];
+    bjson_emit_t* e = p->em;
+    if (dlen >= 0){ // escaped string: decode in place after the stored name
+      if ((size_t)(e->end-e->cur) < 8 + klen){ p->ebuf=1; *err=1; return 0; }
+      memcpy(e->cur+8, key, klen);
+      uint8_t nl = (uint8_t)emit_key_id(e, (uint8_t)klen);
+      if ((size_t)(e->end-e->cur-8-nl) < (size_t)dlen){ p->ebuf=1; *err=1; return 0; }
+      enc_unescape(sval, slen, (char*)e->cur+8+nl, (size_t)dlen);
+      if (!check_text(p, (const char*)e->cur+8+nl, (size_t)dlen, (size_t)param)){ *err=1; return 0; }
+      if (!emit_commit_str(e, nl, (uint32_t)dlen, (uint32_t)ENC_STR_BYTES(e->flags, param))){ p->ebuf=1; *err=1; return 0; }
+      return 1;
+    }
+    int ok = (t==BJD_T_STR) ? emit_str(p->em, key, klen, sval, (uint32_t)slen, (uint32_t)ENC_STR_BYTES(p->em->flags, param))
+                            : (enc_put_le(iv, isz, raw), emit_entry(p->em, (uint8_t)t, key, klen, iv, (uint32_t)isz));
+    if (!ok){ p->ebuf=1; *err=1; return 0; }
+    return 1;
+  }
+
+  ast_kv_t kv = {0}; kv.type=t; kv.param=param; kv.isz=isz; kv.raw=raw;
+  kv.key = key; kv.klen = (uint8_t)klen;
+  if (t==BJD_T_STR){
+    kv.sval = sval; kv.slen = (uint32_t)slen;
+    if (dlen >= 0){
+      char* d = (char*)a_alloc(p, (size_t)dlen);
+      if (!d){ *err=1; return 0; }
+      enc_unescape(sval, slen, d, (size_t)dlen);
+      if (!check_text(p, d, (size_t)dlen, (size_t)param)){ *err=1; return 0; }
+      kv.sval = d; kv.slen = (uint32_t)dlen;
     }
-    kv.iv = v;
   }
   if (!push_kv(p, kv)){ *err=1; return 0; }
   return 1;
@@ -182,83 +483,166 @@ static int parse_object(pctx_t* p, int* err){
   return 1;
 }
 
+/**
+ * @brief Parse an array of containers ('[' ({...}|[...]) (',' ...)* ']').
+ *
+ * Elements are unnamed container entries; scalars need a key prefix to
+ * be typed, so they go in packed typed arrays instead.
+ *
+ * @param p Parser context.
+ * @param err[out] Non-zero on parse error.
+ * @return 1 on success, 0 on failure.
+ */
+static int parse_array(pctx_t* p, int* err){
+  if (!eat(p,'[')){ *err=1; return 0; }
+  ws(p);
+  if (eat(p,']')) return 1; // empty
+  for(;;){
+    ws(p);
+    if (ch(p)!='{' && ch(p)!='['){ *err=1; return 0; }
+    if (!parse_container(p, "", 0, err)) return 0;
+    ws(p);
+    if (eat(p,']')) break;
+    if (!eat(p,',')){ *err=1; return 0; }
+  }
+  return 1;
+}
+
 /* --------- Encoder (AST→BJSON) --------- */
-static void w32(uint8_t* p, uint32_t v){ p[0]=v&0xFF; p[1]=(v>>8)&0xFF; p[2]=(v>>16)&0xFF; p[3]=(v>>24)&0xFF; }
-static int  align4sz(int n){ return (n+3)&~3; }
 
 /**
  * @brief Encode the parser AST into the BJSON binary format.
  *
- * Writes header, entry count and each key/value encoded and 4-byte
- * padded. Returns 1 on success.
+ * Replays the AST through the shared writer (bjson_emit.c): header,
+ * each key/value 4-byte padded (containers opened and closed around
+ * their children), then the optional sections requested in
+ * `flags`. Returns 1 on success.
  *
  * @param p Parser context with built AST.
+ * @param flags BJSON_ENC_F_* option bits.
  * @param out Output buffer to write BJSON data.
  * @param cap Capacity of the output buffer.
  * @param out_len[out] Number of bytes written on success.
  * @return 1 on success, 0 if buffer is not large enough.
  */
-static int encode_ast(const pctx_t* p, uint8_t* out, size_t cap, size_t* out_len){
-  uint8_t* cur=out; uint8_t* end=out+cap;
-  if (cur+12 > end) return 0;
-  memcpy(cur,"BJSN",4); cur+=4;
-  *cur++=1; *cur++=1; *cur++=0; *cur++=0;
-  uint8_t* cntp=cur; cur+=4;
-
-  uint32_t cnt=0;
+static int encode_ast(const pctx_t* p, uint32_t flags, uint8_t* out, size_t cap, size_t* out_len){
+  bjson_emit_t e;
+  if (!emit_begin(&e, flags, out, cap)) return 0;
+  if (p->dict && !emit_dict(&e, p->dict, p->dict->hash)) return 0;
   for (const ast_kv_t* kv=p->head; kv; kv=kv->next){
-    uint8_t type=0; uint32_t vlen=0;
-    switch (kv->type){
-      case AST_T_STR: type=1; vlen=(uint32_t)strlen(kv->sval); break;
-      case AST_T_I16: type=2; vlen=2; break;
-      case AST_T_U16: type=3; vlen=2; break;
-      case AST_T_I32: type=4; vlen=4; break;
-      case AST_T_U32: type=5; vlen=4; break;
-    }
-    uint8_t nlen = (uint8_t)strlen(kv->key);
-    int need = 1+1+2+4 + nlen + vlen;
-    int need_al = align4sz(need);
-    if (cur + need_al > end) return 0;
-
-    *cur++ = type;
-    *cur++ = nlen;
-    *cur++ = 0; *cur++ = 0;
-    w32(cur, vlen); cur+=4;
-    memcpy(cur, kv->key, nlen); cur+=nlen;
-
-    if (type==1){
-      memcpy(cur, kv->sval, vlen); cur+=vlen;
+    if (kv->type==AST_CLOSE){
+      emit_close(&e);
+    } else if (kv->type==BJD_T_OBJ || kv->type==BJD_T_ARR){
+      if (!emit_open(&e, (uint8_t)kv->type, kv->key, kv->klen)) return 0;
+    } else if (BJD_IS_PACKED(kv->type)){
+      if (!emit_packed(&e, (uint8_t)kv->type, kv->key, kv->klen, kv->isz, kv->sval, kv->slen)) return 0;
+    } else if (kv->type==BJD_T_STR){
+      if (!emit_str(&e, kv->key, kv->klen, kv->sval, kv->slen, (uint32_t)ENC_STR_BYTES(e.flags, kv->param))) return 0;
     } else {
-      if (kv->isz==2){ uint16_t v = (uint16_t)kv->iv; *cur++=v&0xFF; *cur++=(v>>8)&0xFF; }
-      else { uint32_t v=(uint32_t)kv->iv; *cur++=v&0xFF; *cur++=(v>>8)&0xFF; *cur++=(v>>16)&0xFF; *cur++=(v>>24)&0xFF; }
+      uint8_t v[8]; enc_put_le(v, kv->isz, kv->raw);
+      if (!emit_entry(&e, (uint8_t)kv->type, kv->key, kv->klen, v, (uint32_t)kv->isz)) return 0;
     }
-    while (((uintptr_t)cur & 3)!=0) *cur++=0;
-    cnt++;
   }
-  w32(cntp, cnt);
-  *out_len = (size_t)(cur - out);
-  return 1;
+  return emit_end(&e, out_len);
 }
 
 /* --------- Public API --------- */
+static void* std_alloc(size_t n, void* user){ (void)user; return malloc(n); }
+static void  std_free(void* ptr, void* user){ (void)user; free(ptr); }
+
+/**
+ * @brief Initialize a reusable encoder context.
+ *
+ * @param ctx Context to initialize.
+ * @param arena Caller-owned first arena block (8-byte aligned), or NULL.
+ * @param arena_cap Size of `arena` in bytes.
+ * @param al Optional growth hooks (copied), or NULL for a fixed arena.
+ */
+void bjson_enc_ctx_init(bjson_enc_ctx_t* ctx, void* arena, size_t arena_cap, const bjson_alloc_t* al){
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->base = (uint8_t*)arena; ctx->cap = arena ? arena_cap : 0;
+  if (al) ctx->al = *al;
+}
+
+/**
+ * @brief Free every chunk grown through the allocator hooks.
+ *
+ * The caller block is not touched; the context can be used again.
+ *
+ * @param ctx Context.
+ */
+void bjson_enc_ctx_release(bjson_enc_ctx_t* ctx){
+  while (ctx->chunks){
+    bjson_arena_chunk_t* nx = ctx->chunks->next;
+    if (ctx->al.free) ctx->al.free(ctx->chunks, ctx->al.user);
+    ctx->chunks = nx;
+  }
+  ctx->cur_chunk = NULL; ctx->grown = 0;
+}
+
 bjson_err_t bjson_encode_from_json(const char* json, uint8_t* out, size_t out_cap, size_t* out_len){
-  if (!json || !out || !out_len) return BJSON_EINVAL;
+  return bjson_encode_from_json_ex(json, NULL, out, out_cap, out_len);
+}
+
+bjson_err_t bjson_encode_from_json_ex(const char* json, const bjson_enc_opts_t* opts,
+                                      uint8_t* out, size_t out_cap, size_t* out_len){
+  bjson_alloc_t al = { std_alloc, std_free, NULL, ARENA_CAP };
+  bjson_enc_ctx_t ctx;
+  bjson_enc_ctx_init(&ctx, NULL, 0, &al);
+  bjson_err_t rc = bjson_encode_ctx(&ctx, json, opts, out, out_cap, out_len);
+  bjson_enc_ctx_release(&ctx);
+  return rc;
+}
+
+/**
+ * @brief Encode JSON text using a reusable context.
+ *
+ * The arena is rewound at the start of each call; `ctx->used` and
+ * `ctx->high_water` report its use. Direct mode (BJSON_ENC_F_DIRECT)
+ * does not touch the arena.
+ *
+ * @param ctx Context from bjson_enc_ctx_init.
+ * @param json NUL-terminated JSON text.
+ * @param opts Encoder options, may be NULL.
+ * @param out Output buffer.
+ * @param out_cap Capacity of `out`.
+ * @param out_len[out] Encoded length on success.
+ * @return BJSON_OK or an error; BJSON_ENOMEM when the arena cannot hold
+ *         the document.
+ */
+bjson_err_t bjson_encode_ctx(bjson_enc_ctx_t* ctx, const char* json, const bjson_enc_opts_t* opts,
+                             uint8_t* out, size_t out_cap, size_t* out_len){
+  if (!ctx || !json || !out || !out_len) return BJSON_EINVAL;
+  uint32_t flags = opts ? opts->flags : 0;
   pctx_t c = {0};
-  c.json = json; c.len = strlen(json);
-  c.arena_cap = ARENA_CAP;
-  c.arena = (char*)malloc(ARENA_CAP);
-  if (!c.arena) return BJSON_EBUF;
+  c.json = json; c.len = strlen(json); c.ctx = ctx; c.dict = opts ? opts->dict : NULL; c.flags = flags;
+
+  if (flags & BJSON_ENC_F_DIRECT){
+    // single pass: entries are written while parsing, count patched in emit_end
+    bjson_emit_t em;
+    if (!emit_begin(&em, flags, out, out_cap)) return BJSON_EBUF;
+    if (c.dict && !emit_dict(&em, c.dict, c.dict->hash)) return BJSON_EBUF;
+    c.em = &em;
+    int err=0;
+    ws(&c);
+    if (!parse_object(&c,&err)) return c.ebuf ? BJSON_EBUF : c.eutf8 ? BJSON_EUTF8 : (err?BJSON_ESYNTAX:BJSON_EINVAL);
+    ws(&c);
+    if (c.pos != c.len) return BJSON_ESYNTAX;
+    return emit_end(&em, out_len) ? BJSON_OK : BJSON_EBUF;
+  }
+
+  // rewind the arena to the caller block
+  ctx->cur_chunk = NULL; ctx->blk = ctx->base; ctx->blk_cap = ctx->cap; ctx->blk_used = 0; ctx->used = 0;
+  if (ctx->blk) ctx->blk_used = (size_t)(-(uintptr_t)ctx->blk & 7);
 
   int err=0;
   ws(&c);
-  if (!parse_object(&c,&err)){ free(c.arena); return err?BJSON_ESYNTAX:BJSON_EINVAL; }
+  if (!parse_object(&c,&err)) return c.enomem ? BJSON_ENOMEM : c.eutf8 ? BJSON_EUTF8 : (err?BJSON_ESYNTAX:BJSON_EINVAL);
   ws(&c);
-  if (c.pos != c.len){ free(c.arena); return BJSON_ESYNTAX; }
+  if (c.pos != c.len) return BJSON_ESYNTAX;
 
   size_t olen=0;
-  int ok = encode_ast(&c, out, out_cap, &olen);
-  free(c.arena);
-  if (!ok) return BJSON_EBUF;
+  if (!encode_ast(&c, flags, out, out_cap, &olen)) return BJSON_EBUF;
   *out_len = olen;
   return BJSON_OK;
 }
@@ -0,0 +1,445 @@
+#include "bjson_enc.h"
+#include "bjson_enc_internal.h"
+#include "bjson.h"
+#include <string.h>
+#include <math.h>
+
+/*
+ * CBOR (RFC 8949) / MessagePack -> BJSON, one pass, no JSON text hop.
+ *
+ * The input is read one item head at a time and every member goes
+ * straight through the writer (bjson_emit.c), as in the direct JSON
+ * encoder: no AST, no arena, nothing allocated. Keys get the JSON key
+ * rules (enc_classify_key, at most 255 bytes, no NUL) and values the
+ * same conversions and range checks as their text tokens:
+ *
+ *   map                      object (root: the document)
+ *   array                    ARR_* key: packed array of numbers,
+ *                            else an array of maps/arrays
+ *   text string              STR_N value (limit in bytes, or code
+ *                            points with BJSON_ENC_F_CPLIMIT)
+ *   integer                  INT/UINT/FIX exact, FLOAT rounded
+ *   float16/32/64            FLOAT rounded to the width, FIX rounded
+ *   tag 4 decimal fraction   as the decimal text (exact for FIX)
+ *   true / false             BOOL
+ *
+ * CBOR indefinite-length maps, arrays and text strings are accepted;
+ * other tags are skipped (the tagged item stands for itself). Byte
+ * strings, null, undefined, simple values and MessagePack bin/ext have
+ * no BJSON type and are rejected, like a JSON value without one.
+ */
+
+enum { BIN_CBOR, BIN_MSGPACK };
+enum { BI_INT, BI_FLOAT, BI_DEC, BI_STR, BI_MAP, BI_ARR, BI_BOOL, BI_BREAK, BI_OTHER };
+
+#define BIN_INDEF UINT32_MAX   // CBOR indefinite length (items until a break)
+#define BIN_DEC_EXP_MAX 40     // decimal fraction exponents kept within a value token
+
+/** Head of one input item. */
+typedef struct {
+  uint8_t  kind;       // BI_*
+  uint8_t  neg;        // BI_INT / BI_DEC: sign
+  uint64_t u;          // BI_INT / BI_DEC: magnitude; BI_BOOL: 0/1
+  int      e10;        // BI_DEC: value = +-u * 10^e10
+  double   f;          // BI_FLOAT
+  const uint8_t* s;    // BI_STR: bytes (definite length)
+  uint32_t n;          // BI_STR length, BI_MAP/BI_ARR count, or BIN_INDEF
+} bin_item_t;
+
+/** Transcoder state (on the caller's stack; no allocation). */
+typedef struct {
+  const uint8_t* p; const uint8_t* end;
+  uint8_t  fmt;        // BIN_CBOR / BIN_MSGPACK
+  bjson_emit_t* em;
+  uint32_t flags;      // BJSON_ENC_F_UTF8 / _CPLIMIT
+  int      depth;      // open containers below the root object
+  bjson_err_t rc;      // first error
+  char     kbuf[255];  // CBOR indefinite-length key, joined
+} xc_t;
+
+/** @brief Record the first error; returns 0 for `return xc_fail(...)`. */
+static int xc_fail(xc_t* x, bjson_err_t rc){ if (!x->rc) x->rc = rc; return 0; }
+
+/** @brief `n` bytes big-endian, 0 if the input ends first. */
+static int rd_be(xc_t* x, int n, uint64_t* v){
+  if (x->end - x->p < n) return 0;
+  uint64_t r = 0;
+  for (int k=0; k<n; k++) r = r << 8 | x->p[k];
+  x->p += n; *v = r;
+  return 1;
+}
+
+/** @brief Take `n` payload bytes, 0 if the input ends first. */
+static int rd_take(xc_t* x, uint64_t n, const uint8_t** s){
+  if (n > (uint64_t)(x->end - x->p)) return 0;
+  *s = x->p; x->p += n;
+  return 1;
+}
+
+/** @brief IEEE half to double. */
+static double half_to_double(unsigned h){
+  int e = (h >> 10) & 0x1F; unsigned m = h & 0x3FF;
+  double v = !e ? ldexp(m, -24) : e == 31 ? (m ? NAN : INFINITY) : ldexp(m + 1024, e - 25);
+  return (h & 0x8000) ? -v : v;
+}
+
+static int cbor_item(xc_t* x, bin_item_t* it, int in_dec);
+
+/**
+ * @brief Body of a tag 4 decimal fraction: [exponent, mantissa].
+ *
+ * Both must be plain integers (no bignums, no nested tags); exponents
+ * past BIN_DEC_EXP_MAX make an item no type accepts.
+ */
+static int cbor_decfrac(xc_t* x, bin_item_t* it){
+  bin_item_t a, e, m;
+  if (!cbor_item(x, &a, 1) || a.kind != BI_ARR || a.n != 2) return 0;
+  if (!cbor_item(x, &e, 1) || e.kind != BI_INT || !cbor_item(x, &m, 1) || m.kind != BI_INT) return 0;
+  if (e.u > BIN_DEC_EXP_MAX){ it->kind = BI_OTHER; return 1; }
+  it->kind = BI_DEC; it->neg = m.neg; it->u = m.u; it->e10 = e.neg ? -(int)e.u : (int)e.u;
+  return 1;
+}
+
+/**
+ * @brief Read one CBOR item head (strings: the whole definite string).
+ *
+ * @param x State.
+ * @param it[out] Item.
+ * @param in_dec Inside a decimal fraction: no further tags.
+ * @return 1 on success, 0 on malformed or truncated input.
+ */
+static int cbor_item(xc_t* x, bin_item_t* it, int in_dec){
+  for (;;){
+    if (x->p >= x->end) return 0;
+    int b = *x->p++, mt = b >> 5, ai = b & 31;
+    uint64_t v = 0;
+    if (mt == 7){
+      switch (ai){
+        case 20: case 21: it->kind = BI_BOOL; it->u = (ai == 21); return 1;
+        case 25: if (!rd_be(x, 2, &v)) return 0; it->kind = BI_FLOAT; it->f = half_to_double((unsigned)v); return 1;
+        case 26: { if (!rd_be(x, 4, &v)) return 0; uint32_t w = (uint32_t)v; float f; memcpy(&f, &w, 4); it->kind = BI_FLOAT; it->f = f; return 1; }
+        case 27: if (!rd_be(x, 8, &v)) return 0; it->kind = BI_FLOAT; memcpy(&it->f, &v, 8); return 1;
+        case 31: it->kind = BI_BREAK; return 1;
+        case 28: case 29: case 30: return 0;
+        default: if (ai == 24 && !rd_be(x, 1, &v)) return 0; it->kind = BI_OTHER; return 1;   // null, undefined, simple
+      }
+    }
+    if (ai == 31){   // indefinite length
+      if (mt < 2 || mt == 6) return 0;
+      it->kind = mt == 3 ? BI_STR : mt == 4 ? BI_ARR : mt == 5 ? BI_MAP : BI_OTHER;
+      it->n = BIN_INDEF; it->s = NULL;
+      return 1;
+    }
+    if (ai > 27 || (ai >= 24 && !rd_be(x, 1 << (ai - 24), &v))) return 0;
+    if (ai < 24) v = (uint64_t)ai;
+    switch (mt){
+      case 0: it->kind = BI_INT; it->neg = 0; it->u = v; return 1;
+      case 1:   // -1 - v; -2^64 fits no type
+        if (v == UINT64_MAX){ it->kind = BI_OTHER; return 1; }
+        it->kind = BI_INT; it->neg = 1; it->u = v + 1; return 1;
+      case 2: case 3:
+        if (!rd_take(x, v, &it->s)) return 0;
+        it->kind = (mt == 3) ? BI_STR : BI_OTHER; it->n = (uint32_t)v;
+        return 1;
+      case 4: case 5:   // every member takes at least one byte
+        if (v > (uint64_t)(x->end - x->p)) return 0;
+        it->kind = (mt == 4) ? BI_ARR : BI_MAP; it->n = (uint32_t)v;
+        return 1;
+      default:
+        if (in_dec) return 0;
+        if (v == 4) return cbor_decfrac(x, it);
+        break;   // any other tag: read the tagged item
+    }
+  }
+}
+
+/**
+ * @brief Read one MessagePack item head (strings: the whole string).
+ *
+ * @return 1 on success, 0 on malformed or truncated input.
+ */
+static int mp_item(xc_t* x, bin_item_t* it){
+  if (x->p >= x->end) return 0;
+  int b = *x->p++;
+  uint64_t v = 0;
+  const uint8_t* skip;
+  if (b < 0x80){ it->kind = BI_INT; it->neg = 0; it->u = (uint64_t)b; return 1; }
+  if (b >= 0xe0){ it->kind = BI_INT; it->neg = 1; it->u = (uint64_t)(256 - b); return 1; }
+  if (b < 0xa0){
+    v = (uint64_t)(b & 15);
+    if (v > (uint64_t)(x->end - x->p)) return 0;
+    it->kind = (b < 0x90) ? BI_MAP : BI_ARR; it->n = (uint32_t)v;
+    return 1;
+  }
+  if (b < 0xc0){ it->kind = BI_STR; it->n = (uint32_t)(b & 31); return rd_take(x, it->n, &it->s); }
+  switch (b){
+    case 0xc0: it->kind = BI_OTHER; return 1;   // nil
+    case 0xc2: case 0xc3: it->kind = BI_BOOL; it->u = (b == 0xc3); return 1;
+    case 0xc4: case 0xc5: case 0xc6:   // bin 8/16/32
+      it->kind = BI_OTHER;
+      return rd_be(x, 1 << (b - 0xc4), &v) && rd_take(x, v, &skip);
+    case 0xc7: case 0xc8: case 0xc9:   // ext 8/16/32: length, type, data
+      it->kind = BI_OTHER;
+      return rd_be(x, 1 << (b - 0xc7), &v) && rd_take(x, v + 1, &skip);
+    case 0xca: { if (!rd_be(x, 4, &v)) return 0; uint32_t w = (uint32_t)v; float f; memcpy(&f, &w, 4); it->kind = BI_FLOAT; it->f = f; return 1; }
+    case 0xcb: if (!rd_be(x, 8, &v)) return 0; it->kind = BI_FLOAT; memcpy(&it->f, &v, 8); return 1;
+    case 0xcc: case 0xcd: case 0xce: case 0xcf:
+      if (!rd_be(x, 1 << (b - 0xcc), &v)) return 0;
+      it->kind = BI_INT; it->neg = 0; it->u = v;
+      return 1;
+    case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+      int n = 1 << (b - 0xd0);
+      if (!rd_be(x, n, &v)) return 0;
+      if (n < 8 && (v >> (8*n - 1))) v |= ~0ull << (8*n);   // sign-extend
+      it->kind = BI_INT; it->neg = (int64_t)v < 0; it->u = it->neg ? 0 - v : v;
+      return 1;
+    }
+    case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:   // fixext 1..16: type, data
+      it->kind = BI_OTHER;
+      return rd_take(x, 1 + (1u << (b - 0xd4)), &skip);
+    case 0xd9: case 0xda: case 0xdb:
+      if (!rd_be(x, 1 << (b - 0xd9), &v)) return 0;
+      it->kind = BI_STR; it->n = (uint32_t)v;
+      return rd_take(x, v, &it->s);
+    case 0xdc: case 0xdd: case 0xde: case 0xdf:
+      if (!rd_be(x, (b & 1) ? 4 : 2, &v) || v > (uint64_t)(x->end - x->p)) return 0;
+      it->kind = (b < 0xde) ? BI_ARR : BI_MAP; it->n = (uint32_t)v;
+      return 1;
+    default: return 0;   // 0xc1 (never used)
+  }
+}
+
+static int rd_item(xc_t* x, bin_item_t* it){
+  return x->fmt == BIN_CBOR ? cbor_item(x, it, 0) : mp_item(x, it);
+}
+
+/** @brief Past the end of an indefinite-length container (consumes the break). */
+static int at_break(xc_t* x){
+  if (x->p < x->end && *x->p == 0xff){ x->p++; return 1; }
+  return 0;
+}
+
+/**
+ * @brief Decimal text of a decimal fraction (the JSON token it stands for).
+ *
+ * @param it BI_DEC item.
+ * @param tok[out] At least BJSON_ENC_TOKEN_MAX bytes.
+ * @return Token length.
+ */
+static size_t dec_text(const bin_item_t* it, char* tok){
+  char d[20]; int nd = 0; size_t n = 0;
+  uint64_t u = it->u;
+  do { d[nd++] = (char)('0' + u % 10); u /= 10; } while (u);
+  if (it->neg) tok[n++] = '-';
+  int k = -it->e10;   // digits after the point
+  if (k <= 0){
+    while (nd) tok[n++] = d[--nd];
+    for (; k < 0; k++) tok[n++] = '0';
+  } else {
+    if (nd <= k){ tok[n++] = '0'; tok[n++] = '.'; for (int z = nd; z < k; z++) tok[n++] = '0'; }
+    while (nd){ if (nd == k && n && tok[n-1] != '.') tok[n++] = '.'; tok[n++] = d[--nd]; }
+  }
+  return n;
+}
+
+/**
+ * @brief Wire bits of a fixed-size value (see the mapping above).
+ *
+ * @return 1 on success, 0 on a type mismatch or out-of-range value.
+ */
+static int item_value(const bin_item_t* it, bjd_type_t t, int scale, uint64_t* raw){
+  char tok[BJSON_ENC_TOKEN_MAX];
+  switch (it->kind){
+    case BI_INT:   return enc_value_from_int(t, scale, it->neg, it->u, raw);
+    case BI_FLOAT: return enc_value_from_double(t, scale, it->f, raw);
+    case BI_DEC:   return enc_value_from_text(t, scale, tok, dec_text(it, tok), raw);
+    case BI_BOOL:  return enc_value_from_text(t, scale, it->u ? "true" : "false", it->u ? 4 : 5, raw);
+    default:       return 0;
+  }
+}
+
+/**
+ * @brief Join the chunks of a CBOR indefinite-length text string.
+ *
+ * @param x State.
+ * @param dst Destination.
+ * @param lim Most bytes accepted (over: BJSON_ESYNTAX).
+ * @param room Bytes available at `dst` (over: BJSON_EBUF).
+ * @param n[out] Joined length.
+ * @return 1 on success, 0 on error (recorded in `x->rc`).
+ */
+static int xc_chunks(xc_t* x, uint8_t* dst, size_t lim, size_t room, size_t* n){
+  *n = 0;
+  for (;;){
+    bin_item_t c;
+    if (!cbor_item(x, &c, 1)) return xc_fail(x, BJSON_ESYNTAX);
+    if (c.kind == BI_BREAK) return 1;
+    if (c.kind != BI_STR || c.n == BIN_INDEF || c.n > lim - *n) return xc_fail(x, BJSON_ESYNTAX);
+    if (c.n > room - *n) return xc_fail(x, BJSON_EBUF);
+    memcpy(dst + *n, c.s, c.n); *n += c.n;
+  }
+}
+
+static int xc_map(xc_t* x, uint32_t n);
+static int xc_array(xc_t* x, uint32_t n);
+
+/**
+ * @brief A map or array value as a container entry named `key`.
+ */
+static int xc_container(xc_t* x, const bin_item_t* v, const char* key, size_t klen){
+  uint8_t t = (v->kind == BI_MAP) ? BJD_T_OBJ : BJD_T_ARR;
+  if (++x->depth > BJSON_ENC_DEPTH_MAX) return xc_fail(x, BJSON_ESYNTAX);
+  if (!emit_open(x->em, t, key, klen)) return xc_fail(x, BJSON_EBUF);
+  if (!(t == BJD_T_OBJ ? xc_map(x, v->n) : xc_array(x, v->n))) return 0;
+  x->depth--;
+  emit_close(x->em);
+  return 1;
+}
+
+/**
+ * @brief An array of numbers as a packed array entry, written in place.
+ */
+static int xc_packed(xc_t* x, bjd_type_t t, const char* key, size_t klen, int w, const bin_item_t* v){
+  bjson_emit_t* e = x->em;
+  if (v->kind != BI_ARR) return xc_fail(x, BJSON_ESYNTAX);
+  if ((size_t)(e->end - e->cur) < 8 + klen) return xc_fail(x, BJSON_EBUF);
+  memcpy(e->cur + 8, key, klen);
+  uint8_t nl = (uint8_t)emit_key_id(e, (uint8_t)klen);
+  uint8_t* dat = emit_packed_data(e, nl, w);
+  if (!dat) return xc_fail(x, BJSON_EBUF);
+  size_t cap = (size_t)(e->end - dat) / (size_t)w;
+  uint32_t n = 0;
+  for (;;){
+    if (v->n == BIN_INDEF ? at_break(x) : n == v->n) break;
+    bin_item_t el; uint64_t raw;
+    if (!rd_item(x, &el) || !item_value(&el, (bjd_type_t)BJD_ELEM_TYPE(t), 0, &raw)) return xc_fail(x, BJSON_ESYNTAX);
+    if (n >= cap || n == UINT32_MAX) return xc_fail(x, BJSON_EBUF);
+    enc_put_le(dat + (size_t)n*(size_t)w, w, raw); n++;
+  }
+  return emit_commit_packed(e, (uint8_t)t, nl, w, n) ? 1 : xc_fail(x, BJSON_EBUF);
+}
+
+/**
+ * @brief A text string as a STR_N entry, written in place.
+ */
+static int xc_str(xc_t* x, const char* key, size_t klen, int param, const bin_item_t* v){
+  bjson_emit_t* e = x->em;
+  size_t lim = ENC_STR_BYTES(x->flags, param), n;
+  if (v->kind != BI_STR || (v->n != BIN_INDEF && v->n > lim)) return xc_fail(x, BJSON_ESYNTAX);
+  if ((size_t)(e->end - e->cur) < 8 + klen) return xc_fail(x, BJSON_EBUF);
+  memcpy(e->cur + 8, key, klen);
+  uint8_t nl = (uint8_t)emit_key_id(e, (uint8_t)klen);
+  uint8_t* val = e->cur + 8 + nl;
+  size_t room = (size_t)(e->end - val);
+  if (v->n == BIN_INDEF){ if (!xc_chunks(x, val, lim, room, &n)) return 0; }
+  else {
+    if (v->n > room) return xc_fail(x, BJSON_EBUF);
+    memcpy(val, v->s, v->n); n = v->n;
+  }
+  bjson_err_t rc = enc_check_text(x->flags, (const char*)val, n, (size_t)param);
+  if (rc) return xc_fail(x, rc);
+  return emit_commit_str(e, nl, (uint32_t)n, (uint32_t)lim) ? 1 : xc_fail(x, BJSON_EBUF);
+}
+
+/**
+ * @brief One map member: key item, then its value.
+ *
+ * Same order of decisions as parse_member: a packed key takes an array
+ * of numbers, any map/array value makes a container, anything else needs
+ * a registered prefix.
+ */
+static int xc_member(xc_t* x){
+  bin_item_t k, v;
+  const char* key; size_t klen;
+  if (!rd_item(x, &k) || k.kind != BI_STR) return xc_fail(x, BJSON_ESYNTAX);
+  if (k.n == BIN_INDEF){
+    if (!xc_chunks(x, (uint8_t*)x->kbuf, sizeof(x->kbuf), sizeof(x->kbuf), &klen)) return xc_fail(x, BJSON_ESYNTAX);
+    key = x->kbuf;
+  } else { key = (const char*)k.s; klen = k.n; }
+  if (klen > 255 || memchr(key, 0, klen)) return xc_fail(x, BJSON_ESYNTAX);   // key IDs start with 0x00
+  bjson_err_t rc = enc_check_text(x->flags, key, klen, 0);
+  if (rc) return xc_fail(x, rc);
+
+  bjd_type_t t = 0; int param = 0, isz = 0;
+  int known = enc_classify_key(key, klen, &t, &param, &isz);
+  if (!rd_item(x, &v)) return xc_fail(x, BJSON_ESYNTAX);
+  if (known && BJD_IS_PACKED(t)) return xc_packed(x, t, key, klen, isz, &v);
+  if (v.kind == BI_MAP || v.kind == BI_ARR) return xc_container(x, &v, key, klen);
+  if (!known) return xc_fail(x, BJSON_ESYNTAX);
+  if (t == BJD_T_STR) return xc_str(x, key, klen, param, &v);
+
+  uint64_t raw; uint8_t iv[8];
+  if (!item_value(&v, t, param, &raw)) return xc_fail(x, BJSON_ESYNTAX);
+  enc_put_le(iv, isz, raw);
+  return emit_entry(x->em, (uint8_t)t, key, klen, iv, (uint32_t)isz) ? 1 : xc_fail(x, BJSON_EBUF);
+}
+
+/** @brief Members of a map (`n` pairs or BIN_INDEF). */
+static int xc_map(xc_t* x, uint32_t n){
+  for (uint32_t i=0; n == BIN_INDEF ? !at_break(x) : i < n; i++)
+    if (!xc_member(x)) return 0;
+  return 1;
+}
+
+/** @brief Elements of a container array: maps and arrays only, as in JSON. */
+static int xc_array(xc_t* x, uint32_t n){
+  for (uint32_t i=0; n == BIN_INDEF ? !at_break(x) : i < n; i++){
+    bin_item_t v;
+    if (!rd_item(x, &v) || (v.kind != BI_MAP && v.kind != BI_ARR)) return xc_fail(x, BJSON_ESYNTAX);
+    if (!xc_container(x, &v, "", 0)) return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Shared body of bjson_encode_from_cbor / _msgpack.
+ */
+static bjson_err_t encode_bin(int fmt, const uint8_t* in, size_t n, const bjson_enc_opts_t* opts,
+                              uint8_t* out, size_t out_cap, size_t* out_len){
+  if (!in || !out || !out_len) return BJSON_EINVAL;
+  uint32_t flags = opts ? opts->flags : 0;
+  bjson_emit_t em;
+  if (!emit_begin(&em, flags, out, out_cap)) return BJSON_EBUF;
+  if (opts && opts->dict && !emit_dict(&em, opts->dict, opts->dict->hash)) return BJSON_EBUF;
+  xc_t x;
+  memset(&x, 0, offsetof(xc_t, kbuf));
+  x.p = in; x.end = in + n; x.fmt = (uint8_t)fmt; x.em = &em; x.flags = flags;
+  bin_item_t root;
+  if (!rd_item(&x, &root) || root.kind != BI_MAP) return BJSON_ESYNTAX;
+  if (!xc_map(&x, root.n)) return x.rc ? x.rc : BJSON_ESYNTAX;
+  if (x.p != x.end) return BJSON_ESYNTAX;
+  return emit_end(&em, out_len) ? BJSON_OK : BJSON_EBUF;
+}
+
+/**
+ * @brief Encode a CBOR map (RFC 8949) into BJSON.
+ *
+ * @param in CBOR bytes: exactly one map.
+ * @param n Input length.
+ * @param opts Encoder options, may be NULL (BJSON_ENC_F_DIRECT is implied).
+ * @param out Output buffer.
+ * @param out_cap Capacity of `out`.
+ * @param out_len[out] Encoded length on success.
+ * @return BJSON_OK, BJSON_ESYNTAX on malformed input or a value the key
+ *         does not accept, BJSON_EUTF8, BJSON_EBUF or BJSON_EINVAL.
+ */
+bjson_err_t bjson_encode_from_cbor(const uint8_t* in, size_t n, const bjson_enc_opts_t* opts,
+                                   uint8_t* out, size_t out_cap, size_t* out_len){
+  return encode_bin(BIN_CBOR, in, n, opts, out, out_cap, out_len);
+}
+
+/**
+ * @brief Encode a MessagePack map into BJSON.
+ *
+ * @param in MessagePack bytes: exactly one map.
+ * @param n Input length.
+ * @param opts Encoder options, may be NULL (BJSON_ENC_F_DIRECT is implied).
+ * @param out Output buffer.
+ * @param out_cap Capacity of `out`.
+ * @param out_len[out] Encoded length on success.
+ * @return As bjson_encode_from_cbor.
+ */
+bjson_err_t bjson_encode_from_msgpack(const uint8_t* in, size_t n, const bjson_enc_opts_t* opts,
+                                      uint8_t* out, size_t out_cap, size_t* out_len){
+  return encode_bin(BIN_MSGPACK, in, n, opts, out, out_cap, out_len);
+}
@@ -1,21 +1,22 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include "bjson_enc.h"
+#include "bjson_types.h"
+#include "bjson.h"
 
-typedef enum { 
-  AST_T_STR=1, 
-  AST_T_I16, 
-  AST_T_U16, 
-  AST_T_I32, 
-  AST_T_U32 
-} ast_type_t;
+/* AST node type closing the innermost BJD_T_OBJ/BJD_T_ARR node (not a wire type) */
+#define AST_CLOSE 0
 
 typedef struct ast_kv_s {
-  ast_type_t type;
-  const char* key;     // 원문 키(소유권: arena)
-  const char* sval;    // 문자열 값(소유권: arena) / NULL if int
-  int        smax;     // STR_N 상한
-  long long  iv;       // 정수 값
-  int        isz;      // 2 or 4 (bytes)
+  bjd_type_t type;     // wire type from the registry (bjson_types.h), or AST_CLOSE
+  const char* key;     // 키: 입력 slice, escape가 있으면 decode된 arena 사본
+  const char* sval;    // 문자열 값 (key와 같음) / packed elements (arena), NULL if scalar
+  uint8_t    klen;
+  uint32_t   slen;     // string bytes / packed element count
+  int        param;    // STR_N 상한 / FIX scale
+  uint64_t   raw;      // fixed-size value bits (LE payload)
+  int        isz;      // value width (bytes)
   struct ast_kv_s* next;
 } ast_kv_t;
 
@@ -24,9 +25,57 @@ typedef struct {
   size_t      len;
   size_t      pos;
 
-  char*  arena;
-  size_t arena_cap, arena_used;
+  bjson_enc_ctx_t* ctx;  // arena owner (AST mode)
+  int    enomem;         // arena exhausted
 
   ast_kv_t* head;
   ast_kv_t* tail;
+
+  bjson_emit_t* em;    // BJSON_ENC_F_DIRECT: write entries while parsing (no arena)
+  int    ebuf;         // direct mode ran out of output space
+  int    depth;        // open containers below the root object
+  const bjd_dict_t* dict;  // opts->dict: keys stored as key IDs
+  uint32_t flags;      // BJSON_ENC_F_UTF8 / _CPLIMIT: checked while parsing
+  int    eutf8;        // malformed UTF-8 (enc_check_text)
+  char   kbuf[255];    // direct mode: decoded key with escapes (unescape_key)
 } pctx_t;
+
+/* --- Key/value rules shared by the one-shot and stream parsers (bjson_enc.c) --- */
+int  enc_is_ident0(int c);
+int  enc_is_ident(int c);
+int  enc_classify_key(const char* key, size_t klen, bjd_type_t* t, int* param, int* isz);
+int  enc_hex(int c);
+int  enc_esc_char(int c);
+int  enc_utf8(uint32_t cp, uint8_t* u);
+long enc_unescape(const char* s, size_t n, char* dst, size_t cap);
+bjson_err_t enc_check_text(uint32_t flags, const char* s, size_t n, size_t limit);
+/* most decoded bytes of a STR_N value: N, or 4*N code points with BJSON_ENC_F_CPLIMIT */
+#define ENC_STR_BYTES(flags, n) (((flags) & BJSON_ENC_F_CPLIMIT) ? 4u*(size_t)(n) : (size_t)(n))
+
+/* --- Number engine for fixed-size values (bjson_num.c) --- */
+int  enc_is_token(int c);
+int  enc_value_from_text(bjd_type_t t, int scale, const char* s, size_t n, uint64_t* raw);
+int  enc_value_from_int(bjd_type_t t, int scale, int neg, uint64_t mag, uint64_t* raw);
+int  enc_value_from_double(bjd_type_t t, int scale, double x, uint64_t* raw);
+
+/* --- BJSON writer (bjson_emit.c) --- */
+int  emit_begin(bjson_emit_t* e, uint32_t flags, uint8_t* out, size_t cap);
+int  emit_dict(bjson_emit_t* e, const bjd_dict_t* dict, uint32_t hash);
+int  emit_key_id(bjson_emit_t* e, uint8_t nlen);
+int  emit_commit(bjson_emit_t* e, uint8_t type, uint8_t nlen, uint32_t vlen);
+int  emit_entry(bjson_emit_t* e, uint8_t type, const char* key, size_t klen, const void* val, uint32_t vlen);
+int  emit_commit_str(bjson_emit_t* e, uint8_t nlen, uint32_t vlen, uint32_t cap);
+int  emit_str(bjson_emit_t* e, const char* key, size_t klen, const char* s, uint32_t n, uint32_t cap);
+uint8_t* emit_packed_data(bjson_emit_t* e, uint8_t nlen, int w);
+int  emit_commit_packed(bjson_emit_t* e, uint8_t type, uint8_t nlen, int w, uint32_t n);
+int  emit_packed(bjson_emit_t* e, uint8_t type, const char* key, size_t klen, int w, const void* data, uint32_t n);
+int  emit_push(bjson_emit_t* e, uint8_t type, uint8_t nlen);
+int  emit_open(bjson_emit_t* e, uint8_t type, const char* key, size_t klen);
+void emit_close(bjson_emit_t* e);
+void emit_drop(bjson_emit_t* e);
+int  emit_copy(bjson_emit_t* e, const bjd_entry_t* s);
+int  emit_end(bjson_emit_t* e, size_t* out_len);
+uint32_t enc_dedup(bjson_dedup_t* t, const uint8_t* doc, const uint8_t* s, uint32_t n, uint32_t at);
+/* shortest string worth a back-reference: the reference itself is 8 bytes */
+#define ENC_SREF_MIN 9
+void enc_put_le(uint8_t* p, int w, uint64_t v);
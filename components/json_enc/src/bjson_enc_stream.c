@@ -0,0 +1,394 @@
+#include "bjson_enc.h"
+#include "bjson_enc_internal.h"
+#include "bjson.h"
+#include "bjson_scan.h"
+#include <string.h>
+
+/*
+ * Push parser for the same grammar as parse_object() in bjson_enc.c.
+ * Every byte advances a small state machine, so chunks may split the
+ * input anywhere. Key and string bytes go straight to their final place
+ * in the output (the pending entry at em.cur + 8); only a number token
+ * is buffered, in `num`. Open containers live on the writer's stack
+ * (em.open), which also tells whether ',' and the closing bracket belong
+ * to an object or an array.
+ */
+enum {
+  ST_OPEN=0,   // ws* '{'
+  ST_KEY0,     // ws* ('}' | key), right after '{'
+  ST_KEY,      // ws* key, after ','
+  ST_KEY_Q,    // inside a quoted key
+  ST_KEY_ID,   // inside an unquoted key
+  ST_COLON,    // ws* ':'
+  ST_VAL,      // ws* value
+  ST_STR_Q,    // inside a quoted string value
+  ST_STR_ID,   // inside an unquoted string value
+  ST_NUM,      // inside a number/bool token
+  ST_NEXT,     // ws* (',' | '}' | ']')
+  ST_ELEM0,    // ws* (']' | '{' | '['), right after '['
+  ST_ELEM,     // ws* ('{' | '['), after ',' in an array
+  ST_PK0,      // ws* (']' | number), right after '[' of a packed array
+  ST_PK,       // ws* number, after ',' in a packed array
+  ST_PKNEXT,   // ws* (',' | ']') in a packed array
+  ST_DONE      // ws* only
+};
+
+/**
+ * @brief Append key bytes to the pending entry.
+ *
+ * @param s Stream state.
+ * @param src Bytes to append.
+ * @param k Number of bytes.
+ * @return BJSON_OK, BJSON_ESYNTAX for keys over 255 bytes or with a NUL
+ *         byte (key IDs start with one), BJSON_EBUF when the output is
+ *         full (checked in the same order as byte by byte).
+ */
+static bjson_err_t put_key(bjson_enc_stream_t* s, const char* src, size_t k){
+  if (memchr(src, 0, k)) return BJSON_ESYNTAX;   // raw 0x00: a fed chunk is not NUL-terminated
+  size_t m = k < (size_t)(255 - s->nlen) ? k : (size_t)(255 - s->nlen);
+  if (m){
+    if ((size_t)(s->em.end - s->em.cur) < 8 + (size_t)s->nlen + m) return BJSON_EBUF;
+    memcpy(s->em.cur + 8 + s->nlen, src, m); s->nlen += (uint16_t)m;
+  }
+  return m<k ? BJSON_ESYNTAX : BJSON_OK;
+}
+
+/**
+ * @brief Append string value bytes to the pending entry.
+ *
+ * @param s Stream state.
+ * @param src Bytes to append.
+ * @param k Number of bytes.
+ * @return BJSON_OK, BJSON_ESYNTAX when the STR_N limit is exceeded (in
+ *         bytes; code points are counted in end_str), BJSON_EBUF when
+ *         the output is full.
+ */
+static bjson_err_t put_val(bjson_enc_stream_t* s, const char* src, size_t k){
+  size_t room = ENC_STR_BYTES(s->em.flags, s->param) - s->vlen;
+  size_t m = k < room ? k : room;
+  uint8_t* p = s->em.cur + 8 + s->nlen + s->vlen;
+  if ((size_t)(s->em.end - p) < m) return BJSON_EBUF;
+  memcpy(p, src, m); s->vlen += (uint32_t)m;
+  return m<k ? BJSON_ESYNTAX : BJSON_OK;
+}
+
+/**
+ * @brief Feed one byte of a backslash escape inside a quoted key/string.
+ *
+ * Decoded bytes are appended like plain ones (put_key / put_val), so
+ * the STR_N limit counts decoded bytes. \uXXXX becomes UTF-8; a high
+ * surrogate waits for its low half.
+ *
+ * @param s Stream state with `esc` != 0.
+ * @param c Input byte.
+ * @return BJSON_OK, BJSON_ESYNTAX on a bad escape, a lone surrogate or
+ *         a NUL in a key, or the put_key / put_val error.
+ */
+static bjson_err_t esc_step(bjson_enc_stream_t* s, int c){
+  uint8_t u[4]; int n = 1, h;
+  switch (s->esc){
+    case 1:
+      if (c=='u'){ s->esc = 2; s->nhex = 0; s->cp = 0; return BJSON_OK; }
+      if ((h = enc_esc_char(c)) < 0) return BJSON_ESYNTAX;
+      u[0] = (uint8_t)h;
+      break;
+    case 2: {
+      if ((h = enc_hex(c)) < 0) return BJSON_ESYNTAX;
+      s->cp = (uint16_t)(s->cp << 4 | h);
+      if (++s->nhex < 4) return BJSON_OK;
+      uint32_t cp = s->cp;
+      int lo = cp >= 0xDC00 && cp <= 0xDFFF;
+      if (s->hi){
+        if (!lo) return BJSON_ESYNTAX;
+        cp = 0x10000 + ((uint32_t)(s->hi - 0xD800) << 10) + (cp - 0xDC00); s->hi = 0;
+      } else if (lo) return BJSON_ESYNTAX;
+      else if (cp >= 0xD800 && cp <= 0xDBFF){ s->hi = (uint16_t)cp; s->esc = 3; return BJSON_OK; }
+      if (s->st==ST_KEY_Q && !cp) return BJSON_ESYNTAX;   // key IDs start with 0x00
+      n = enc_utf8(cp, u);
+      break;
+    }
+    case 3: if (c!='\\') return BJSON_ESYNTAX; s->esc = 4; return BJSON_OK;
+    default: if (c!='u') return BJSON_ESYNTAX; s->esc = 2; s->nhex = 0; s->cp = 0; return BJSON_OK;
+  }
+  s->esc = 0;
+  return (s->st==ST_KEY_Q) ? put_key(s, (const char*)u, (size_t)n) : put_val(s, (const char*)u, (size_t)n);
+}
+
+/**
+ * @brief Commit the pending string entry once its value has ended.
+ *
+ * The strict UTF-8 / code-point checks run here on the decoded bytes
+ * already in the output, so chunk boundaries inside a sequence do not
+ * matter.
+ *
+ * @param s Stream state.
+ * @return BJSON_OK, BJSON_EUTF8, BJSON_ESYNTAX over the code-point limit,
+ *         BJSON_EBUF.
+ */
+static bjson_err_t end_str(bjson_enc_stream_t* s){
+  bjson_err_t rc = enc_check_text(s->em.flags, (const char*)s->em.cur + 8 + s->nlen, s->vlen, s->param);
+  s->st = ST_NEXT;
+  if (rc) return rc;
+  return emit_commit_str(&s->em, (uint8_t)s->nlen, s->vlen, (uint32_t)ENC_STR_BYTES(s->em.flags, s->param)) ? BJSON_OK : BJSON_EBUF;
+}
+
+/**
+ * @brief Classify the completed key once ':' has been seen.
+ *
+ * An unknown prefix leaves `type` 0; that is only an error if the value
+ * turns out not to be a container. A key listed in the dictionary is
+ * then replaced in place by its key ID.
+ *
+ * @param s Stream state.
+ */
+static void end_key(bjson_enc_stream_t* s){
+  bjd_type_t t=0; int param=0, isz=0;
+  if (!enc_classify_key((const char*)s->em.cur + 8, s->nlen, &t, &param, &isz)) t = 0;
+  s->nlen = (uint16_t)emit_key_id(&s->em, (uint8_t)s->nlen);
+  s->type=(uint8_t)t; s->param=(uint16_t)param; s->vlen=0; s->nnum=0;
+}
+
+/**
+ * @brief Open a container for '{' or '[' with the pending name.
+ *
+ * @param s Stream state (pending name of `s->nlen` bytes at em.cur + 8).
+ * @param c '{' or '['.
+ * @return BJSON_OK, BJSON_ESYNTAX past BJSON_ENC_DEPTH_MAX, BJSON_EBUF.
+ */
+static bjson_err_t open_cont(bjson_enc_stream_t* s, int c){
+  if (s->em.depth >= BJSON_ENC_DEPTH_MAX) return BJSON_ESYNTAX;
+  uint8_t t = (c=='{') ? BJD_T_OBJ : BJD_T_ARR;
+  if (!emit_push(&s->em, t, (uint8_t)s->nlen)) return BJSON_EBUF;
+  s->st = (t==BJD_T_OBJ) ? ST_KEY0 : ST_ELEM0;
+  return BJSON_OK;
+}
+
+/**
+ * @brief Commit the packed array whose `vlen` elements are in place.
+ *
+ * @param s Stream state.
+ * @return BJSON_OK or BJSON_EBUF.
+ */
+static bjson_err_t end_packed(bjson_enc_stream_t* s){
+  int w = bjd_type_info(BJD_ELEM_TYPE(s->type))->width;
+  s->st = ST_NEXT;
+  return emit_commit_packed(&s->em, s->type, (uint8_t)s->nlen, w, s->vlen) ? BJSON_OK : BJSON_EBUF;
+}
+
+/** Innermost open container is an array (the root is always an object). */
+static int in_array(const bjson_enc_stream_t* s){
+  return s->em.depth && s->em.out[s->em.open[s->em.depth-1]] == BJD_T_ARR;
+}
+
+/**
+ * @brief Close the innermost container (or the root object) on `c`.
+ *
+ * @param s Stream state.
+ * @param c '}' or ']'.
+ * @return BJSON_OK or BJSON_ESYNTAX on a mismatched bracket.
+ */
+static bjson_err_t close_cont(bjson_enc_stream_t* s, int c){
+  if (c != (in_array(s) ? ']' : '}')) return BJSON_ESYNTAX;
+  if (!s->em.depth){ s->st = ST_DONE; return BJSON_OK; }
+  emit_close(&s->em);
+  s->st = ST_NEXT;
+  return BJSON_OK;
+}
+
+/**
+ * @brief Convert the buffered value token and commit the entry (or
+ *        append it to the open packed array).
+ *
+ * @param s Stream state.
+ * @return BJSON_OK, BJSON_ESYNTAX on a bad/out-of-range value, BJSON_EBUF.
+ */
+static bjson_err_t end_num(bjson_enc_stream_t* s){
+  uint64_t raw=0;
+  if (BJD_IS_PACKED(s->type)){ // one more element, written in place
+    bjd_type_t et = (bjd_type_t)BJD_ELEM_TYPE(s->type);
+    int w = bjd_type_info(et)->width;
+    if (!enc_value_from_text(et, 0, s->num, s->nnum, &raw) || s->vlen == UINT32_MAX) return BJSON_ESYNTAX;
+    uint8_t* p = emit_packed_data(&s->em, (uint8_t)s->nlen, w) + (size_t)s->vlen*(size_t)w;
+    if (s->em.end - p < w) return BJSON_EBUF;
+    enc_put_le(p, w, raw); s->vlen++;
+    return BJSON_OK;
+  }
+  if (!enc_value_from_text((bjd_type_t)s->type, s->param, s->num, s->nnum, &raw)) return BJSON_ESYNTAX;
+  int isz = bjd_type_info(s->type)->width;
+  uint8_t* p = s->em.cur + 8 + s->nlen;
+  if (s->em.end - p < isz) return BJSON_EBUF;
+  enc_put_le(p, isz, raw);
+  return emit_commit(&s->em, s->type, (uint8_t)s->nlen, (uint32_t)isz) ? BJSON_OK : BJSON_EBUF;
+}
+
+/**
+ * @brief Start a chunked encode into `out`.
+ *
+ * @param s Stream state to initialize (caller-owned, no allocation).
+ * @param opts Encoder options, may be NULL.
+ * @param out Output buffer; must stay valid until bjson_enc_end.
+ * @param out_cap Capacity of `out`.
+ * @return BJSON_OK, BJSON_EINVAL or BJSON_EBUF.
+ */
+bjson_err_t bjson_enc_begin(bjson_enc_stream_t* s, const bjson_enc_opts_t* opts, uint8_t* out, size_t out_cap){
+  if (!s || !out) return BJSON_EINVAL;
+  memset(s, 0, sizeof(*s));
+  s->st = ST_OPEN;
+  if (!emit_begin(&s->em, opts ? opts->flags : 0, out, out_cap)) s->err = BJSON_EBUF;
+  else if (opts && opts->dict && !emit_dict(&s->em, opts->dict, opts->dict->hash)) s->err = BJSON_EBUF;
+  return s->err;
+}
+
+/**
+ * @brief Feed the next piece of JSON text.
+ *
+ * Chunk boundaries may fall anywhere, including inside keys, strings and
+ * numbers. After the first error every further call returns it.
+ *
+ * @param s Stream state from bjson_enc_begin.
+ * @param chunk Text bytes.
+ * @param n Number of bytes in `chunk`.
+ * @return BJSON_OK or the (sticky) error.
+ */
+bjson_err_t bjson_enc_feed(bjson_enc_stream_t* s, const char* chunk, size_t n){
+  if (!s || (!chunk && n)) return BJSON_EINVAL;
+  if (s->err) return s->err;
+  bjson_err_t rc = BJSON_OK;
+  size_t i = 0;
+  while (i < n && rc == BJSON_OK){
+    // bulk paths: whitespace runs and plain runs inside quoted tokens
+    switch (s->st){
+      case ST_OPEN: case ST_KEY0: case ST_KEY: case ST_COLON: case ST_VAL: case ST_NEXT:
+      case ST_ELEM0: case ST_ELEM: case ST_PK0: case ST_PK: case ST_PKNEXT: case ST_DONE:
+        i += scan_ws(chunk+i, n-i);
+        if (i >= n) continue;
+        break;
+      case ST_KEY_Q: case ST_STR_Q:
+        if (!s->esc){
+          size_t run = scan_str(chunk+i, n-i);
+          if (run){
+            rc = (s->st==ST_KEY_Q) ? put_key(s, chunk+i, run) : put_val(s, chunk+i, run);
+            i += run;
+            continue;
+          }
+        }
+        break;
+    }
+    int c = (unsigned char)chunk[i];
+    switch (s->st){
+      case ST_OPEN:
+        if (c=='{') s->st = ST_KEY0;
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_KEY0:
+        if (c=='}'){ rc = close_cont(s, c); break; }
+        /* fall through */
+      case ST_KEY:
+        s->nlen = 0; s->esc = 0;
+        if (c=='"') s->st = ST_KEY_Q;
+        else if (enc_is_ident0(c)){ s->st = ST_KEY_ID; rc = put_key(s, &chunk[i], 1); }
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_KEY_Q:
+        if (s->esc) rc = esc_step(s, c);
+        else if (c=='\\') s->esc = 1;
+        else if (c=='"'){ rc = enc_check_text(s->em.flags, (const char*)s->em.cur + 8, s->nlen, 0); s->st = ST_COLON; }
+        else rc = put_key(s, &chunk[i], 1);
+        break;
+      case ST_KEY_ID:
+        if (enc_is_ident(c)){ rc = put_key(s, &chunk[i], 1); break; }
+        s->st = ST_COLON;
+        continue; // reprocess c
+      case ST_COLON:
+        if (c==':'){ end_key(s); s->st = ST_VAL; }
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_VAL:
+        if (BJD_IS_PACKED(s->type)){
+          if (c!='[') rc = BJSON_ESYNTAX;
+          else if (!emit_packed_data(&s->em, (uint8_t)s->nlen, bjd_type_info(BJD_ELEM_TYPE(s->type))->width)) rc = BJSON_EBUF;
+          else s->st = ST_PK0;
+          break;
+        }
+        if (c=='{' || c=='['){ rc = open_cont(s, c); break; }
+        if (!s->type){ rc = BJSON_ESYNTAX; break; }
+        if (s->type==BJD_T_STR){
+          s->esc = 0;
+          if (c=='"') s->st = ST_STR_Q;
+          else if (enc_is_ident0(c)){ s->st = ST_STR_ID; rc = put_val(s, &chunk[i], 1); }
+          else rc = BJSON_ESYNTAX;
+        } else {
+          if (enc_is_token(c)){ s->num[s->nnum++] = (char)c; s->st = ST_NUM; }
+          else rc = BJSON_ESYNTAX;
+        }
+        break;
+      case ST_STR_Q:
+        if (s->esc) rc = esc_step(s, c);
+        else if (c=='\\') s->esc = 1;
+        else if (c=='"') rc = end_str(s);
+        else rc = put_val(s, &chunk[i], 1);
+        break;
+      case ST_STR_ID:
+        if (enc_is_ident(c)){ rc = put_val(s, &chunk[i], 1); break; }
+        rc = end_str(s);
+        continue; // reprocess c
+      case ST_NUM:
+        if (enc_is_token(c)){
+          if (s->nnum >= sizeof(s->num)-1) rc = BJSON_ESYNTAX;
+          else s->num[s->nnum++] = (char)c;
+          break;
+        }
+        rc = end_num(s);
+        s->st = BJD_IS_PACKED(s->type) ? ST_PKNEXT : ST_NEXT;
+        continue; // reprocess c
+      case ST_NEXT:
+        if (c=='}' || c==']') rc = close_cont(s, c);
+        else if (c==',') s->st = in_array(s) ? ST_ELEM : ST_KEY;
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_PK0:
+        if (c==']'){ rc = end_packed(s); break; }
+        /* fall through */
+      case ST_PK:
+        s->nnum = 0;
+        if (enc_is_token(c)){ s->num[s->nnum++] = (char)c; s->st = ST_NUM; }
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_PKNEXT:
+        if (c==',') s->st = ST_PK;
+        else if (c==']') rc = end_packed(s);
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_ELEM0:
+        if (c==']'){ rc = close_cont(s, c); break; }
+        /* fall through */
+      case ST_ELEM:
+        s->nlen = 0;
+        if (c=='{' || c=='[') rc = open_cont(s, c);
+        else rc = BJSON_ESYNTAX;
+        break;
+      case ST_DONE:
+        rc = BJSON_ESYNTAX;
+        break;
+    }
+    i++;
+  }
+  s->err = rc;
+  return rc;
+}
+
+/**
+ * @brief Finish a chunked encode.
+ *
+ * @param s Stream state.
+ * @param out_len[out] Total document length on success.
+ * @return BJSON_OK, BJSON_ESYNTAX if the input ended early, BJSON_EBUF, or
+ *         the sticky error from bjson_enc_feed.
+ */
+bjson_err_t bjson_enc_end(bjson_enc_stream_t* s, size_t* out_len){
+  if (!s || !out_len) return BJSON_EINVAL;
+  if (s->err) return s->err;
+  if (s->st != ST_DONE) return s->err = BJSON_ESYNTAX;
+  if (!emit_end(&s->em, out_len)) return s->err = BJSON_EBUF;
+  return BJSON_OK;
+}
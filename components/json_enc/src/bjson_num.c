@@ -0,0 +1,323 @@
+#include "bjson_enc_internal.h"
+#include <string.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+
+/*
+ * Value tokens for fixed-size types, shared by both parsers. The token is
+ * the raw run of [A-Za-z0-9+-.] bytes; it is converted in place without
+ * copying except on the rare slow float path.
+ *
+ *   INT, UINT     [+-]?(digits | 0x hexdigits), exact, overflow-checked
+ *   FLOAT32/64   [+-]?digits[.digits][(e|E)[+-]?digits], correctly rounded
+ *   BOOL         true | false
+ *   FIX16/32     [+-]?digits[.digits], scaled by 10^scale, half away from zero
+ */
+
+static int dig(int c){ return (unsigned)(c - '0') <= 9; }
+static int hexval(int c){
+  if (dig(c)) return c - '0';
+  c |= 0x20;
+  return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+/**
+ * @brief Fused sign/digit accumulator for integer tokens.
+ *
+ * @param s Token bytes.
+ * @param n Token length.
+ * @param neg[out] 1 if a '-' sign was present.
+ * @param mag[out] Magnitude.
+ * @return 1 on success, 0 on a malformed token or a magnitude over 64 bits.
+ */
+static int parse_int_mag(const char* s, size_t n, int* neg, uint64_t* mag){
+  size_t i=0; uint64_t v=0;
+  *neg=0;
+  if (i<n && (s[i]=='+' || s[i]=='-')){ *neg = (s[i]=='-'); i++; }
+  if (i>=n) return 0;
+  if (n-i > 2 && s[i]=='0' && (s[i+1]|0x20)=='x'){
+    for (i+=2; i<n; i++){
+      int d = hexval((unsigned char)s[i]);
+      if (d < 0 || (v >> 60)) return 0;
+      v = (v << 4) | (uint64_t)d;
+    }
+  } else {
+    for (; i<n; i++){
+      unsigned d = (unsigned)((unsigned char)s[i] - '0');
+      if (d > 9 || v > (UINT64_MAX - d) / 10) return 0;
+      v = v*10 + d;
+    }
+  }
+  *mag = v; return 1;
+}
+
+/**
+ * @brief Check a sign/magnitude pair against a registry row and encode it.
+ *
+ * @param ti Registry row (min/max).
+ * @param neg Sign.
+ * @param mag Magnitude.
+ * @param raw[out] Two's complement bit pattern on success.
+ * @return 1 if in range, 0 otherwise.
+ */
+static int int_to_raw(const bjd_type_info_t* ti, int neg, uint64_t mag, uint64_t* raw){
+  if (neg && mag){
+    if (ti->min >= 0 || mag - 1 > (uint64_t)(-(ti->min + 1))) return 0;
+    *raw = ~mag + 1;
+  } else {
+    if (mag > ti->max) return 0;
+    *raw = mag;
+  }
+  return 1;
+}
+
+typedef struct {
+  int      neg;
+  uint64_t w;          // first 19 significant digits
+  int      trunc;      // non-zero digits were dropped beyond w
+  long     e10;        // value = w * 10^e10
+} dec_t;
+
+/**
+ * @brief Validate a decimal float token and split it into w * 10^e10.
+ *
+ * @param s Token bytes.
+ * @param n Token length.
+ * @param d[out] Decomposition.
+ * @return 1 on a well-formed token, 0 otherwise.
+ */
+static int parse_dec(const char* s, size_t n, dec_t* d){
+  size_t i=0; int nsig=0, ndig=0;
+  memset(d, 0, sizeof(*d));
+  if (i<n && (s[i]=='+' || s[i]=='-')){ d->neg = (s[i]=='-'); i++; }
+  for (; i<n && dig(s[i]); i++, ndig++){
+    unsigned v = (unsigned)(s[i]-'0');
+    if (nsig < 19){ if (v || nsig){ d->w = d->w*10 + v; nsig++; } }
+    else { d->e10++; d->trunc |= (v != 0); }
+  }
+  if (!ndig) return 0;
+  if (i<n && s[i]=='.'){
+    size_t f = ++i;
+    for (; i<n && dig(s[i]); i++){
+      unsigned v = (unsigned)(s[i]-'0');
+      if (nsig < 19){ if (v || nsig){ d->w = d->w*10 + v; nsig++; } d->e10--; }
+      else d->trunc |= (v != 0);
+    }
+    if (i == f) return 0;
+  }
+  if (i<n && (s[i]|0x20)=='e'){
+    int eneg=0; long ev=0; size_t f;
+    i++;
+    if (i<n && (s[i]=='+' || s[i]=='-')){ eneg = (s[i]=='-'); i++; }
+    for (f=i; i<n && dig(s[i]); i++) if (ev < 100000) ev = ev*10 + (s[i]-'0');
+    if (i == f) return 0;
+    d->e10 += eneg ? -ev : ev;
+  }
+  return i == n;
+}
+
+/**
+ * @brief Slow path: libc conversion of a NUL-terminated copy.
+ *
+ * strtod/strtof are correctly rounded in glibc and newlib. The token was
+ * validated by parse_dec, so no hex/inf/nan forms reach them. They read
+ * the locale's decimal point, which must stay "." (see bjson_batch.h).
+ */
+static int float_slow(const char* s, size_t n, int w, uint64_t* raw){
+  char buf[BJSON_ENC_TOKEN_MAX];
+  if (n >= sizeof(buf)) return 0;
+  memcpy(buf, s, n); buf[n] = 0;
+  if (w == 4){
+    float f = strtof(buf, NULL); uint32_t b;
+    if (!isfinite(f)) return 0;
+    memcpy(&b, &f, 4); *raw = b; return 1;
+  }
+  double x = strtod(buf, NULL);
+  if (!isfinite(x)) return 0;
+  memcpy(raw, &x, 8); return 1;
+}
+
+/**
+ * @brief Decimal to IEEE binary32/binary64, correctly rounded.
+ *
+ * Fast path (Clinger): when the significand is exact and fits the target
+ * mantissa and 10^|e| is exactly representable, one multiply or divide
+ * gives the correctly rounded result. Everything else goes to float_slow.
+ *
+ * @param s Token bytes.
+ * @param n Token length.
+ * @param w Target width (4 or 8).
+ * @param raw[out] IEEE bit pattern.
+ * @return 1 on success, 0 on a malformed or out-of-range token.
+ */
+static int float_to_raw(const char* s, size_t n, int w, uint64_t* raw){
+  dec_t d;
+  if (!parse_dec(s, n, &d)) return 0;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+  static const double p10[] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22 };
+  static const float p10f[] = { 1e0f,1e1f,1e2f,1e3f,1e4f,1e5f,1e6f,1e7f,1e8f,1e9f,1e10f };
+  if (!d.trunc){
+    if (w == 4 && d.w <= (1u<<24) && d.e10 >= -10 && d.e10 <= 10){
+      float f = (float)d.w;
+      f = d.e10 < 0 ? f / p10f[-d.e10] : f * p10f[d.e10];
+      if (d.neg) f = -f;
+      uint32_t b; memcpy(&b, &f, 4); *raw = b; return 1;
+    }
+    if (w == 8 && d.w <= (1ull<<53) && d.e10 >= -22 && d.e10 <= 22){
+      double x = (double)d.w;
+      x = d.e10 < 0 ? x / p10[-d.e10] : x * p10[d.e10];
+      if (d.neg) x = -x;
+      memcpy(raw, &x, 8); return 1;
+    }
+  }
+#endif
+  return float_slow(s, n, w, raw);
+}
+
+/**
+ * @brief Fixed-point decimal to a raw integer scaled by 10^scale.
+ *
+ * Exact decimal arithmetic; digits beyond `scale` round half away from
+ * zero. Exponents are not accepted.
+ *
+ * @param ti Registry row (raw range).
+ * @param scale Decimal places from the key.
+ * @param s Token bytes.
+ * @param n Token length.
+ * @param raw[out] Raw bit pattern.
+ * @return 1 on success, 0 on a malformed or out-of-range token.
+ */
+static int fix_to_raw(const bjd_type_info_t* ti, int scale, const char* s, size_t n, uint64_t* raw){
+  size_t i=0; int neg=0, ndig=0; uint64_t v=0;
+  if (i<n && (s[i]=='+' || s[i]=='-')){ neg = (s[i]=='-'); i++; }
+  for (; i<n && dig(s[i]); i++, ndig++){
+    if (v > (UINT64_MAX - 9) / 10) return 0;
+    v = v*10 + (uint64_t)(s[i]-'0');
+  }
+  if (!ndig) return 0;
+  const char* frac = NULL; size_t nfrac = 0;
+  if (i<n && s[i]=='.'){
+    frac = s + ++i;
+    while (i<n && dig(s[i])) i++;
+    nfrac = (size_t)(s + i - frac);
+    if (!nfrac) return 0;
+  }
+  if (i != n) return 0;
+  for (int k=0; k<scale; k++){
+    unsigned dv = (size_t)k < nfrac ? (unsigned)(frac[k]-'0') : 0;
+    if (v > (UINT64_MAX - 9) / 10) return 0;
+    v = v*10 + dv;
+  }
+  if ((size_t)scale < nfrac && frac[scale] >= '5') v++;
+  return int_to_raw(ti, neg, v, raw);
+}
+
+/**
+ * @brief Convert a value token for a fixed-size type to its wire bits.
+ *
+ * @param t Wire type from enc_classify_key.
+ * @param scale FIX scale from enc_classify_key (ignored otherwise).
+ * @param s Token bytes.
+ * @param n Token length.
+ * @param raw[out] Little-endian payload as a 64-bit pattern.
+ * @return 1 on success, 0 on a malformed or out-of-range value.
+ */
+int enc_value_from_text(bjd_type_t t, int scale, const char* s, size_t n, uint64_t* raw){
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)t);
+  if (!ti || n == 0 || n >= BJSON_ENC_TOKEN_MAX) return 0;
+  int neg; uint64_t mag;
+  switch (ti->kind){
+    case BJD_K_INT: case BJD_K_UINT:
+      return parse_int_mag(s, n, &neg, &mag) && int_to_raw(ti, neg, mag, raw);
+    case BJD_K_FLOAT:
+      return float_to_raw(s, n, ti->width, raw);
+    case BJD_K_BOOL:
+      if (n==4 && memcmp(s,"true",4)==0){ *raw = 1; return 1; }
+      if (n==5 && memcmp(s,"false",5)==0){ *raw = 0; return 1; }
+      return 0;
+    case BJD_K_FIX:
+      return fix_to_raw(ti, scale, s, n, raw);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Convert a binary integer (CBOR / MessagePack) to wire bits.
+ *
+ * Same rules as the text token of that value: exact and range-checked
+ * for INT/UINT and FIX (scaled by 10^scale), correctly rounded for
+ * FLOAT; BOOL takes no numbers.
+ *
+ * @param t Wire type from enc_classify_key.
+ * @param scale FIX scale (ignored otherwise).
+ * @param neg Sign.
+ * @param mag Magnitude.
+ * @param raw[out] Little-endian payload as a 64-bit pattern.
+ * @return 1 on success, 0 on a type mismatch or out-of-range value.
+ */
+int enc_value_from_int(bjd_type_t t, int scale, int neg, uint64_t mag, uint64_t* raw){
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)t);
+  if (!ti) return 0;
+  switch (ti->kind){
+    case BJD_K_INT: case BJD_K_UINT:
+      return int_to_raw(ti, neg, mag, raw);
+    case BJD_K_FLOAT:   // one rounding, like a decimal integer token
+      if (ti->width == 4){ float f = (float)mag; if (neg) f = -f; uint32_t b; memcpy(&b, &f, 4); *raw = b; }
+      else { double x = (double)mag; if (neg) x = -x; memcpy(raw, &x, 8); }
+      return 1;
+    case BJD_K_FIX:
+      for (int k=0; k<scale; k++){ if (mag > UINT64_MAX / 10) return 0; mag *= 10; }
+      return int_to_raw(ti, neg, mag, raw);
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Convert a binary float (CBOR / MessagePack) to wire bits.
+ *
+ * FLOAT targets take the value rounded to the target width (non-finite
+ * results are rejected, as the text route cannot express them). FIX
+ * targets round x * 10^scale half away from zero; that product is itself
+ * rounded, so a float exactly halfway between two steps may land on
+ * either (CBOR decimal fractions avoid this, see bjson_enc_bin.c).
+ * INT/UINT take no floats, like a token with a '.'.
+ *
+ * @param t Wire type from enc_classify_key.
+ * @param scale FIX scale (ignored otherwise).
+ * @param x Value.
+ * @param raw[out] Little-endian payload as a 64-bit pattern.
+ * @return 1 on success, 0 on a type mismatch or out-of-range value.
+ */
+int enc_value_from_double(bjd_type_t t, int scale, double x, uint64_t* raw){
+  static const double p10[BJD_FIX_SCALE_MAX+1] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9 };
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)t);
+  if (!ti || !isfinite(x)) return 0;
+  switch (ti->kind){
+    case BJD_K_FLOAT:
+      if (ti->width == 4){
+        float f = (float)x; uint32_t b;
+        if (!isfinite(f)) return 0;
+        memcpy(&b, &f, 4); *raw = b; return 1;
+      }
+      memcpy(raw, &x, 8); return 1;
+    case BJD_K_FIX: {
+      if (scale < 0 || scale > BJD_FIX_SCALE_MAX) return 0;
+      double r = round(x * p10[scale]);   // half away from zero
+      if (!(fabs(r) < 9.2e18)) return 0;
+      return int_to_raw(ti, r < 0, (uint64_t)fabs(r), raw);
+    }
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Bytes that may appear in a value token of a fixed-size type.
+ */
+int enc_is_token(int c){
+  return dig(c) || ((c|0x20) >= 'a' && (c|0x20) <= 'z') || c=='+' || c=='-' || c=='.';
+}
@@ -0,0 +1,257 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Structural scanners for the JSON front-ends.
+ *
+ *   scan_ws(s, n)   -> number of leading ' ', '\t', '\r', '\n' bytes
+ *   scan_str(s, n)  -> index of the first '"' or '\\' (n if none)
+ *   scan_utf8(s, n) -> start of the first malformed UTF-8 sequence (n if
+ *                      none): overlongs, surrogates, > U+10FFFF and
+ *                      truncated sequences are malformed
+ *
+ * The kernel is chosen at build time: AVX2 or SSE2 on x86 hosts, SWAR
+ * (one machine word per step) elsewhere, e.g. Xtensa on the ESP32-S3.
+ * Define BJSON_SCAN_SCALAR to force the byte loop. The scalar versions
+ * are always available as the reference implementation.
+ *
+ * scan_utf8 skips ASCII a word/vector at a time and steps through
+ * multi-byte text per sequence; with SSSE3 (AVX2 builds, -march=native)
+ * it classifies 16 bytes at a time with three nibble lookups instead
+ * (Keiser & Lemire, "Validating UTF-8 In Less Than One Instruction Per
+ * Byte"), so Hangul or mixed text runs at vector speed too.
+ */
+
+#if !defined(BJSON_SCAN_SCALAR) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+static inline int scan_is_ws(unsigned char c){ return c==' '||c=='\t'||c=='\r'||c=='\n'; }
+
+static inline size_t scan_ws_scalar(const char* s, size_t n){
+  size_t i=0; while (i<n && scan_is_ws((unsigned char)s[i])) i++; return i;
+}
+static inline size_t scan_str_scalar(const char* s, size_t n){
+  size_t i=0; while (i<n && s[i]!='"' && s[i]!='\\') i++; return i;
+}
+
+/** Length (1..4) of the well-formed UTF-8 sequence at `u` (`n` > 0 bytes readable), 0 if malformed. */
+static inline size_t utf8_seq(const unsigned char* u, size_t n){
+  unsigned c = u[0], lo = 0x80, hi = 0xBF;
+  size_t k;
+  if (c < 0x80) return 1;
+  if (c >= 0xC2 && c <= 0xDF) k = 1;
+  else if (c >= 0xE0 && c <= 0xEF){ k = 2; if (c == 0xE0) lo = 0xA0; else if (c == 0xED) hi = 0x9F; }
+  else if (c >= 0xF0 && c <= 0xF4){ k = 3; if (c == 0xF0) lo = 0x90; else if (c == 0xF4) hi = 0x8F; }
+  else return 0;
+  if (n <= k || u[1] < lo || u[1] > hi) return 0;
+  for (size_t j=2; j<=k; j++) if ((u[j] & 0xC0) != 0x80) return 0;
+  return k + 1;
+}
+static inline size_t scan_utf8_scalar(const char* s, size_t n){
+  const unsigned char* u = (const unsigned char*)s;
+  size_t i=0, k;
+  while (i<n && (k = utf8_seq(u+i, n-i))) i += k;
+  return i;
+}
+/** Code points in well-formed UTF-8 (bytes that are not 10xxxxxx). */
+static inline size_t utf8_count(const char* s, size_t n){
+  size_t c=0; for (size_t i=0;i<n;i++) c += ((unsigned char)s[i] & 0xC0) != 0x80; return c;
+}
+
+#if defined(BJSON_SCAN_SCALAR) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#define BJSON_SCAN_KERNEL "scalar"
+#define BJSON_UTF8_KERNEL "scalar"
+static inline size_t scan_ws(const char* s, size_t n){ return scan_ws_scalar(s, n); }
+static inline size_t scan_str(const char* s, size_t n){ return scan_str_scalar(s, n); }
+static inline size_t scan_utf8(const char* s, size_t n){ return scan_utf8_scalar(s, n); }
+
+#elif defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+#define BJSON_SCAN_KERNEL "avx2"
+#define SCAN_W 32
+typedef __m256i scan_vec_t;
+#define SCAN_LOAD(p)    _mm256_loadu_si256((const __m256i*)(p))
+#define SCAN_SET1(c)    _mm256_set1_epi8((char)(c))
+#define SCAN_EQ(a,b)    _mm256_cmpeq_epi8((a),(b))
+#define SCAN_OR(a,b)    _mm256_or_si256((a),(b))
+#define SCAN_MASK(v)    ((uint32_t)_mm256_movemask_epi8(v))
+#else
+#define BJSON_SCAN_KERNEL "sse2"
+#define SCAN_W 16
+typedef __m128i scan_vec_t;
+#define SCAN_LOAD(p)    _mm_loadu_si128((const __m128i*)(p))
+#define SCAN_SET1(c)    _mm_set1_epi8((char)(c))
+#define SCAN_EQ(a,b)    _mm_cmpeq_epi8((a),(b))
+#define SCAN_OR(a,b)    _mm_or_si128((a),(b))
+#define SCAN_MASK(v)    ((uint32_t)_mm_movemask_epi8(v))
+#endif
+
+static inline size_t scan_ws(const char* s, size_t n){
+  const scan_vec_t sp=SCAN_SET1(' '), ht=SCAN_SET1('\t'), cr=SCAN_SET1('\r'), lf=SCAN_SET1('\n');
+  size_t i=0;
+  // one-byte exit first: most calls stop on a non-ws byte immediately
+  if (n && !scan_is_ws((unsigned char)s[0])) return 0;
+  for (; i+SCAN_W<=n; i+=SCAN_W){
+    scan_vec_t v = SCAN_LOAD(s+i);
+    scan_vec_t m = SCAN_OR(SCAN_OR(SCAN_EQ(v,sp),SCAN_EQ(v,ht)), SCAN_OR(SCAN_EQ(v,cr),SCAN_EQ(v,lf)));
+    uint32_t nonws = ~SCAN_MASK(m);
+#if SCAN_W < 32
+    nonws &= (1u<<SCAN_W)-1;
+#endif
+    if (nonws) return i + (size_t)__builtin_ctz(nonws);
+  }
+  return i + scan_ws_scalar(s+i, n-i);
+}
+
+static inline size_t scan_str(const char* s, size_t n){
+  const scan_vec_t q=SCAN_SET1('"'), bs=SCAN_SET1('\\');
+  size_t i=0;
+  for (; i+SCAN_W<=n; i+=SCAN_W){
+    scan_vec_t v = SCAN_LOAD(s+i);
+    uint32_t hit = SCAN_MASK(SCAN_OR(SCAN_EQ(v,q), SCAN_EQ(v,bs)));
+    if (hit) return i + (size_t)__builtin_ctz(hit);
+  }
+  return i + scan_str_scalar(s+i, n-i);
+}
+
+#if defined(__SSSE3__)
+#define BJSON_UTF8_KERNEL "ssse3"
+/* error bits of the byte pair (prev1, cur); see scan_utf8 */
+#define U8_TOO_SHORT  0x01   // lead not followed by a continuation
+#define U8_TOO_LONG   0x02   // continuation after ASCII
+#define U8_OVERLONG_3 0x04
+#define U8_TOO_LARGE  0x08
+#define U8_SURROGATE  0x10
+#define U8_OVERLONG_2 0x20
+#define U8_LARGE_1000 0x40   // also 4-byte overlong (same byte pattern class)
+#define U8_TWO_CONTS  0x80   // continuation after continuation (valid only inside a 3/4-byte sequence)
+#define U8_CARRY (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+/** Per-byte error bits of each (previous byte, byte) pair in `v`. */
+static inline __m128i utf8_pairs(__m128i v, __m128i prev1){
+  const __m128i lo4 = _mm_set1_epi8(0x0F);
+  const __m128i b1_hi = _mm_setr_epi8(U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+    U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+    U8_TOO_SHORT | U8_OVERLONG_2, U8_TOO_SHORT,
+    U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+    (char)(U8_TOO_SHORT | U8_TOO_LARGE | U8_LARGE_1000));
+  const __m128i b1_lo = _mm_setr_epi8((char)(U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_LARGE_1000),
+    (char)(U8_CARRY | U8_OVERLONG_2), (char)U8_CARRY, (char)U8_CARRY,
+    (char)(U8_CARRY | U8_TOO_LARGE),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000), (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000), (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000), (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000), (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000 | U8_SURROGATE),
+    (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000), (char)(U8_CARRY | U8_TOO_LARGE | U8_LARGE_1000));
+  const __m128i b2_hi = _mm_setr_epi8(U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_LARGE_1000),
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE),
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE),
+    (char)(U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE),
+    U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT);
+  __m128i e = _mm_shuffle_epi8(b1_hi, _mm_and_si128(_mm_srli_epi16(prev1, 4), lo4));
+  e = _mm_and_si128(e, _mm_shuffle_epi8(b1_lo, _mm_and_si128(prev1, lo4)));
+  return _mm_and_si128(e, _mm_shuffle_epi8(b2_hi, _mm_and_si128(_mm_srli_epi16(v, 4), lo4)));
+}
+
+static inline size_t scan_utf8(const char* s, size_t n){
+  const __m128i third = _mm_set1_epi8((char)(0xE0 - 0x80)), fourth = _mm_set1_epi8((char)(0xF0 - 0x80));
+  const __m128i hi = _mm_set1_epi8((char)0x80);
+  const __m128i last = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1, (char)(0xF0-1), (char)(0xE0-1), (char)(0xC0-1));
+  __m128i prev = _mm_setzero_si128(), incomplete = _mm_setzero_si128(), err = _mm_setzero_si128();
+  size_t i=0;
+  for (; i+16<=n; i+=16){
+    __m128i v = _mm_loadu_si128((const __m128i*)(s+i));
+    if (!_mm_movemask_epi8(v)){ err = _mm_or_si128(err, incomplete); incomplete = _mm_setzero_si128(); prev = v; continue; }   // ASCII block
+    __m128i e = utf8_pairs(v, _mm_alignr_epi8(v, prev, 15));
+    // after a 3/4-byte lead, the 2nd/3rd following byte must be a continuation (the TWO_CONTS bit)
+    __m128i must = _mm_or_si128(_mm_subs_epu8(_mm_alignr_epi8(v, prev, 14), third), _mm_subs_epu8(_mm_alignr_epi8(v, prev, 13), fourth));
+    err = _mm_or_si128(err, _mm_xor_si128(e, _mm_and_si128(must, hi)));
+    incomplete = _mm_subs_epu8(v, last);   // a lead in the last 3 bytes waits for the next block
+    prev = v;
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) != 0xFFFF) return scan_utf8_scalar(s, n);
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(err, _mm_setzero_si128())) != 0xFFFF) return scan_utf8_scalar(s, n);
+  // tail: restart at the lead of the sequence the last block left open
+  const unsigned char* u = (const unsigned char*)s;
+  size_t j = i;
+  while (j > 0 && i - j < 3 && (u[j-1] & 0xC0) == 0x80) j--;
+  if (j > 0 && i - j < 3 && u[j-1] >= 0xC0) j--;
+  else j = i;
+  return j + scan_utf8_scalar(s+j, n-j);
+}
+#else
+#define BJSON_UTF8_KERNEL "sse2"
+static inline size_t scan_utf8(const char* s, size_t n){
+  const unsigned char* u = (const unsigned char*)s;
+  size_t i=0, k;
+  while (i+16 <= n){
+    if (!_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(s+i)))){ i += 16; continue; }   // ASCII block
+    for (size_t end = i + 16; i < end; i += k) if (!(k = utf8_seq(u+i, n-i))) return i;
+  }
+  return i + scan_utf8_scalar(s+i, n-i);
+}
+#endif
+
+#else /* SWAR */
+#define BJSON_SCAN_KERNEL "swar"
+#if UINTPTR_MAX > 0xFFFFFFFFu
+typedef uint64_t scan_word_t;
+#define SCAN_ONES  0x0101010101010101ull
+#define SCAN_CTZ(x) __builtin_ctzll(x)
+#else
+typedef uint32_t scan_word_t;
+#define SCAN_ONES  0x01010101u
+#define SCAN_CTZ(x) __builtin_ctz(x)
+#endif
+#define SCAN_HI    (SCAN_ONES*0x80)
+#define SCAN_LO7   (SCAN_ONES*0x7F)
+
+/** High bit set in every byte of `v` that is exactly zero (no borrow false positives). */
+static inline scan_word_t scan_zero_bytes(scan_word_t v){
+  scan_word_t t = (v & SCAN_LO7) + SCAN_LO7;
+  return ~(t | v | SCAN_LO7);
+}
+/** High bit set in every byte of `v` equal to `c`. */
+static inline scan_word_t scan_eq_bytes(scan_word_t v, unsigned char c){ return scan_zero_bytes(v ^ (SCAN_ONES*c)); }
+
+static inline size_t scan_ws(const char* s, size_t n){
+  size_t i=0;
+  if (n && !scan_is_ws((unsigned char)s[0])) return 0;
+  for (; i+sizeof(scan_word_t)<=n; i+=sizeof(scan_word_t)){
+    scan_word_t v; memcpy(&v, s+i, sizeof(v));
+    scan_word_t ws = scan_eq_bytes(v,' ') | scan_eq_bytes(v,'\t') | scan_eq_bytes(v,'\r') | scan_eq_bytes(v,'\n');
+    scan_word_t nonws = ~ws & SCAN_HI;
+    if (nonws) return i + (size_t)(SCAN_CTZ(nonws) >> 3);
+  }
+  return i + scan_ws_scalar(s+i, n-i);
+}
+
+static inline size_t scan_str(const char* s, size_t n){
+  size_t i=0;
+  for (; i+sizeof(scan_word_t)<=n; i+=sizeof(scan_word_t)){
+    scan_word_t v; memcpy(&v, s+i, sizeof(v));
+    scan_word_t hit = scan_eq_bytes(v,'"') | scan_eq_bytes(v,'\\');
+    if (hit) return i + (size_t)(SCAN_CTZ(hit) >> 3);
+  }
+  return i + scan_str_scalar(s+i, n-i);
+}
+
+#define BJSON_UTF8_KERNEL "swar"
+static inline size_t scan_utf8(const char* s, size_t n){
+  const unsigned char* u = (const unsigned char*)s;
+  size_t i=0, k;
+  while (i+sizeof(scan_word_t) <= n){
+    scan_word_t v; memcpy(&v, s+i, sizeof(v));
+    if (!(v & SCAN_HI)){ i += sizeof(v); continue; }   // ASCII word
+    for (size_t end = i + sizeof(v); i < end; i += k) if (!(k = utf8_seq(u+i, n-i))) return i;
+  }
+  return i + scan_utf8_scalar(s+i, n-i);
+}
+#endif
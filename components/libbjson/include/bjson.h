@@ -1,41 +1,215 @@
 #pragma once
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include "bjson_types.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * Document header (12 bytes):
+ *   "BJSN" | ver_major(1) | ver_minor(1) | flags(u16 LE) | count(u32 LE)
+ * Optional sections announced by `flags` follow the last entry.
+ *
+ * Entry: type(u8) | nlen(u8) | pad(u8) | rsv(u8) | vlen(u32 LE) | name | value
+ * `pad` leading value bytes keep aligned values aligned; the next entry
+ * starts 4-byte aligned after the value plus `rsv` reserved 4-byte words
+ * (zero-filled room a BJD_T_STR may grow into with bjd_set_str).
+ * A BJD_T_OBJ/BJD_T_ARR value is u32 count + child entries, and vlen
+ * spans the whole subtree (skip pointer). A packed BJD_T_ARR_* value is the elements back to back,
+ * `pad` making them naturally aligned. `count` in the header counts
+ * top-level entries only.
+ *
+ * Compact profile (BJD_F_COMPACT, transport and storage):
+ *   type(u8) | nlen(u8) | name | vlen(varint) | value
+ * No padding and no reserved words; a container value is count(varint) +
+ * child entries. Varints are LEB128, at most 5 bytes. Every bjd_* reader
+ * works on it unchanged, except that packed arrays are unaligned
+ * (bjd_get_array) and strings cannot be rewritten (bjd_set_str);
+ * bjson_expand converts it to the aligned profile.
+ *
+ * String back-references (BJD_F_SREF): a BJD_T_SREF value is
+ * u32 offset | u32 length of an earlier string value in the same document
+ * (offset from the document start). Lookups, iteration and every
+ * converter resolve it in O(1) and see a BJD_T_STR entry whose `val`
+ * points at the earlier bytes; the target must end before the
+ * referencing entry.
+ */
+#define BJD_HDR_SIZE   12
+#define BJD_F_INDEX    0x0001u  /**< hashed key index + entry offset table after the entries */
+#define BJD_F_CRC      0x0002u  /**< u32 CRC-32 of all preceding bytes in the last 4 bytes */
+#define BJD_F_RESERVE  0x0004u  /**< BJD_T_STR entries may carry reserved capacity (`rsv`) */
+#define BJD_F_DICT     0x0008u  /**< names may be key IDs; u32 dictionary hash follows the header */
+#define BJD_F_COMPACT  0x0010u  /**< compact profile: varint lengths, no padding (no INDEX/RESERVE) */
+#define BJD_F_SREF     0x0020u  /**< BJD_T_SREF entries may refer back to earlier string values */
+#define BJD_F_CPLIMIT  0x0040u  /**< STR_N limits count code points, not bytes (BJSON_ENC_F_CPLIMIT) */
+#define BJD_DICT_HDR_SIZE 16    /**< header + dictionary hash (BJD_F_DICT) */
+#define BJD_KEY_ID_LEN 3        /**< key-ID name: 0x00, id (u16 LE) */
+
 typedef enum { 
   BJD_OK=0, 
   BJD_EINVAL, 
-  BJD_EMAGIC 
+  BJD_EMAGIC,
+  BJD_ECORRUPT,        // bjd_validate: structure does not hold
+  BJD_ECRC,            // bjd_validate: BJD_F_CRC checksum mismatch
+  BJD_EBUF,            // bjd_to_json: output buffer too short / sink aborted
+  BJD_EDICT            // BJD_F_DICT: dictionary missing or hash mismatch
 } bjd_err_t;
 
-typedef enum { 
-  BJD_T_STR=1, 
-  BJD_T_I16, 
-  BJD_T_U16, 
-  BJD_T_I32, 
-  BJD_T_U32 
-} bjd_type_t;
+/**
+ * Key dictionary shared by encoder and reader (BJD_F_DICT). `keys` are
+ * sorted by strcmp, unique and 4..255 bytes long; a key's ID is its
+ * index. Build it with bjd_dict_init, which also computes `hash`.
+ */
+typedef struct bjd_dict_s {
+  const char* const* keys;
+  uint16_t count;
+  uint32_t hash;
+} bjd_dict_t;
 
 typedef struct {
   bjd_type_t type;
-  const char* name;  uint8_t name_len;
-  const uint8_t* val; uint32_t val_len;
+  const char* name;  uint8_t name_len;    // stored name (a key ID in BJD_F_DICT docs, see bjd_entry_name)
+  const uint8_t* val; uint32_t val_len;   // past the leading pad
+  const bjd_dict_t* dict;                 // the document's dictionary, NULL if none
+  uint8_t compact;                        // decoded from a BJD_F_COMPACT document
+  const uint8_t* root;                    // BJD_F_SREF: document start back-references resolve against, else NULL
 } bjd_entry_t;
 
 typedef struct {
   const uint8_t* base; size_t len; uint32_t count; const uint8_t* entries;
+  uint16_t flags;
+  uint32_t nslots; const uint8_t* slots; const uint8_t* offs; // BJD_F_INDEX only, else 0/NULL
+  uint8_t  trusted;  // set by bjd_validate: lookups skip per-entry bounds checks
+  const bjd_dict_t* dict;  // bjd_use_dict (BJD_F_DICT), inherited by bjd_enter views
+  uint8_t  compact;  // BJD_F_COMPACT entry layout, inherited by bjd_enter views
+  const uint8_t* root;  // BJD_F_SREF: document start, inherited by bjd_enter views
+  uint8_t  arr;      // bjd_enter view of a BJD_T_ARR (unnamed children), else 0
 } bjd_doc_t;
 
+/** Pre-resolved key handle: length and hash computed once by bjd_key_init / bjd_key_init_dict. */
+typedef struct {
+  const char* name; uint8_t len; uint32_t hash;
+  uint8_t has_id; char id[BJD_KEY_ID_LEN]; uint32_t id_hash;  // key ID for BJD_F_DICT docs (bjd_key_init_dict)
+} bjd_key_t;
+
+/** String slice into the document buffer (not NUL-terminated). */
+typedef struct {
+  const char* s; uint32_t n;
+} bjd_str_t;
+
+typedef enum {
+  BJD_BIND_MISSING=0,   // key not present
+  BJD_BIND_OK,
+  BJD_BIND_ETYPE        // present, but stored type/size does not fit `type`
+} bjd_bind_status_t;
+
+/**
+ * One row of a bjd_bind table. `dst` is the C type of `type` (int32_t* for
+ * BJD_T_I32, bjd_str_t* for BJD_T_STR, uint8_t* for BJD_T_BOOL, raw int32_t*
+ * for BJD_T_FIX32, bjd_doc_t* (child view) for BJD_T_OBJ/ARR, ...). An entry is accepted when it has the same kind and
+ * is no wider than `type` (see bjson_types.h).
+ */
+typedef struct {
+  const bjd_key_t* key;
+  bjd_type_t type;
+  void* dst;
+  bjd_bind_status_t status;  // out
+} bjd_bind_t;
+
+/** Entry cursor over one document level (bjd_iter_init/bjd_iter_next); fields are private. */
+typedef struct {
+  const uint8_t* cur; const uint8_t* end; uint32_t left; uint32_t index;
+  uint8_t trusted, compact;
+  const bjd_dict_t* dict;
+  const uint8_t* root;
+} bjd_iter_t;
+
+/** Deepest container nesting bjd_visit walks (matches the encoder limit). */
+#define BJD_DEPTH_MAX 16
+
+/**
+ * bjd_visit callback. `depth` is 0 for top-level entries; `leave` is 1 on
+ * the second call for a container, after its children. Return non-zero
+ * to stop the walk.
+ */
+typedef int (*bjd_visit_fn)(const bjd_entry_t* e, uint32_t depth, int leave, void* user);
+
+/** bjd_to_json_cb sink: consume `n` bytes of JSON text; non-zero aborts. */
+typedef int (*bjd_write_fn)(const char* p, size_t n, void* user);
+
+/** 32-bit FNV-1a hash of a key; shared by the encoder's index writer and the reader. */
+uint32_t  bjd_hash(const char* key, size_t n);
+
+/** CRC-32 (zlib-compatible), chainable: crc = bjd_crc32(crc, p, n), start with 0. */
+uint32_t  bjd_crc32(uint32_t crc, const void* p, size_t n);
+/** Carry an in-place change (CRC of old span ^ CRC of new span) over `n` trailing bytes. */
+uint32_t  bjd_crc32_shift(uint32_t d, size_t n);
+
 bjd_err_t bjd_open(const uint8_t* buf, size_t len, bjd_doc_t* doc);
+bjd_err_t bjd_doc_len(const uint8_t* buf, size_t cap, size_t* len);   // exact length of a document padded out to `cap`
+bjd_err_t bjd_validate(bjd_doc_t* doc);   // full structural pass (+ CRC), marks doc trusted
 int       bjd_find(const bjd_doc_t* doc, const char* key, bjd_entry_t* out); // -1 not found
+int       bjd_find_path(const bjd_doc_t* doc, const char* path, bjd_entry_t* out); // "a.b[2].c", -1 not found
+bjd_err_t bjd_enter(const bjd_entry_t* e, bjd_doc_t* sub);                 // container -> view of its children
 int       bjd_get_i32(const bjd_doc_t* doc, const char* key, int32_t* out);
 int       bjd_get_u32(const bjd_doc_t* doc, const char* key, uint32_t* out);
+int       bjd_get_i64(const bjd_doc_t* doc, const char* key, int64_t* out);
+int       bjd_get_u64(const bjd_doc_t* doc, const char* key, uint64_t* out);
+int       bjd_get_f32(const bjd_doc_t* doc, const char* key, float* out);
+int       bjd_get_f64(const bjd_doc_t* doc, const char* key, double* out);
+int       bjd_get_bool(const bjd_doc_t* doc, const char* key, bool* out);
+int       bjd_get_fix(const bjd_doc_t* doc, const char* key, int32_t* raw, uint8_t* scale); // value = raw / 10^scale
+int       bjd_get_array(const bjd_doc_t* doc, const char* key, bjd_type_t elem, const void** p, uint32_t* n);
+
+/* Typed zero-copy wrappers: bjd_get_array_i16(doc, "ARR_INT16_CAL", &p, &n), ... */
+#define BJD_X_GET_ARRAY(name, ctype, sfx) \
+  static inline int bjd_get_array_##sfx(const bjd_doc_t* doc, const char* key, const ctype** p, uint32_t* n){ \
+    return bjd_get_array(doc, key, BJD_T_##name, (const void**)p, n); }
+BJD_PACKED_TYPES(BJD_X_GET_ARRAY)
+#undef BJD_X_GET_ARRAY
 int       bjd_get_str(const bjd_doc_t* doc, const char* key, const char** s, uint32_t* n);
 
+void      bjd_iter_init(bjd_iter_t* it, const bjd_doc_t* doc);
+int       bjd_iter_next(bjd_iter_t* it, bjd_entry_t* out);                       // 1 entry, 0 end, -1 corrupt
+int       bjd_visit(const bjd_doc_t* doc, bjd_visit_fn fn, void* user);            // 0 done, fn's stop value, -1 corrupt
+int       bjd_entry_value(const bjd_entry_t* e, bjd_type_t want, void* dst);       // bjd_get_* rules on an entry
+
+/*
+ * Key dictionaries (BJD_F_DICT). Names found in the dictionary are stored
+ * as 3-byte key IDs; other names stay literal. Attach the dictionary
+ * after bjd_open and before bjd_validate; lookups by name then compare
+ * the ID, and names read back through bjd_entry_name.
+ */
+int         bjd_dict_init(bjd_dict_t* dict, const char* const* keys, uint16_t n);   // -1 unsorted/duplicate/not 4..255 bytes
+int         bjd_dict_id(const bjd_dict_t* dict, const char* key, size_t n);        // -1 not in dict
+bjd_err_t   bjd_use_dict(bjd_doc_t* doc, const bjd_dict_t* dict);                  // BJD_EDICT on hash mismatch
+const char* bjd_entry_name(const bjd_entry_t* e, uint8_t* len);                    // key text (resolves key IDs)
+
+bjd_err_t bjd_to_json(const bjd_doc_t* doc, char* out, size_t cap, size_t* len);    // compact JSON; out NULL: size only
+bjd_err_t bjd_to_json_cb(const bjd_doc_t* doc, bjd_write_fn fn, void* user, size_t* len); // same, through a sink
+bjd_err_t bjd_to_cbor(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len);   // CBOR map; out NULL: size only
+bjd_err_t bjd_to_msgpack(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len); // MessagePack map; out NULL: size only
+
+/*
+ * In-place patching on a writable buffer (doc->base must point at RAM).
+ * No entry moves: numbers keep their stored width (range checked), strings
+ * grow up to the value bytes + reserved capacity and respect the STR_N
+ * limit (not in BJD_F_SREF documents, where a string may be shared). `doc` must be the root document (bjd_open), not a bjd_enter view,
+ * so the header flags and the BJD_F_CRC trailer stay in sync; nested
+ * entries are reached by path ("net.port").
+ */
+int       bjd_set_i32(bjd_doc_t* doc, const char* path, int32_t v);              // 0 ok, -1 missing/type/range
+int       bjd_set_u32(bjd_doc_t* doc, const char* path, uint32_t v);             // 0 ok, -1 missing/type/range
+int       bjd_set_str(bjd_doc_t* doc, const char* path, const char* s, size_t n); // 0 ok, -1 missing/type/no room
+
+int       bjd_key_init(bjd_key_t* k, const char* name);                           // -1 if name > 255 bytes
+int       bjd_key_init_dict(bjd_key_t* k, const bjd_dict_t* dict, const char* name); // key ID if in `dict`, else as bjd_key_init
+int       bjd_find_key(const bjd_doc_t* doc, const bjd_key_t* k, bjd_entry_t* out); // -1 not found
+int       bjd_bind(const bjd_doc_t* doc, bjd_bind_t* rows, size_t n);               // 0 all bound, else #failed rows
+
 #ifdef __cplusplus
 }
 #endif
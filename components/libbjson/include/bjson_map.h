@@ -0,0 +1,37 @@
+#pragma once
+#include "bjson.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Read-only mapping of a precompiled BJSON image (host `bjsonc` output).
+ * `doc` reads straight from the mapping: no copy, no heap for the data.
+ * On ESP-IDF `name` is the label of a data partition (subtype
+ * BJD_PART_SUBTYPE) mapped with esp_partition_mmap; on POSIX hosts it is
+ * a file path mapped with mmap. Fields other than `doc` are private.
+ */
+typedef struct {
+  bjd_doc_t   doc;
+  const void* map; size_t map_len;
+  uint32_t    handle;   // esp_partition_mmap_handle_t on ESP-IDF
+} bjd_map_t;
+
+/** Partition subtype of BJSON image partitions (custom data subtype). */
+#define BJD_PART_SUBTYPE 0x40
+
+/**
+ * Map `name`, find the document length with bjd_doc_len and bjd_open it.
+ * `dict` is attached (bjd_use_dict) when the image has BJD_F_DICT and is
+ * ignored otherwise; NULL for none. With `validate` non-zero
+ * bjd_validate runs once here (CRC + structure), after the dictionary,
+ * so every later read uses the trusted fast path. A BJD_F_DICT image
+ * opened without its dictionary fails validation with BJD_EDICT.
+ */
+bjd_err_t bjd_open_mapped(const char* name, int validate, const bjd_dict_t* dict, bjd_map_t* m);
+void      bjd_close_mapped(bjd_map_t* m);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,105 @@
+#pragma once
+#include "bjson.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Paged reading of documents larger than RAM (logs, asset tables on
+ * SPIFFS / a data partition). The document stays in storage; a read
+ * callback fills a small LRU cache of blocks from caller memory, and
+ * lookups read only the entry headers they walk (or the index slots
+ * they probe) plus the values they return. Nothing is allocated.
+ *
+ *   static uint8_t mem[8 * 512] __attribute__((aligned(8)));
+ *   bjd_pcache_t c; bjd_pdoc_t doc; int32_t v; bjd_pin_t s;
+ *   bjd_pcache_init(&c, file_read, fp, mem, sizeof mem, 512);
+ *   bjd_open_paged(&c, file_len, &doc);
+ *   bjd_pg_get_i32(&doc, "INT32_RATE", &v);
+ *   if (bjd_pg_get_str(&doc, "STR_32_NAME", &s) == 0){ use(s.p, s.n); bjd_pg_unpin(&c, &s); }
+ *
+ * Lookups follow bjd_find / bjd_get_* exactly (index when present, key
+ * IDs with a dictionary, the same stored-type rules); every entry is
+ * bounds-checked as on an unvalidated document. Numbers are copied out;
+ * strings and packed arrays come back as pinned slices of a cached
+ * block, which stays in the cache until bjd_pg_unpin. A value must fit
+ * in one block to be pinned (bjd_pg_read copies any range).
+ */
+
+/** pread-style source: copy `n` bytes at document offset `off` to `dst`; 0 on success. */
+typedef int (*bjd_read_fn)(void* user, uint32_t off, void* dst, size_t n);
+
+#define BJD_PAGE_SLOTS_MAX 32    /**< most cached blocks */
+#define BJD_PAGE_BLOCK_MIN 512   /**< smallest block: holds any entry header with its name */
+
+/** One cached block; fields are private. */
+typedef struct {
+  uint32_t off, n;     // document range held, n == 0: empty
+  uint32_t used;       // LRU stamp
+  uint16_t pins;       // pinned slices into this block
+} bjd_pslot_t;
+
+/**
+ * Block cache shared by a document and its bjd_pg_enter views. The
+ * counters run from bjd_pcache_init; clear them between measurements.
+ */
+typedef struct {
+  bjd_read_fn read; void* user;
+  uint8_t* mem; uint32_t block, nslots, len;   // len: document length (bjd_open_paged)
+  bjd_pslot_t slot[BJD_PAGE_SLOTS_MAX];
+  uint32_t tick, last;
+  uint32_t reads, hits;      // read callbacks / accesses served from the cache
+  uint64_t read_bytes;       // bytes requested from `read`
+} bjd_pcache_t;
+
+/** Paged document or container view, the counterpart of bjd_doc_t (offsets instead of pointers). */
+typedef struct {
+  bjd_pcache_t* c;
+  uint32_t base, len, count, entries;
+  uint16_t flags;
+  uint32_t nslots, slots, offs;   // BJD_F_INDEX (root only), else 0
+  const bjd_dict_t* dict;
+  uint8_t  compact;
+  uint8_t  sref;                  // BJD_F_SREF: back-references resolve, inherited by views
+} bjd_pdoc_t;
+
+/** Entry located in a paged document; values are read on demand. */
+typedef struct {
+  bjd_type_t type;
+  uint8_t  name_len, compact, sref;
+  uint32_t off;                 // entry header
+  uint32_t val, val_len;        // value (past the leading pad; a back-reference's target)
+  uint32_t next;                // following entry
+  const bjd_dict_t* dict;
+} bjd_pentry_t;
+
+/** Pinned slice of a cached block; release with bjd_pg_unpin. */
+typedef struct {
+  const uint8_t* p; uint32_t n;   // n: bytes (strings) or elements (arrays)
+  int16_t slot;                   // -1 when nothing is pinned
+} bjd_pin_t;
+
+/** `mem` (8-byte aligned) is split into `block`-byte slots; block >= BJD_PAGE_BLOCK_MIN, a multiple of 8. */
+bjd_err_t bjd_pcache_init(bjd_pcache_t* c, bjd_read_fn read, void* user, void* mem, size_t mem_size, uint32_t block);
+bjd_err_t bjd_open_paged(bjd_pcache_t* c, size_t len, bjd_pdoc_t* doc);      // `len`: exact document length
+bjd_err_t bjd_pg_use_dict(bjd_pdoc_t* doc, const bjd_dict_t* dict);         // as bjd_use_dict
+int       bjd_pg_find(const bjd_pdoc_t* doc, const char* key, bjd_pentry_t* out); // -1 not found
+bjd_err_t bjd_pg_enter(const bjd_pdoc_t* doc, const bjd_pentry_t* e, bjd_pdoc_t* sub);
+int       bjd_pg_entry_value(const bjd_pdoc_t* doc, const bjd_pentry_t* e, bjd_type_t want, void* dst); // numbers and BOOL
+int       bjd_pg_get_i32(const bjd_pdoc_t* doc, const char* key, int32_t* out);
+int       bjd_pg_get_u32(const bjd_pdoc_t* doc, const char* key, uint32_t* out);
+int       bjd_pg_get_i64(const bjd_pdoc_t* doc, const char* key, int64_t* out);
+int       bjd_pg_get_u64(const bjd_pdoc_t* doc, const char* key, uint64_t* out);
+int       bjd_pg_get_f32(const bjd_pdoc_t* doc, const char* key, float* out);
+int       bjd_pg_get_f64(const bjd_pdoc_t* doc, const char* key, double* out);
+int       bjd_pg_get_bool(const bjd_pdoc_t* doc, const char* key, bool* out);
+int       bjd_pg_get_fix(const bjd_pdoc_t* doc, const char* key, int32_t* raw, uint8_t* scale);
+int       bjd_pg_get_str(const bjd_pdoc_t* doc, const char* key, bjd_pin_t* s);                   // pinned
+int       bjd_pg_get_array(const bjd_pdoc_t* doc, const char* key, bjd_type_t elem, bjd_pin_t* a); // pinned
+void      bjd_pg_unpin(bjd_pcache_t* c, bjd_pin_t* pin);
+int       bjd_pg_read(bjd_pcache_t* c, uint32_t off, void* dst, size_t n);    // copy any range through the cache
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Type registry shared by the encoder (key classification, range checks)
+ * and the reader (getter type validation).
+ *
+ * BJD_WIRE_TYPES: one row per wire type byte.
+ *   X(name, id, kind, width, min, max)   -> BJD_T_<name> = id
+ * BJD_KEY_PREFIXES: one row per key prefix, KEPT SORTED BY PREFIX BYTES
+ * (the classifier narrows a sorted range in a single pass over the key;
+ * host/test/bjson_test fails on a row out of order).
+ *   X(prefix, wire name, limit)           limit = STR_N byte cap, else 0
+ * BJD_K_FIX prefixes are followed by "<scale>_" in the key, e.g.
+ * FIX16_2_TEMP stores 23.45 as the raw int16 2345 (see bjd_key_scale).
+ * Containers (OBJ/ARR) have no key prefix: any key whose value is '{' or
+ * '[' names a container. SREF (string back-reference, BJD_F_SREF) has no
+ * prefix either: the encoder writes it in place of a repeated STR value
+ * and readers return the referenced string as BJD_T_STR.
+ * BJD_PACKED_TYPES: scalar types that also exist as packed arrays. The
+ * packed wire type is BJD_PACKED | <scalar id> (BJD_T_ARR_I16, ...); the
+ * elements are the scalar's registry row, stored contiguously.
+ *   X(scalar name, C element type, accessor suffix)
+ */
+#define BJD_WIRE_TYPES(X) \
+  X(STR,   1,  BJD_K_STR,   0,  0,          0)          \
+  X(I16,   2,  BJD_K_INT,   2,  INT16_MIN,  INT16_MAX)  \
+  X(U16,   3,  BJD_K_UINT,  2,  0,          UINT16_MAX) \
+  X(I32,   4,  BJD_K_INT,   4,  INT32_MIN,  INT32_MAX)  \
+  X(U32,   5,  BJD_K_UINT,  4,  0,          UINT32_MAX) \
+  X(I64,   6,  BJD_K_INT,   8,  INT64_MIN,  INT64_MAX)  \
+  X(U64,   7,  BJD_K_UINT,  8,  0,          UINT64_MAX) \
+  X(F32,   8,  BJD_K_FLOAT, 4,  0,          0)          \
+  X(F64,   9,  BJD_K_FLOAT, 8,  0,          0)          \
+  X(BOOL,  10, BJD_K_BOOL,  1,  0,          1)          \
+  X(FIX16, 11, BJD_K_FIX,   2,  INT16_MIN,  INT16_MAX)  \
+  X(FIX32, 12, BJD_K_FIX,   4,  INT32_MIN,  INT32_MAX)  \
+  X(OBJ,   13, BJD_K_OBJ,   0,  0,          0)          \
+  X(ARR,   14, BJD_K_ARR,   0,  0,          0)          \
+  X(SREF,  15, BJD_K_STR,   0,  0,          0)
+
+#define BJD_PACKED_TYPES(X) \
+  X(I16, int16_t,  i16) \
+  X(U16, uint16_t, u16) \
+  X(I32, int32_t,  i32) \
+  X(U32, uint32_t, u32) \
+  X(I64, int64_t,  i64) \
+  X(U64, uint64_t, u64) \
+  X(F32, float,    f32) \
+  X(F64, double,   f64)
+
+#define BJD_KEY_PREFIXES(X) \
+  X("ARR_FLOAT32_", ARR_F32, 0) \
+  X("ARR_FLOAT64_", ARR_F64, 0) \
+  X("ARR_INT16_",   ARR_I16, 0) \
+  X("ARR_INT32_",   ARR_I32, 0) \
+  X("ARR_INT64_",   ARR_I64, 0) \
+  X("ARR_UINT16_",  ARR_U16, 0) \
+  X("ARR_UINT32_",  ARR_U32, 0) \
+  X("ARR_UINT64_",  ARR_U64, 0) \
+  X("BOOL_",    BOOL,  0)   \
+  X("FIX16_",   FIX16, 0)   \
+  X("FIX32_",   FIX32, 0)   \
+  X("FLOAT32_", F32,   0)   \
+  X("FLOAT64_", F64,   0)   \
+  X("INT16_",   I16,   0)   \
+  X("INT32_",   I32,   0)   \
+  X("INT64_",   I64,   0)   \
+  X("STR_128_", STR,   128) \
+  X("STR_256_", STR,   256) \
+  X("STR_32_",  STR,   32)  \
+  X("STR_64_",  STR,   64)  \
+  X("UINT16_",  U16,   0)   \
+  X("UINT32_",  U32,   0)   \
+  X("UINT64_",  U64,   0)
+
+#define BJD_FIX_SCALE_MAX 9
+
+/** Wire type bit marking a packed array; the low bits are the element type. */
+#define BJD_PACKED          0x40u
+#define BJD_IS_PACKED(t)    (((t) & BJD_PACKED) != 0)
+#define BJD_ELEM_TYPE(t)    ((uint8_t)((t) & ~BJD_PACKED))
+
+typedef enum {
+  BJD_K_STR=1,   // byte string
+  BJD_K_INT,     // signed little-endian integer of `width` bytes
+  BJD_K_UINT,    // unsigned little-endian integer of `width` bytes
+  BJD_K_FLOAT,   // IEEE-754 binary32/binary64, little-endian
+  BJD_K_BOOL,    // one byte, 0 or 1
+  BJD_K_FIX,     // signed raw integer scaled by 10^scale (scale in the key)
+  BJD_K_OBJ,     // container: u32 count + named child entries
+  BJD_K_ARR      // container: u32 count + unnamed child entries
+} bjd_kind_t;
+
+typedef enum {
+#define BJD_X_ENUM(name, id, kind, width, mn, mx) BJD_T_##name = id,
+  BJD_WIRE_TYPES(BJD_X_ENUM)
+#undef BJD_X_ENUM
+#define BJD_X_PACKED(name, ctype, sfx) BJD_T_ARR_##name = BJD_PACKED | BJD_T_##name,
+  BJD_PACKED_TYPES(BJD_X_PACKED)
+#undef BJD_X_PACKED
+} bjd_type_t;
+
+typedef struct {
+  uint8_t  type;       // bjd_type_t
+  uint8_t  kind;       // bjd_kind_t
+  uint8_t  width;      // value bytes for fixed-size kinds, 0 for strings/containers
+  int64_t  min;        // inclusive range for integer kinds (raw value for FIX)
+  uint64_t max;
+} bjd_type_info_t;
+
+typedef struct {
+  const char* prefix; uint8_t plen;
+  uint8_t  type;       // bjd_type_t
+  uint16_t limit;      // STR_N byte cap
+} bjd_prefix_t;
+
+/** Registry row for a wire type byte, NULL if unknown (packed types: use BJD_ELEM_TYPE). */
+const bjd_type_info_t* bjd_type_info(uint8_t type);
+/** Element width of a packed array of `elem`, 0 unless `elem` is a BJD_PACKED_TYPES scalar. */
+uint8_t                bjd_packed_width(uint8_t elem);
+/** Longest registered prefix of `key` in one pass over its bytes, NULL if none. */
+const bjd_prefix_t*    bjd_classify_key(const char* key, size_t klen);
+/** Scale of a BJD_K_FIX key ("FIX16_<scale>_..."), -1 if malformed. */
+int                    bjd_key_scale(const char* key, size_t klen, const bjd_prefix_t* pr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,11 +18,86 @@ static uint32_t r32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<
  */
 static const uint8_t* align4p(const uint8_t* p){ uintptr_t x=(uintptr_t)p; return (const uint8_t*)((x+3)&~(uintptr_t)3); }
 
+/**
+ * @brief Read a LEB128 varint (BJD_F_COMPACT lengths and counts).
+ *
+ * @param p First byte.
+ * @param end Pointer one past the readable bytes.
+ * @param v[out] Value on success.
+ * @return Pointer past the varint, or NULL if it is truncated or does not fit 32 bits.
+ */
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint32_t* v){
+  uint32_t x = 0;
+  for (unsigned sh=0; sh<35; sh+=7){
+    if (p >= end) return NULL;
+    uint8_t b = *p++;
+    if (sh == 28 && b > 0x0F) return NULL;
+    x |= (uint32_t)(b & 0x7F) << sh;
+    if (!(b & 0x80)){ *v = x; return p; }
+  }
+  return NULL;
+}
+
+/**
+ * @brief 32-bit FNV-1a hash of a key.
+ *
+ * Used for the optional index section (BJD_F_INDEX). The encoder writes
+ * slot hashes with this function, so it must never change for a given
+ * format version.
+ *
+ * @param key Key bytes (need not be NUL-terminated).
+ * @param n Number of bytes in `key`.
+ * @return Hash value.
+ */
+uint32_t bjd_hash(const char* key, size_t n){
+  uint32_t h = 2166136261u;
+  for (size_t i=0;i<n;i++){ h ^= (uint8_t)key[i]; h *= 16777619u; }
+  return h;
+}
+
+/**
+ * @brief Header size: the fixed header, plus the dictionary hash with BJD_F_DICT.
+ */
+static size_t hdr_size(uint16_t flags){ return (flags & BJD_F_DICT) ? BJD_DICT_HDR_SIZE : BJD_HDR_SIZE; }
+
+/**
+ * @brief Document length without the BJD_F_CRC trailer.
+ */
+static size_t payload_len(const bjd_doc_t* d){ return d->len - ((d->flags & BJD_F_CRC) ? 4 : 0); }
+
+/**
+ * @brief Locate and validate the index section announced by BJD_F_INDEX.
+ *
+ * Layout (all u32 LE, starting after the padded last entry):
+ * nslots, nslots x {hash, entry_index+1}, count x entry_offset, and a
+ * trailing u32 holding the section offset in the last 4 bytes of the doc
+ * (before the CRC trailer when BJD_F_CRC is also set).
+ *
+ * @param d Document with base/len/count already set.
+ * @return 1 if the section is well-formed, 0 otherwise.
+ */
+static int open_index(bjd_doc_t* d){
+  size_t len = payload_len(d), hdr = hdr_size(d->flags);
+  if (len < hdr + 8) return 0;
+  uint32_t off = r32(d->base + len - 4);
+  if (off < hdr || off > len - 8) return 0;
+  uint32_t nslots = r32(d->base + off);
+  if (nslots==0 || (nslots & (nslots-1)) || nslots < d->count) return 0;
+  uint64_t need = 4 + (uint64_t)nslots*8 + (uint64_t)d->count*4;
+  if (need > len - 4 - off) return 0;
+  d->nslots = nslots; d->slots = d->base + off + 4; d->offs = d->slots + (size_t)nslots*8;
+  return 1;
+}
+
 /**
  * @brief Open a BJSON document for reading.
  *
  * Validates the magic header and populates `bjd_doc_t`. The provided
- * buffer must remain valid for the lifetime of the document.
+ * buffer must remain valid for the lifetime of the document. When the
+ * header announces an index section it is validated here so lookups can
+ * use it; `len` must then be the exact document length (also with
+ * BJD_F_CRC). Only the header is checked here; see bjd_validate.
+ * BJD_F_DICT documents need bjd_use_dict before names can be looked up.
  *
  * @param buf Pointer to BJSON buffer.
  * @param len Length of buffer in bytes.
@@ -30,36 +105,277 @@ static const uint8_t* align4p(const uint8_t* p){ uintptr_t x=(uintptr_t)p; retur
  * @return BJD_OK on success, or an error code on invalid input/magic.
  */
 bjd_err_t bjd_open(const uint8_t* buf, size_t len, bjd_doc_t* d){
-  if (!buf || len<12 || !d) return BJD_EINVAL;
+  if (!buf || len<BJD_HDR_SIZE || !d) return BJD_EINVAL;
   if (memcmp(buf,"BJSN",4)!=0) return BJD_EMAGIC;
-  d->base=buf; d->len=len; d->count=r32(buf+8); d->entries=buf+12; return BJD_OK;
+  memset(d,0,sizeof(*d));
+  d->base=buf; d->len=len; d->count=r32(buf+8);
+  d->flags=(uint16_t)(buf[6] | (buf[7]<<8));
+  size_t hdr = hdr_size(d->flags);
+  d->entries=buf+hdr; d->compact=(d->flags & BJD_F_COMPACT) != 0;
+  if (len < hdr + ((d->flags & BJD_F_CRC) ? 4 : 0)) return BJD_EINVAL;
+  if (d->compact && (d->flags & (BJD_F_INDEX | BJD_F_RESERVE))) return BJD_EINVAL;
+  if ((d->flags & BJD_F_INDEX) && !open_index(d)) return BJD_EINVAL;
+  if (d->flags & BJD_F_SREF) d->root = buf;
+  return BJD_OK;
+}
+
+/**
+ * @brief Exact length of the document at the start of `buf`.
+ *
+ * For images whose length is not stored next to them (flash partitions,
+ * padded files): walks the top-level entries by their skip pointers and
+ * adds the optional sections announced in the header. Nothing past the
+ * document is read, so `cap` may be the whole partition.
+ *
+ * @param buf Start of the document.
+ * @param cap Bytes readable at `buf`.
+ * @param len[out] Document length, ready for bjd_open.
+ * @return BJD_OK, BJD_EMAGIC, or BJD_EINVAL if the document does not fit in `cap`.
+ */
+bjd_err_t bjd_doc_len(const uint8_t* buf, size_t cap, size_t* len){
+  if (!buf || cap<BJD_HDR_SIZE || !len) return BJD_EINVAL;
+  if (memcmp(buf,"BJSN",4)!=0) return BJD_EMAGIC;
+  bjd_doc_t d; bjd_iter_t it; bjd_entry_t e; int r;
+  memset(&d,0,sizeof(d));
+  uint16_t flags=(uint16_t)(buf[6] | (buf[7]<<8));
+  if (cap < hdr_size(flags)) return BJD_EINVAL;
+  d.base=buf; d.len=cap; d.count=r32(buf+8); d.entries=buf+hdr_size(flags);
+  d.compact=(flags & BJD_F_COMPACT) != 0; d.root=(flags & BJD_F_SREF) ? buf : NULL;
+  if (d.compact && (flags & BJD_F_INDEX)) return BJD_EINVAL;
+  bjd_iter_init(&it, &d);
+  while ((r = bjd_iter_next(&it, &e)) > 0) {}
+  if (r < 0 || it.cur > buf + cap) return BJD_EINVAL;
+  uint64_t n = (uint64_t)(it.cur - buf);
+  if (flags & BJD_F_INDEX){
+    if (cap - n < 4) return BJD_EINVAL;
+    n += 4 + (uint64_t)r32(it.cur)*8 + (uint64_t)d.count*4 + 4;
+  }
+  if (flags & BJD_F_CRC) n += 4;
+  if (n > cap) return BJD_EINVAL;
+  *len = (size_t)n;
+  return BJD_OK;
 }
 
 /**
- * @brief Compute pointer to next entry given current entry pointer.
+ * @brief Decode the entry header at `cur` without any checks.
  *
- * Validates header size, name length and value length against `end`.
+ * Only for entries already proven in bounds (load_ent, trusted docs).
  *
- * @param cur Current entry pointer.
+ * @param cur Entry pointer.
+ * @param dict Dictionary of the document (NULL if none).
+ * @param out[out] Entry metadata.
+ */
+static void decode_ent(const uint8_t* cur, const bjd_dict_t* dict, bjd_entry_t* out){
+  uint8_t nlen = cur[1], pad = cur[2];
+  out->type=(bjd_type_t)cur[0]; out->name=(const char*)(cur+8); out->name_len=nlen;
+  out->val=cur+8+nlen+pad; out->val_len=r32(cur+4)-pad;
+  out->dict=dict; out->compact=0;
+}
+
+/**
+ * @brief Decode the entry header at `cur` into `out`.
+ *
+ * Header byte 2 is the leading value padding (aligned values such as
+ * container counts); `val` points past it. Header byte 3 (reserved
+ * words, see ent_end) must fit in front of `end`.
+ *
+ * @param cur Entry pointer.
  * @param end Pointer one past the end of buffer.
- * @param nxt[out] Pointer to next entry on success.
- * @return 1 on success, 0 on error/truncation.
+ * @param dict Dictionary of the document (NULL if none).
+ * @param out[out] Entry metadata on success.
+ * @return 1 on success, 0 if the entry is truncated.
  */
-static int next_ent(const uint8_t* cur, const uint8_t* end, const uint8_t** nxt){
+static int load_ent(const uint8_t* cur, const uint8_t* end, const bjd_dict_t* dict, bjd_entry_t* out){
   if ((size_t)(end-cur) < 8) return 0;
-  uint8_t nlen = cur[1];
+  uint8_t nlen = cur[1], pad = cur[2], rsv = cur[3];
   uint32_t vlen = r32(cur+4);
-  const uint8_t* after = cur + 8 + nlen + vlen;
-  if (after > end) return 0;
-  *nxt = align4p(after);
+  if ((size_t)(end-cur-8) < (size_t)nlen + vlen || pad > vlen) return 0;
+  if (rsv){ // reserved capacity must stay inside the document / container
+    const uint8_t* a = align4p(cur+8+nlen+vlen);
+    if (a > end || (size_t)(end-a) < 4u*rsv) return 0;
+  }
+  decode_ent(cur, dict, out);
   return 1;
 }
 
+/**
+ * @brief Decode a BJD_F_COMPACT entry at `cur` into `out`.
+ *
+ * type(u8) | nlen(u8) | name | vlen(varint) | value, no padding. The
+ * varint has to be parsed anyway, so trusted documents take this path
+ * too.
+ *
+ * @param cur Entry pointer.
+ * @param end Pointer one past the end of buffer.
+ * @param dict Dictionary of the document (NULL if none).
+ * @param out[out] Entry metadata on success.
+ * @return 1 on success, 0 if the entry is truncated.
+ */
+static int load_cent(const uint8_t* cur, const uint8_t* end, const bjd_dict_t* dict, bjd_entry_t* out){
+  if (end - cur < 2 || (size_t)(end-cur-2) < cur[1]) return 0;
+  uint32_t vlen;
+  const uint8_t* val = get_varint(cur+2+cur[1], end, &vlen);
+  if (!val || (size_t)(end-val) < vlen) return 0;
+  out->type=(bjd_type_t)cur[0]; out->name=(const char*)(cur+2); out->name_len=cur[1];
+  out->val=val; out->val_len=vlen;
+  out->dict=dict; out->compact=1;
+  return 1;
+}
+
+/**
+ * @brief Start of the entry after `e`.
+ *
+ * Header byte 3 counts reserved 4-byte words after the padded value
+ * (in-place growth room, BJD_F_RESERVE); they are skipped too.
+ * Compact entries end right after the value.
+ *
+ * @param e Entry decoded from a document.
+ * @return Pointer to the next entry.
+ */
+static const uint8_t* ent_end(const bjd_entry_t* e){
+  if (e->compact) return e->val + e->val_len;
+  const uint8_t* h = (const uint8_t*)e->name - 8;
+  return align4p(e->val + e->val_len) + 4u*h[3];
+}
+
+/**
+ * @brief Resolve a string back-reference (BJD_T_SREF) in place.
+ *
+ * The value is u32 offset | u32 length of an earlier string value; `e`
+ * becomes that BJD_T_STR (name unchanged). The target must end before
+ * the referencing entry, so references never chain or loop and stay in
+ * the document even on an unvalidated buffer. Compute the next entry
+ * (ent_end) before resolving.
+ *
+ * @param e Entry of type BJD_T_SREF, `root` set from its document.
+ * @return 1 on success, 0 without BJD_F_SREF or on a bad reference.
+ */
+static int sref(bjd_entry_t* e){
+  if (!e->root || e->val_len != 8) return 0;
+  uint32_t off = r32(e->val), n = r32(e->val+4);
+  size_t lim = (size_t)((const uint8_t*)e->name - e->root);
+  if (off > lim || n > lim - off) return 0;
+  e->type = BJD_T_STR; e->val = e->root + off; e->val_len = n;
+  return 1;
+}
+
+/**
+ * @brief Start iterating the entries of a document or container view.
+ *
+ * @param it[out] Cursor (plain struct, no allocation).
+ * @param d Document, or a container view from bjd_enter.
+ */
+void bjd_iter_init(bjd_iter_t* it, const bjd_doc_t* d){
+  it->cur=d->entries; it->end=d->base+d->len; it->left=d->count; it->index=0;
+  it->trusted=d->trusted; it->compact=d->compact; it->dict=d->dict; it->root=d->root;
+}
+
+/**
+ * @brief Yield the next entry.
+ *
+ * Each entry header is bounds-checked once (not at all on a document
+ * that passed bjd_validate); containers are yielded as
+ * one entry and their subtree is skipped (use bjd_enter to descend).
+ * This is the single entry walk behind every linear lookup. String
+ * back-references come out resolved, as BJD_T_STR.
+ *
+ * @param it Cursor from bjd_iter_init.
+ * @param out[out] Entry metadata.
+ * @return 1 with an entry, 0 at the end, -1 on a truncated/corrupt entry
+ *         (the cursor then stays at the end).
+ */
+int bjd_iter_next(bjd_iter_t* it, bjd_entry_t* out){
+  if (!it->left) return 0;
+  if (it->compact){ if (it->cur > it->end || !load_cent(it->cur, it->end, it->dict, out)){ it->left=0; return -1; } }
+  else if (it->trusted) decode_ent(it->cur, it->dict, out);
+  else if (it->cur > it->end || !load_ent(it->cur, it->end, it->dict, out)){ it->left=0; return -1; }
+  it->cur = ent_end(out);
+  it->left--; it->index++;
+  out->root = it->root;
+  if (out->type == BJD_T_SREF && !sref(out)){ it->left=0; return -1; }
+  return 1;
+}
+
+/**
+ * @brief Indexed lookup through the BJD_F_INDEX hash slots.
+ *
+ * Linear probing; an empty slot (entry_index+1 == 0) ends the probe.
+ *
+ * @param d Document with an index section.
+ * @param key Key bytes.
+ * @param klen Key length.
+ * @param h bjd_hash of the key.
+ * @param out[out] Entry metadata on success.
+ * @return Index of entry on success, -1 if not found or on error.
+ */
+static int find_indexed(const bjd_doc_t* d, const char* key, size_t klen, uint32_t h, bjd_entry_t* out){
+  const uint8_t* end = d->base + d->len;
+  uint32_t mask = d->nslots - 1;
+  for (uint32_t n=0, i=h&mask; n<d->nslots; n++, i=(i+1)&mask){
+    const uint8_t* s = d->slots + (size_t)i*8;
+    uint32_t ref = r32(s+4);
+    if (!ref) return -1;
+    if (r32(s)!=h || ref > d->count) continue;
+    uint32_t off = r32(d->offs + (size_t)(ref-1)*4);
+    bjd_entry_t e;
+    if (d->trusted) decode_ent(d->base+off, d->dict, &e);
+    else if (off > d->len || !load_ent(d->base+off, end, d->dict, &e)) return -1;
+    if (e.name_len==klen && memcmp(e.name,key,klen)==0){
+      e.root = d->root;
+      if (e.type == BJD_T_SREF && !sref(&e)) return -1;
+      *out=e; return (int)(ref-1);
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Linear lookup walking the entries from the first one.
+ *
+ * @param d Document to search.
+ * @param key Key bytes.
+ * @param klen Key length.
+ * @param out[out] Entry metadata on success.
+ * @return Index of entry on success, -1 if not found or on error.
+ */
+static int find_linear(const bjd_doc_t* d, const char* key, size_t klen, bjd_entry_t* out){
+  bjd_iter_t it; bjd_entry_t e;
+  bjd_iter_init(&it, d);
+  if (klen == BJD_KEY_ID_LEN && !key[0]){ // key ID: one 16-bit compare per entry
+    uint16_t id = (uint16_t)((uint8_t)key[1] | ((uint8_t)key[2] << 8));
+    while (bjd_iter_next(&it, &e) > 0)
+      if (e.name_len==BJD_KEY_ID_LEN && !e.name[0] && (uint16_t)((uint8_t)e.name[1] | ((uint8_t)e.name[2] << 8)) == id){ *out=e; return (int)it.index-1; }
+    return -1;
+  }
+  while (bjd_iter_next(&it, &e) > 0)
+    if (klen==e.name_len && memcmp(e.name,key,klen)==0){ *out=e; return (int)it.index-1; }
+  return -1;
+}
+
+/**
+ * @brief Stored form of `key`: its key ID when `dict` lists it, else the key itself.
+ *
+ * @param dict Dictionary of the document (NULL if none).
+ * @param key Key bytes.
+ * @param n[in,out] Key length; BJD_KEY_ID_LEN when an ID is returned.
+ * @param id Scratch for the ID bytes.
+ * @return `key` or `id`.
+ */
+static const char* stored_name(const bjd_dict_t* dict, const char* key, size_t* n, char* id){
+  int i = dict ? bjd_dict_id(dict, key, *n) : -1;
+  if (i < 0) return key;
+  id[0]=0; id[1]=(char)(uint8_t)i; id[2]=(char)(uint8_t)(i>>8);
+  *n = BJD_KEY_ID_LEN;
+  return id;
+}
+
 /**
  * @brief Find an entry by key name in the document.
  *
  * On success fills `out` with entry metadata and returns the index.
- * Returns -1 if not found.
+ * Returns -1 if not found. Uses the index section when present
+ * (O(1) expected), otherwise walks the entries linearly. With a
+ * dictionary attached, listed keys are matched by key ID.
  *
  * @param d Document to search.
  * @param key NUL-terminated key name to find.
@@ -67,21 +383,313 @@ static int next_ent(const uint8_t* cur, const uint8_t* end, const uint8_t** nxt)
  * @return Index of entry on success, -1 if not found or on error.
  */
 int bjd_find(const bjd_doc_t* d, const char* key, bjd_entry_t* out){
-  const uint8_t* cur = d->entries; const uint8_t* end = d->base + d->len;
-  size_t klen = strlen(key);
-  for (uint32_t i=0;i<d->count;i++){
-    uint8_t type = cur[0], nlen = cur[1];
-    uint32_t vlen = r32(cur+4);
-    const char* name=(const char*)(cur+8);
-    const uint8_t* val = (const uint8_t*)(cur+8+nlen);
-    if (klen==nlen && memcmp(name,key,nlen)==0){
-      out->type=(bjd_type_t)type; out->name=name; out->name_len=nlen; out->val=val; out->val_len=vlen; return (int)i;
+  size_t klen = strlen(key); char id[BJD_KEY_ID_LEN];
+  key = stored_name(d->dict, key, &klen, id);
+  if (d->slots) return find_indexed(d, key, klen, bjd_hash(key, klen), out);
+  return find_linear(d, key, klen, out);
+}
+
+/**
+ * @brief View a container entry as a document of its children.
+ *
+ * The view supports every lookup (bjd_find, bjd_get_*, bjd_bind, nested
+ * bjd_enter) with linear search over the children only; sibling
+ * subtrees are skipped through their value length.
+ *
+ * @param e Entry with type BJD_T_OBJ or BJD_T_ARR.
+ * @param sub[out] Child view on success.
+ * @return BJD_OK, or BJD_EINVAL if `e` is not a well-formed container.
+ */
+bjd_err_t bjd_enter(const bjd_entry_t* e, bjd_doc_t* sub){
+  if (!e || !sub || (e->type != BJD_T_OBJ && e->type != BJD_T_ARR)) return BJD_EINVAL;
+  uint32_t cnt; const uint8_t* first;
+  if (e->compact){ if (!(first = get_varint(e->val, e->val + e->val_len, &cnt))) return BJD_EINVAL; }
+  else if (e->val_len < 4) return BJD_EINVAL;
+  else { cnt = r32(e->val); first = e->val + 4; }
+  memset(sub, 0, sizeof(*sub));
+  sub->base=e->val; sub->len=e->val_len; sub->count=cnt; sub->entries=first;
+  sub->dict=e->dict; sub->compact=e->compact; sub->root=e->root;
+  sub->arr=(e->type == BJD_T_ARR);
+  return BJD_OK;
+}
+
+/**
+ * @brief Match a path segment against a stored name.
+ *
+ * A segment matches the full name or the name without its type prefix
+ * ("ssid" matches STR_32_ssid, "vbat" matches FIX16_2_vbat).
+ *
+ * @return 2 on a full-name match, 1 on a prefix-stripped match, 0 otherwise.
+ */
+static int seg_match(const char* name, size_t nlen, const char* seg, size_t n){
+  if (nlen==n) return memcmp(name, seg, n)==0 ? 2 : 0;
+  if (nlen < n || memcmp(name + nlen - n, seg, n)) return 0;
+  const bjd_prefix_t* pr = bjd_classify_key(name, nlen);
+  if (!pr) return 0;
+  size_t plen = pr->plen;
+  if (!BJD_IS_PACKED(pr->type) && bjd_type_info(pr->type)->kind == BJD_K_FIX){
+    while (plen < nlen && name[plen] != '_') plen++;
+    plen++;
+  }
+  return plen == nlen - n;
+}
+
+/**
+ * @brief Resolve one name segment among the children of `d`.
+ *
+ * Full-name matches use the index when present; a prefix-stripped match
+ * needs a linear pass, where the first full-name match still wins.
+ * Key IDs are compared by their dictionary name.
+ */
+static int find_seg(const bjd_doc_t* d, const char* seg, size_t n, bjd_entry_t* out){
+  if (d->slots){
+    size_t kn = n; char id[BJD_KEY_ID_LEN];
+    const char* k = stored_name(d->dict, seg, &kn, id);
+    int i = find_indexed(d, k, kn, bjd_hash(k, kn), out);
+    if (i >= 0) return i;
+  }
+  bjd_iter_t it; bjd_entry_t e; int found = -1;
+  bjd_iter_init(&it, d);
+  while (bjd_iter_next(&it, &e) > 0){
+    uint8_t nl; const char* nm = bjd_entry_name(&e, &nl);
+    int m = seg_match(nm, nl, seg, n);
+    if (m==2){ *out=e; return (int)it.index-1; }
+    if (m==1 && found<0){ *out=e; found=(int)it.index-1; }
+  }
+  return found;
+}
+
+/**
+ * @brief The `k`-th child of `d`, skipping earlier siblings whole.
+ */
+static int find_nth(const bjd_doc_t* d, uint32_t k, bjd_entry_t* out){
+  bjd_iter_t it;
+  if (k >= d->count) return -1;
+  bjd_iter_init(&it, d);
+  for (uint32_t i=0;i<=k;i++) if (bjd_iter_next(&it, out) <= 0) return -1;
+  return (int)k;
+}
+
+/**
+ * @brief Find an entry by path: "net.wifi.ssid", "peers[3].addr".
+ *
+ * Names are separated by '.', array elements are selected with [n].
+ * Only the containers on the path are entered; every other subtree is
+ * skipped through its value length, so the cost follows the path depth
+ * and the sibling counts along it, not the document size.
+ *
+ * @param d Document (or container view from bjd_enter).
+ * @param path NUL-terminated path.
+ * @param out[out] Entry metadata on success.
+ * @return Index of the entry within its container, -1 if not found.
+ */
+int bjd_find_path(const bjd_doc_t* d, const char* path, bjd_entry_t* out){
+  bjd_doc_t cur = *d; bjd_entry_t e; int idx;
+  const char* p = path;
+  for (;;){
+    size_t n = strcspn(p, ".[");
+    if (!n || (idx = find_seg(&cur, p, n, &e)) < 0) return -1;
+    p += n;
+    while (*p=='['){
+      uint32_t k=0; const char* q = ++p;
+      for (; *p>='0' && *p<='9'; p++){ if (k > (UINT32_MAX-9)/10) return -1; k = k*10 + (uint32_t)(*p-'0'); }
+      if (p==q || *p++ != ']') return -1;
+      if (e.type != BJD_T_ARR || bjd_enter(&e, &cur) != BJD_OK) return -1;
+      cur.trusted = d->trusted;
+      if ((idx = find_nth(&cur, k, &e)) < 0) return -1;
     }
-    const uint8_t* nxt; if (!next_ent(cur,end,&nxt)) break; cur = nxt;
+    if (!*p){ *out = e; return idx; }
+    if (*p++ != '.' || e.type != BJD_T_OBJ || bjd_enter(&e, &cur) != BJD_OK) return -1;
+    cur.trusted = d->trusted;
+  }
+}
+
+/**
+ * @brief Read a little-endian integer of `w` bytes (w <= 8).
+ *
+ * @param p Value bytes.
+ * @param w Width in bytes.
+ * @param sign Sign-extend from the top byte.
+ * @return Value widened to 64 bits.
+ */
+static uint64_t rle(const uint8_t* p, uint8_t w, int sign){
+  uint64_t v=0;
+  for (uint8_t i=0;i<w;i++) v |= (uint64_t)p[i] << (8*i);
+  if (sign && w<8 && (p[w-1] & 0x80)) v |= ~(uint64_t)0 << (8*w);
+  return v;
+}
+
+/**
+ * @brief Convert an entry into the destination representation of `want`.
+ *
+ * Shared by the bjd_get_* getters and bjd_bind so both accept exactly the
+ * same stored types. Validation is driven by the type registry: values
+ * convert when the stored kind equals the wanted kind and the stored
+ * width is not larger than the wanted width (I16 -> I32 ok, U16 -> I32 not,
+ * F32 -> F64 ok, FIX16 -> FIX32 ok with the same raw value).
+ *
+ * @param e Entry to convert.
+ * @param want Requested type.
+ * @param dst[out] Destination, the C type of `want`.
+ * @return 0 on success, -1 on type/size mismatch.
+ */
+static int ent_to(const bjd_entry_t* e, bjd_type_t want, void* dst){
+  const bjd_type_info_t* wi = bjd_type_info((uint8_t)want);
+  const bjd_type_info_t* si = bjd_type_info((uint8_t)e->type);
+  if (!wi || !si || wi->kind != si->kind) return -1;
+  if (wi->kind == BJD_K_OBJ || wi->kind == BJD_K_ARR) return bjd_enter(e, (bjd_doc_t*)dst)==BJD_OK ? 0 : -1;
+  if (wi->kind == BJD_K_STR){
+    ((bjd_str_t*)dst)->s=(const char*)e->val; ((bjd_str_t*)dst)->n=e->val_len; return 0;
+  }
+  if (si->width > wi->width || e->val_len != si->width) return -1;
+  uint64_t v = rle(e->val, si->width, si->kind == BJD_K_INT || si->kind == BJD_K_FIX);
+  if (si->kind == BJD_K_FLOAT && si->width < wi->width){ // F32 -> F64: convert, not bit-copy
+    float f; uint32_t b=(uint32_t)v; memcpy(&f, &b, 4);
+    double x = f; memcpy(dst, &x, 8); return 0;
+  }
+  switch (wi->width){
+    case 1: *(uint8_t*)dst  = (uint8_t)v;  return 0;
+    case 2: *(uint16_t*)dst = (uint16_t)v; return 0;
+    case 4: *(uint32_t*)dst = (uint32_t)v; return 0;
+    case 8: *(uint64_t*)dst = v;           return 0;
   }
   return -1;
 }
 
+/**
+ * @brief Convert an entry obtained from an iterator, visitor or lookup.
+ *
+ * Same rules as the bjd_get_* getters (see ent_to), without a key lookup.
+ *
+ * @param e Entry.
+ * @param want Requested type (BJD_T_I64 accepts every signed integer, ...).
+ * @param dst[out] Destination, the C type of `want`.
+ * @return 0 on success, -1 on type/size mismatch.
+ */
+int bjd_entry_value(const bjd_entry_t* e, bjd_type_t want, void* dst){
+  return ent_to(e, want, dst);
+}
+
+/**
+ * @brief Depth-first walk over every entry, containers included.
+ *
+ * `fn` sees each entry once (leave=0) in document order; a container is
+ * followed by its children and then reported again with leave=1. The
+ * walk keeps one iterator per level on the stack (BJD_DEPTH_MAX levels),
+ * allocates nothing, and reads each entry header once.
+ *
+ * @param d Document or container view.
+ * @param fn Callback; a non-zero return stops the walk.
+ * @param user Passed to `fn`.
+ * @return 0 after a full walk, the callback's non-zero value if it
+ *         stopped, -1 on a corrupt entry or nesting past BJD_DEPTH_MAX.
+ */
+int bjd_visit(const bjd_doc_t* d, bjd_visit_fn fn, void* user){
+  bjd_iter_t it[BJD_DEPTH_MAX+1]; bjd_entry_t open[BJD_DEPTH_MAX];
+  uint32_t depth=0; int rc;
+  bjd_iter_init(&it[0], d);
+  for (;;){
+    bjd_entry_t e;
+    int r = bjd_iter_next(&it[depth], &e);
+    if (r < 0) return -1;
+    if (r == 0){
+      if (!depth) return 0;
+      depth--;
+      if ((rc = fn(&open[depth], depth, 1, user))) return rc;
+      continue;
+    }
+    if ((rc = fn(&e, depth, 0, user))) return rc;
+    if (e.type == BJD_T_OBJ || e.type == BJD_T_ARR){
+      bjd_doc_t sub;
+      if (depth >= BJD_DEPTH_MAX || bjd_enter(&e, &sub) != BJD_OK) return -1;
+      sub.trusted = d->trusted;
+      open[depth++] = e;
+      bjd_iter_init(&it[depth], &sub);
+    }
+  }
+}
+
+/**
+ * @brief bjd_visit callback for bjd_validate: per-entry type and size rules.
+ *
+ * Bounds, container headers and nesting are already enforced by the walk.
+ *
+ * @param user The document's header flags (const uint16_t*).
+ * @return 0 if the entry is well-formed, 1 to stop the walk otherwise.
+ */
+static int check_ent(const bjd_entry_t* e, uint32_t depth, int leave, void* user){
+  (void)depth;
+  if (leave) return 0;
+  uint16_t flags = *(const uint16_t*)user;
+  // reserved words: strings only, and only in BJD_F_RESERVE documents
+  if (!e->compact && ((const uint8_t*)e->name - 8)[3] && (e->type != BJD_T_STR || !(flags & BJD_F_RESERVE))) return 1;
+  uint8_t nl; const char* nm = bjd_entry_name(e, &nl);
+  if ((flags & BJD_F_DICT) && nm == e->name && nl == BJD_KEY_ID_LEN && !nm[0]) return 1; // unknown key ID
+  if (BJD_IS_PACKED(e->type)){
+    uint8_t w = bjd_packed_width(BJD_ELEM_TYPE(e->type));
+    return !w || (e->val_len % w) != 0;
+  }
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)e->type);
+  if (!ti) return 1;
+  switch (ti->kind){
+    case BJD_K_STR: case BJD_K_OBJ: case BJD_K_ARR: return 0;
+    case BJD_K_BOOL: return e->val_len != 1 || e->val[0] > 1;
+    case BJD_K_FIX: {
+      const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+      if (!pr || bjd_key_scale(nm, nl, pr) < 0) return 1;
+    } /* fall through */
+    default: return e->val_len != ti->width;
+  }
+}
+
+/**
+ * @brief Validate a whole document once and mark it trusted.
+ *
+ * Checks the BJD_F_CRC trailer (when present), then walks every entry,
+ * nested ones included: bounds, container headers, known types, value
+ * sizes. With BJD_F_INDEX the offset table must list the real entry
+ * offsets and every slot must reference an entry with the slot's hash.
+ * On success `doc->trusted` is set and later lookups, iteration and
+ * bjd_visit decode entries without re-checking bounds, e.g. validate a
+ * flash-resident config at boot and read it unchecked afterwards.
+ * BJD_F_DICT documents are validated against the attached dictionary:
+ * every key ID must name one of its keys.
+ *
+ * @param d Document from bjd_open; the buffer must not change afterwards.
+ * @return BJD_OK, BJD_ECRC on a checksum mismatch, BJD_EDICT without
+ *         bjd_use_dict on a BJD_F_DICT document, BJD_ECORRUPT otherwise.
+ */
+bjd_err_t bjd_validate(bjd_doc_t* d){
+  if (!d) return BJD_EINVAL;
+  d->trusted = 0;
+  if (d->flags & BJD_F_CRC){
+    size_t n = d->len - 4;
+    if (bjd_crc32(0, d->base, n) != r32(d->base + n)) return BJD_ECRC;
+  }
+  if ((d->flags & BJD_F_DICT) && !d->dict) return BJD_EDICT;
+  bjd_doc_t v = *d;   // entries must end before the index section / CRC trailer
+  v.len = d->slots ? (size_t)(d->slots - 4 - d->base) : payload_len(d);
+  v.slots = NULL;
+  if (bjd_visit(&v, check_ent, &d->flags) != 0) return BJD_ECORRUPT;
+  if (d->slots){
+    bjd_iter_t it; bjd_entry_t e;
+    bjd_iter_init(&it, d);
+    for (uint32_t i=0;i<d->count;i++){
+      const uint8_t* at = it.cur;
+      if (bjd_iter_next(&it, &e) <= 0 || r32(d->offs + (size_t)i*4) != (uint32_t)(at - d->base)) return BJD_ECORRUPT;
+    }
+    for (uint32_t k=0;k<d->nslots;k++){
+      uint32_t ref = r32(d->slots + (size_t)k*8 + 4);
+      if (!ref) continue;
+      if (ref > d->count) return BJD_ECORRUPT;
+      decode_ent(d->base + r32(d->offs + (size_t)(ref-1)*4), d->dict, &e);
+      if (bjd_hash(e.name, e.name_len) != r32(d->slots + (size_t)k*8)) return BJD_ECORRUPT;
+    }
+  }
+  d->trusted = 1;
+  return BJD_OK;
+}
+
 /**
  * @brief Retrieve a signed 32-bit integer value by key.
  *
@@ -95,10 +703,7 @@ int bjd_find(const bjd_doc_t* d, const char* key, bjd_entry_t* out){
  */
 int bjd_get_i32(const bjd_doc_t* d, const char* key, int32_t* out){
   bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
-  if (e.type!=BJD_T_I16 && e.type!=BJD_T_I32) return -1;
-  if (e.val_len==2){ int16_t v=(int16_t)(e.val[0]|(e.val[1]<<8)); *out=v; return 0; }
-  if (e.val_len==4){ int32_t v=(int32_t)r32(e.val); *out=v; return 0; }
-  return -1;
+  return ent_to(&e, BJD_T_I32, out);
 }
 /**
  * @brief Retrieve an unsigned 32-bit integer value by key.
@@ -112,10 +717,96 @@ int bjd_get_i32(const bjd_doc_t* d, const char* key, int32_t* out){
  */
 int bjd_get_u32(const bjd_doc_t* d, const char* key, uint32_t* out){
   bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
-  if (e.type!=BJD_T_U16 && e.type!=BJD_T_U32) return -1;
-  if (e.val_len==2){ uint16_t v=(uint16_t)(e.val[0]|(e.val[1]<<8)); *out=v; return 0; }
-  if (e.val_len==4){ *out=r32(e.val); return 0; }
-  return -1;
+  return ent_to(&e, BJD_T_U32, out);
+}
+/**
+ * @brief Retrieve a signed 64-bit integer value by key.
+ *
+ * Accepts any stored signed integer type.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param out[out] Destination to store value on success.
+ * @return 0 on success, -1 on not found or type/size mismatch.
+ */
+int bjd_get_i64(const bjd_doc_t* d, const char* key, int64_t* out){
+  bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
+  return ent_to(&e, BJD_T_I64, out);
+}
+/**
+ * @brief Retrieve an unsigned 64-bit integer value by key.
+ *
+ * Accepts any stored unsigned integer type.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param out[out] Destination to store value on success.
+ * @return 0 on success, -1 on not found or type/size mismatch.
+ */
+int bjd_get_u64(const bjd_doc_t* d, const char* key, uint64_t* out){
+  bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
+  return ent_to(&e, BJD_T_U64, out);
+}
+/**
+ * @brief Retrieve a single-precision float value by key.
+ *
+ * Only FLOAT32 entries fit; a FLOAT64 entry is a size mismatch.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param out[out] Destination to store value on success.
+ * @return 0 on success, -1 on not found or type/size mismatch.
+ */
+int bjd_get_f32(const bjd_doc_t* d, const char* key, float* out){
+  bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
+  return ent_to(&e, BJD_T_F32, out);
+}
+/**
+ * @brief Retrieve a double-precision float value by key.
+ *
+ * FLOAT32 entries are widened exactly.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param out[out] Destination to store value on success.
+ * @return 0 on success, -1 on not found or type/size mismatch.
+ */
+int bjd_get_f64(const bjd_doc_t* d, const char* key, double* out){
+  bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
+  return ent_to(&e, BJD_T_F64, out);
+}
+/**
+ * @brief Retrieve a boolean value by key.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param out[out] 0 or 1 on success.
+ * @return 0 on success, -1 on not found or type mismatch.
+ */
+int bjd_get_bool(const bjd_doc_t* d, const char* key, bool* out){
+  bjd_entry_t e; uint8_t v; if (bjd_find(d,key,&e)<0 || ent_to(&e,BJD_T_BOOL,&v)<0) return -1;
+  *out = v != 0; return 0;
+}
+/**
+ * @brief Retrieve a fixed-point value by key.
+ *
+ * The value is `raw / 10^scale`; the scale comes from the key name
+ * (FIX32_2_TEMP -> 2). Callers that know the scale can bind BJD_T_FIX32
+ * directly instead.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup.
+ * @param raw[out] Scaled integer on success.
+ * @param scale[out] Decimal places on success.
+ * @return 0 on success, -1 on not found or type mismatch.
+ */
+int bjd_get_fix(const bjd_doc_t* d, const char* key, int32_t* raw, uint8_t* scale){
+  bjd_entry_t e; if (bjd_find(d,key,&e)<0 || ent_to(&e,BJD_T_FIX32,raw)<0) return -1;
+  uint8_t nl; const char* nm = bjd_entry_name(&e, &nl);
+  const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+  int sc = pr ? bjd_key_scale(nm, nl, pr) : -1;
+  if (sc < 0) return -1;
+  *scale = (uint8_t)sc; return 0;
 }
 /**
  * @brief Retrieve a string value by key.
@@ -130,7 +821,358 @@ int bjd_get_u32(const bjd_doc_t* d, const char* key, uint32_t* out){
  * @return 0 on success, -1 if not found or type mismatch.
  */
 int bjd_get_str(const bjd_doc_t* d, const char* key, const char** s, uint32_t* n){
-  bjd_entry_t e; if (bjd_find(d,key,&e)<0) return -1;
-  if (e.type!=BJD_T_STR) return -1;
-  *s=(const char*)e.val; *n=e.val_len; return 0;
+  bjd_entry_t e; bjd_str_t v; if (bjd_find(d,key,&e)<0 || ent_to(&e,BJD_T_STR,&v)<0) return -1;
+  *s=v.s; *n=v.n; return 0;
+}
+
+/**
+ * @brief Zero-copy access to a packed typed array.
+ *
+ * Returns a pointer straight into the document buffer, aligned for the
+ * element type when the buffer is loaded at an 8-byte aligned address
+ * (malloc, static aligned arrays, mmap). Elements are little-endian, so
+ * they can be used in place on the little-endian targets we run on.
+ * BJD_F_COMPACT documents have no padding, so this mostly fails there.
+ *
+ * @param d Document handle.
+ * @param key Key name to lookup (ARR_INT16_..., ARR_FLOAT32_...).
+ * @param elem Element type (BJD_T_I16, BJD_T_F32, ...); must match exactly.
+ * @param p[out] First element on success.
+ * @param n[out] Number of elements.
+ * @return 0 on success, -1 on not found, type mismatch, an element type
+ *         without a packed form or a misaligned buffer.
+ */
+int bjd_get_array(const bjd_doc_t* d, const char* key, bjd_type_t elem, const void** p, uint32_t* n){
+  bjd_entry_t e;
+  uint8_t w = bjd_packed_width((uint8_t)elem);   // unvalidated documents may carry ARR|STR etc.
+  if (!w || bjd_find(d,key,&e)<0 || !BJD_IS_PACKED(e.type) || BJD_ELEM_TYPE(e.type) != (uint8_t)elem) return -1;
+  if (e.val_len % w || ((uintptr_t)e.val & (uintptr_t)(w-1))) return -1;
+  *p = e.val; *n = e.val_len / w;
+  return 0;
+}
+
+/**
+ * @brief True for a document from bjd_open, false for a bjd_enter view.
+ *
+ * Setters patch the header flags and the CRC trailer, which only a root
+ * document reaches; nested entries are addressed by path instead.
+ */
+static int is_root(const bjd_doc_t* d){ return d->entries == d->base + hdr_size(d->flags); }
+
+/**
+ * @brief CRC-32 of a span about to be patched (0 without BJD_F_CRC).
+ */
+static uint32_t span_crc(const bjd_doc_t* d, const uint8_t* p, size_t n){
+  return (d->flags & BJD_F_CRC) ? bjd_crc32(0, p, n) : 0;
+}
+
+/**
+ * @brief Fold an in-place change of one span into the BJD_F_CRC trailer.
+ *
+ * Only the patched span is re-read; the rest of the document is covered
+ * by bjd_crc32_shift, so the cost does not grow with the image size.
+ *
+ * @param d Root document over a writable buffer.
+ * @param p Patched span.
+ * @param n Span length.
+ * @param before span_crc of the span before the patch.
+ */
+static void patch_crc(const bjd_doc_t* d, const uint8_t* p, size_t n, uint32_t before){
+  if (!(d->flags & BJD_F_CRC)) return;
+  uint8_t* t = (uint8_t*)d->base + d->len - 4;
+  uint32_t c = r32(t) ^ bjd_crc32_shift(before ^ bjd_crc32(0, p, n), (size_t)(t - (p + n)));
+  t[0]=(uint8_t)c; t[1]=(uint8_t)(c>>8); t[2]=(uint8_t)(c>>16); t[3]=(uint8_t)(c>>24);
+}
+
+/**
+ * @brief Overwrite an integer entry with `v` at its stored width.
+ *
+ * Any BJD_K_INT/BJD_K_UINT entry is accepted (an INT16_ key keeps its
+ * 2 bytes); `v` must fit the stored type's range.
+ *
+ * @param d Root document over a writable buffer.
+ * @param path bjd_find_path expression.
+ * @param v New value.
+ * @return 0 on success, -1 on a view, not found, type mismatch or out of range.
+ */
+static int set_int(bjd_doc_t* d, const char* path, int64_t v){
+  bjd_entry_t e;
+  if (!is_root(d) || bjd_find_path(d, path, &e) < 0 || BJD_IS_PACKED(e.type)) return -1;
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)e.type);
+  if (!ti || (ti->kind != BJD_K_INT && ti->kind != BJD_K_UINT) || e.val_len != ti->width) return -1;
+  if (v < ti->min || (v > 0 && (uint64_t)v > ti->max)) return -1;
+  uint8_t* w = (uint8_t*)e.val;
+  uint32_t c0 = span_crc(d, w, ti->width);
+  for (uint8_t i=0;i<ti->width;i++) w[i] = (uint8_t)((uint64_t)v >> (8*i));
+  patch_crc(d, w, ti->width, c0);
+  return 0;
+}
+
+/**
+ * @brief Rewrite a signed integer value in place.
+ *
+ * @param d Root document over a writable buffer (not flash-mapped).
+ * @param path Key or path ("net.port", "list[2]").
+ * @param v New value; must fit the stored integer type.
+ * @return 0 on success, -1 on not found, type mismatch or out of range.
+ */
+int bjd_set_i32(bjd_doc_t* d, const char* path, int32_t v){ return set_int(d, path, v); }
+/** @brief Unsigned variant of bjd_set_i32. */
+int bjd_set_u32(bjd_doc_t* d, const char* path, uint32_t v){ return set_int(d, path, (int64_t)v); }
+
+/**
+ * @brief Rewrite a string value in place.
+ *
+ * The new bytes may use the old value, its alignment padding and the
+ * entry's reserved words (BJSON_ENC_F_RESERVE); the next entry never
+ * moves. Unused bytes are zeroed and handed back to the reserve, so a
+ * string can shrink and grow again later. The STR_N limit of the key
+ * still applies, in code points when the document has BJD_F_CPLIMIT. `s` is stored as raw bytes, like decoded JSON strings.
+ * BJD_F_COMPACT strings have no room to grow and are refused, and so are
+ * BJD_F_SREF documents, where one string may back several entries.
+ *
+ * @param d Root document over a writable buffer (not flash-mapped).
+ * @param path Key or path of a BJD_T_STR entry.
+ * @param s New bytes (need not be NUL-terminated).
+ * @param n Number of bytes.
+ * @return 0 on success, -1 on not found, type mismatch, limit or no room.
+ */
+int bjd_set_str(bjd_doc_t* d, const char* path, const char* s, size_t n){
+  bjd_entry_t e;
+  if (!is_root(d) || d->compact || (d->flags & BJD_F_SREF) || bjd_find_path(d, path, &e) < 0 || e.type != BJD_T_STR) return -1;
+  uint8_t nl; const char* nm = bjd_entry_name(&e, &nl);
+  const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+  if (pr && pr->limit && n > pr->limit){
+    if (!(d->flags & BJD_F_CPLIMIT) || n > 4u*pr->limit) return -1;
+    size_t cp = 0;   // code points: bytes that are not continuation bytes
+    for (size_t i=0;i<n;i++) cp += ((uint8_t)s[i] & 0xC0) != 0x80;
+    if (cp > pr->limit) return -1;
+  }
+  const uint8_t* nxt = ent_end(&e);
+  if (n > (size_t)(nxt - e.val)) return -1;
+  size_t rsv = (size_t)(nxt - align4p(e.val + n)) / 4;
+  if (rsv > 255) return -1;
+  uint8_t* h = (uint8_t*)e.name - 8;
+  uint8_t* v = (uint8_t*)e.val;
+  uint32_t vlen = (uint32_t)(h[2] + n);
+  uint32_t c0 = span_crc(d, h, (size_t)(nxt - h));
+  memmove(v, s, n);
+  memset(v + n, 0, (size_t)(nxt - v) - n);
+  h[3] = (uint8_t)rsv;
+  h[4]=(uint8_t)vlen; h[5]=(uint8_t)(vlen>>8); h[6]=(uint8_t)(vlen>>16); h[7]=(uint8_t)(vlen>>24);
+  patch_crc(d, h, (size_t)(nxt - h), c0);
+  if (rsv && !(d->flags & BJD_F_RESERVE)){ // shrinking left room: announce it
+    uint8_t* f = (uint8_t*)d->base + 6;
+    c0 = span_crc(d, f, 2);
+    d->flags |= BJD_F_RESERVE;
+    f[0]=(uint8_t)d->flags; f[1]=(uint8_t)(d->flags>>8);
+    patch_crc(d, f, 2, c0);
+  }
+  return 0;
+}
+
+/**
+ * @brief Build a key handle with precomputed length and hash.
+ *
+ * The handle keeps a pointer to `name`, which must outlive it (string
+ * literals in practice). Build handles once, e.g. at init, and reuse them
+ * with bjd_find_key / bjd_bind.
+ *
+ * @param k[out] Handle to fill.
+ * @param name NUL-terminated key name.
+ * @return 0 on success, -1 if `name` is longer than an entry name can be.
+ */
+int bjd_key_init(bjd_key_t* k, const char* name){
+  size_t n = strlen(name);
+  if (n > 255) return -1;
+  k->name=name; k->len=(uint8_t)n; k->hash=bjd_hash(name,n);
+  k->has_id=0;
+  return 0;
+}
+
+/**
+ * @brief Build a key handle for documents encoded with `dict`.
+ *
+ * A key listed in the dictionary is resolved to its key ID once, so
+ * lookups in documents with that dictionary attached compare three
+ * bytes; documents without a dictionary are searched by name.
+ *
+ * @param k[out] Handle to fill.
+ * @param dict Dictionary the documents were encoded with.
+ * @param name NUL-terminated key name.
+ * @return 0 on success, -1 if `name` is longer than an entry name can be.
+ */
+int bjd_key_init_dict(bjd_key_t* k, const bjd_dict_t* dict, const char* name){
+  if (bjd_key_init(k, name) < 0) return -1;
+  size_t n = k->len;
+  if (stored_name(dict, name, &n, k->id) == k->id){ k->has_id=1; k->id_hash=bjd_hash(k->id, BJD_KEY_ID_LEN); }
+  return 0;
+}
+
+/**
+ * @brief Stored name a key handle matches in `d`: its key ID on a
+ *        dictionary document, else the key itself.
+ */
+static const char* key_for(const bjd_doc_t* d, const bjd_key_t* k, uint8_t* n, uint32_t* h){
+  if (d->dict && k->has_id){ *n=BJD_KEY_ID_LEN; *h=k->id_hash; return k->id; }
+  *n=k->len; *h=k->hash;
+  return k->name;
+}
+
+/**
+ * @brief Find an entry by a pre-resolved key handle.
+ *
+ * Same as bjd_find without the per-call strlen and hash. A plain
+ * handle on a dictionary document falls back to an ID search per call;
+ * use bjd_key_init_dict there.
+ *
+ * @param d Document to search.
+ * @param k Key handle from bjd_key_init.
+ * @param out[out] Entry metadata on success.
+ * @return Index of entry on success, -1 if not found or on error.
+ */
+int bjd_find_key(const bjd_doc_t* d, const bjd_key_t* k, bjd_entry_t* out){
+  if (d->dict && !k->has_id && bjd_dict_id(d->dict, k->name, k->len) >= 0) return bjd_find(d, k->name, out);
+  uint8_t n; uint32_t h; const char* name = key_for(d, k, &n, &h);
+  if (d->slots) return find_indexed(d, name, n, h, out);
+  return find_linear(d, name, n, out);
+}
+
+/**
+ * @brief Fill a whole table of typed destinations from the document.
+ *
+ * Indexed documents resolve each row with one hash probe. Otherwise the
+ * entries are walked once: each name is hashed and matched against the
+ * still-unresolved rows by hash and length before `memcmp`, and the walk
+ * stops as soon as every row is resolved. The first occurrence of a
+ * duplicated key wins, as with bjd_find. On a dictionary document,
+ * handles from bjd_key_init_dict match by key ID; plain handles of
+ * dictionary keys are resolved one by one afterwards.
+ *
+ * @param d Document handle.
+ * @param rows Table of {key, type, dst}; `status` is written per row.
+ * @param n Number of rows.
+ * @return 0 if every row was bound, otherwise the number of rows whose
+ *         status is BJD_BIND_MISSING or BJD_BIND_ETYPE.
+ */
+int bjd_bind(const bjd_doc_t* d, bjd_bind_t* rows, size_t n){
+  size_t pending = n;
+  for (size_t r=0;r<n;r++) rows[r].status = BJD_BIND_MISSING;
+
+  if (d->slots){
+    for (size_t r=0;r<n;r++){
+      bjd_entry_t e; uint8_t kn; uint32_t kh;
+      const char* name = key_for(d, rows[r].key, &kn, &kh);
+      if (find_indexed(d, name, kn, kh, &e) < 0) continue;
+      rows[r].status = ent_to(&e, rows[r].type, rows[r].dst)==0 ? BJD_BIND_OK : BJD_BIND_ETYPE;
+      pending--;
+    }
+  } else {
+    bjd_iter_t it; bjd_entry_t e;
+    bjd_iter_init(&it, d);
+    while (pending && bjd_iter_next(&it, &e) > 0){
+      uint32_t h = bjd_hash(e.name, e.name_len);
+      for (size_t r=0;r<n;r++){
+        uint8_t kn; uint32_t kh; const char* name = key_for(d, rows[r].key, &kn, &kh);
+        if (rows[r].status!=BJD_BIND_MISSING || kh!=h || kn!=e.name_len) continue;
+        if (memcmp(name, e.name, kn)!=0) continue;
+        rows[r].status = ent_to(&e, rows[r].type, rows[r].dst)==0 ? BJD_BIND_OK : BJD_BIND_ETYPE;
+        pending--;
+      }
+    }
+  }
+  if (d->dict && pending){ // plain handles of dictionary keys
+    for (size_t r=0;r<n;r++){
+      bjd_entry_t e; const bjd_key_t* k=rows[r].key;
+      if (rows[r].status!=BJD_BIND_MISSING || k->has_id || bjd_find_key(d, k, &e) < 0) continue;
+      rows[r].status = ent_to(&e, rows[r].type, rows[r].dst)==0 ? BJD_BIND_OK : BJD_BIND_ETYPE;
+    }
+  }
+
+  int failed = 0;
+  for (size_t r=0;r<n;r++) if (rows[r].status!=BJD_BIND_OK) failed++;
+  return failed;
+}
+
+/**
+ * @brief Check and fingerprint a key dictionary.
+ *
+ * `hash` is FNV-1a over every key and its NUL terminator, in order. The
+ * encoder stores it after the header and bjd_use_dict compares it, so a
+ * document is never read with a different key list.
+ *
+ * @param dict[out] Dictionary to fill; keeps a pointer to `keys`.
+ * @param keys Keys sorted by strcmp, without duplicates, each longer
+ *             than a key ID (4..255 bytes) so the ID always saves space.
+ * @param n Number of keys (IDs 0..n-1).
+ * @return 0 on success, -1 if unsorted, duplicated or a key length is out of range.
+ */
+int bjd_dict_init(bjd_dict_t* dict, const char* const* keys, uint16_t n){
+  uint32_t h = 2166136261u;
+  for (uint16_t i=0;i<n;i++){
+    size_t kn = strlen(keys[i]);
+    if (kn <= BJD_KEY_ID_LEN || kn > 255 || (i && strcmp(keys[i-1], keys[i]) >= 0)) return -1;
+    for (size_t j=0;j<=kn;j++){ h ^= (uint8_t)keys[i][j]; h *= 16777619u; }
+  }
+  dict->keys=keys; dict->count=n; dict->hash=h;
+  return 0;
+}
+
+/**
+ * @brief Key ID of `key` (binary search).
+ *
+ * @param dict Dictionary from bjd_dict_init.
+ * @param key Key bytes (need not be NUL-terminated).
+ * @param n Number of bytes in `key`.
+ * @return ID, or -1 if the key is not listed.
+ */
+int bjd_dict_id(const bjd_dict_t* dict, const char* key, size_t n){
+  uint32_t lo=0, hi=dict->count;
+  while (lo < hi){
+    uint32_t mid = (lo+hi)/2;
+    const char* k = dict->keys[mid];
+    size_t kn = strlen(k);
+    int c = memcmp(k, key, kn < n ? kn : n);
+    if (!c) c = (kn > n) - (kn < n);
+    if (!c) return (int)mid;
+    if (c < 0) lo = mid+1; else hi = mid;
+  }
+  return -1;
+}
+
+/**
+ * @brief Attach the key dictionary of a BJD_F_DICT document.
+ *
+ * Call after bjd_open and before bjd_validate; views from bjd_enter
+ * inherit it.
+ *
+ * @param d Root document from bjd_open.
+ * @param dict Dictionary from bjd_dict_init; must outlive `d`.
+ * @return BJD_OK, BJD_EDICT if the document was encoded with another
+ *         dictionary, BJD_EINVAL if `d` has no BJD_F_DICT header.
+ */
+bjd_err_t bjd_use_dict(bjd_doc_t* d, const bjd_dict_t* dict){
+  if (!d || !dict || !(d->flags & BJD_F_DICT) || !is_root(d)) return BJD_EINVAL;
+  if (r32(d->base + BJD_HDR_SIZE) != dict->hash) return BJD_EDICT;
+  d->dict = dict;
+  return BJD_OK;
+}
+
+/**
+ * @brief Key text of an entry.
+ *
+ * Key IDs resolve through the document's dictionary; any other name is
+ * returned as stored.
+ *
+ * @param e Entry from a lookup or iterator.
+ * @param len[out] Name length.
+ * @return Name bytes (not NUL-terminated).
+ */
+const char* bjd_entry_name(const bjd_entry_t* e, uint8_t* len){
+  if (e->dict && e->name_len == BJD_KEY_ID_LEN && !e->name[0]){
+    uint32_t id = (uint8_t)e->name[1] | ((uint32_t)(uint8_t)e->name[2] << 8);
+    if (id < e->dict->count){ const char* k = e->dict->keys[id]; *len = (uint8_t)strlen(k); return k; }
+  }
+  *len = e->name_len;
+  return e->name;
 }
@@ -0,0 +1,247 @@
+#include "bjson.h"
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * BJSON -> CBOR (RFC 8949) / MessagePack (bjd_to_cbor, bjd_to_msgpack).
+ *
+ * One pass over bjd_visit, no intermediate tree. Objects become maps and
+ * arrays arrays, both with definite lengths (the entry counts are in the
+ * document). Keys are written as stored, type prefixes included, so
+ * bjson_encode_from_cbor / _msgpack rebuild the same document:
+ *
+ *   STR            text string
+ *   INT / UINT     shortest integer head
+ *   FLOAT32 / 64   float32 / float64 (never narrowed, so widths survive)
+ *   BOOL           true / false
+ *   FIX, scale s   CBOR: decimal fraction, tag 4 [-s, raw] (exact; a
+ *                  plain integer for s = 0); MessagePack: float64
+ *                  raw / 10^s, the nearest double
+ *   ARR_*          array of the element numbers
+ */
+
+enum { BIN_CBOR, BIN_MSGPACK };
+
+/** Output state; `pos` keeps counting past a short buffer (cap set to 0) so the exact length is known. */
+typedef struct {
+  uint8_t* out; size_t cap, pos;
+  uint8_t fmt;
+  uint8_t arr[BJD_DEPTH_MAX+1];       // this depth is an array (no keys)
+} bw_t;
+
+static inline void bw_put(bw_t* w, const void* p, size_t n){
+  if (w->pos <= w->cap && n <= w->cap - w->pos) memcpy(w->out + w->pos, p, n);
+  else w->cap = 0;   // did not fit: only count from here on
+  w->pos += n;
+}
+static inline void bw_byte(bw_t* w, uint8_t b){
+  if (w->pos < w->cap) w->out[w->pos] = b;
+  else w->cap = 0;
+  w->pos++;
+}
+/** `b0` followed by the low `n` bytes of `v`, big-endian. */
+static inline void bw_be(bw_t* w, uint8_t b0, uint64_t v, int n){
+  uint8_t b[9], *d = (w->pos <= w->cap && w->cap - w->pos >= 9) ? w->out + w->pos : b;   // room: write in place
+  d[0] = b0;
+  for (int k=0; k<n; k++) d[1+k] = (uint8_t)(v >> (8*(n-1-k)));
+  if (d == b) bw_put(w, b, (size_t)n + 1);
+  else w->pos += (size_t)n + 1;
+}
+
+/**
+ * @brief CBOR head: major type `mt` with argument `v` in its shortest form.
+ */
+static inline void cbor_head(bw_t* w, int mt, uint64_t v){
+  uint8_t m = (uint8_t)(mt << 5);
+  if (v < 24) bw_byte(w, (uint8_t)(m | v));
+  else if (v <= 0xFF) bw_be(w, m | 24, v, 1);
+  else if (v <= 0xFFFF) bw_be(w, m | 25, v, 2);
+  else if (v <= 0xFFFFFFFFu) bw_be(w, m | 26, v, 4);
+  else bw_be(w, m | 27, v, 8);
+}
+
+/**
+ * @brief MessagePack head for the fix / 8 / 16 / 32-bit length families.
+ *
+ * @param fix Fix-form base byte (0xa0 str, 0x90 array, 0x80 map).
+ * @param fixmax Largest length of the fix form.
+ * @param f8 8-bit length form byte, 0 if the family has none.
+ * @param f16 16-bit length form byte (the 32-bit one follows it).
+ */
+static void mp_len(bw_t* w, uint8_t fix, uint32_t fixmax, uint8_t f8, uint8_t f16, uint32_t n){
+  if (n <= fixmax) bw_byte(w, (uint8_t)(fix | n));
+  else if (f8 && n <= 0xFF) bw_be(w, f8, n, 1);
+  else if (n <= 0xFFFF) bw_be(w, f16, n, 2);
+  else bw_be(w, (uint8_t)(f16 + 1), n, 4);
+}
+
+static void put_u64(bw_t* w, uint64_t v){
+  if (w->fmt == BIN_CBOR){ cbor_head(w, 0, v); return; }
+  if (v < 0x80) bw_byte(w, (uint8_t)v);
+  else if (v <= 0xFF) bw_be(w, 0xcc, v, 1);
+  else if (v <= 0xFFFF) bw_be(w, 0xcd, v, 2);
+  else if (v <= 0xFFFFFFFFu) bw_be(w, 0xce, v, 4);
+  else bw_be(w, 0xcf, v, 8);
+}
+static void put_i64(bw_t* w, int64_t v){
+  if (v >= 0){ put_u64(w, (uint64_t)v); return; }
+  if (w->fmt == BIN_CBOR){ cbor_head(w, 1, ~(uint64_t)v); return; }   // -1 - n
+  if (v >= -32) bw_byte(w, (uint8_t)v);
+  else if (v >= INT8_MIN) bw_be(w, 0xd0, (uint64_t)v, 1);
+  else if (v >= INT16_MIN) bw_be(w, 0xd1, (uint64_t)v, 2);
+  else if (v >= INT32_MIN) bw_be(w, 0xd2, (uint64_t)v, 4);
+  else bw_be(w, 0xd3, (uint64_t)v, 8);
+}
+static void put_f32(bw_t* w, float x){
+  uint32_t b; memcpy(&b, &x, 4);
+  bw_be(w, w->fmt == BIN_CBOR ? 0xfa : 0xca, b, 4);
+}
+static void put_f64(bw_t* w, double x){
+  uint64_t b; memcpy(&b, &x, 8);
+  bw_be(w, w->fmt == BIN_CBOR ? 0xfb : 0xcb, b, 8);
+}
+static void put_text(bw_t* w, const char* s, uint32_t n){
+  if (w->fmt == BIN_CBOR) cbor_head(w, 3, n);
+  else mp_len(w, 0xa0, 31, 0xd9, 0xda, n);
+  bw_put(w, s, n);
+}
+static void put_cont(bw_t* w, int map, uint32_t n){
+  if (w->fmt == BIN_CBOR) cbor_head(w, map ? 5 : 4, n);
+  else if (map) mp_len(w, 0x80, 15, 0, 0xde, n);
+  else mp_len(w, 0x90, 15, 0, 0xdc, n);
+}
+
+/**
+ * @brief FIX value raw / 10^scale.
+ */
+static void put_fix(bw_t* w, int32_t raw, int scale){
+  static const double p10[BJD_FIX_SCALE_MAX+1] = { 1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9 };
+  if (!scale){ put_i64(w, raw); return; }
+  if (w->fmt == BIN_CBOR){   // tag 4, [exponent, mantissa]
+    bw_byte(w, 0xc4); bw_byte(w, 0x82);
+    put_i64(w, -scale); put_i64(w, raw);
+    return;
+  }
+  put_f64(w, (double)raw / p10[scale]);   // correctly rounded quotient
+}
+
+#define BW_STOP_CORRUPT 1
+
+/**
+ * @brief Write the elements of a packed typed array.
+ */
+static int put_packed(bw_t* w, const bjd_entry_t* e){
+  const bjd_type_info_t* ti = bjd_type_info(BJD_ELEM_TYPE(e->type));
+  if (!ti || !ti->width || e->val_len % ti->width) return BW_STOP_CORRUPT;
+  uint32_t n = e->val_len / ti->width;
+  const uint8_t* p = e->val;
+  put_cont(w, 0, n);
+  for (uint32_t i=0;i<n;i++, p+=ti->width){
+    switch (BJD_ELEM_TYPE(e->type)){
+      case BJD_T_I16: { int16_t v;  memcpy(&v, p, 2); put_i64(w, v); break; }
+      case BJD_T_U16: { uint16_t v; memcpy(&v, p, 2); put_u64(w, v); break; }
+      case BJD_T_I32: { int32_t v;  memcpy(&v, p, 4); put_i64(w, v); break; }
+      case BJD_T_U32: { uint32_t v; memcpy(&v, p, 4); put_u64(w, v); break; }
+      case BJD_T_I64: { int64_t v;  memcpy(&v, p, 8); put_i64(w, v); break; }
+      case BJD_T_U64: { uint64_t v; memcpy(&v, p, 8); put_u64(w, v); break; }
+      case BJD_T_F32: { float v;    memcpy(&v, p, 4); put_f32(w, v); break; }
+      case BJD_T_F64: { double v;   memcpy(&v, p, 8); put_f64(w, v); break; }
+      default: return BW_STOP_CORRUPT;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief bjd_visit callback: write one entry (containers: their head).
+ */
+static int put_ent(const bjd_entry_t* e, uint32_t depth, int leave, void* user){
+  bw_t* w = (bw_t*)user;
+  if (leave) return 0;   // definite lengths: nothing to close
+  uint8_t nl; const char* nm = bjd_entry_name(e, &nl);
+  if (!w->arr[depth]) put_text(w, nm, nl);
+
+  if (BJD_IS_PACKED(e->type)) return put_packed(w, e);
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)e->type);
+  if (!ti) return BW_STOP_CORRUPT;
+  int64_t i; uint64_t u; double f; float g; uint8_t b; int32_t raw; bjd_doc_t sub;
+  switch (ti->kind){
+    case BJD_K_STR: put_text(w, (const char*)e->val, e->val_len); break;
+    case BJD_K_INT:  if (bjd_entry_value(e, BJD_T_I64, &i)) return BW_STOP_CORRUPT; put_i64(w, i); break;
+    case BJD_K_UINT: if (bjd_entry_value(e, BJD_T_U64, &u)) return BW_STOP_CORRUPT; put_u64(w, u); break;
+    case BJD_K_FLOAT:
+      if (ti->width == 4){ if (bjd_entry_value(e, BJD_T_F32, &g)) return BW_STOP_CORRUPT; put_f32(w, g); }
+      else { if (bjd_entry_value(e, BJD_T_F64, &f)) return BW_STOP_CORRUPT; put_f64(w, f); }
+      break;
+    case BJD_K_BOOL:
+      if (bjd_entry_value(e, BJD_T_BOOL, &b)) return BW_STOP_CORRUPT;
+      bw_byte(w, w->fmt == BIN_CBOR ? (b ? 0xf5 : 0xf4) : (b ? 0xc3 : 0xc2));
+      break;
+    case BJD_K_FIX: {
+      const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+      int sc = pr ? bjd_key_scale(nm, nl, pr) : -1;
+      if (sc < 0 || bjd_entry_value(e, BJD_T_FIX32, &raw)) return BW_STOP_CORRUPT;
+      put_fix(w, raw, sc);
+      break;
+    }
+    case BJD_K_OBJ: case BJD_K_ARR:   // children follow from bjd_visit
+      if (depth + 1 > BJD_DEPTH_MAX || bjd_enter(e, &sub) != BJD_OK) return BW_STOP_CORRUPT;
+      put_cont(w, ti->kind == BJD_K_OBJ, sub.count);
+      w->arr[depth+1] = ti->kind == BJD_K_ARR;
+      break;
+    default: return BW_STOP_CORRUPT;
+  }
+  return 0;
+}
+
+/**
+ * @brief Shared body of bjd_to_cbor and bjd_to_msgpack.
+ *
+ * A bjd_enter view of an array (`d->arr`) is written as an array, every
+ * other document as a map (as bjd_to_json does).
+ */
+static bjd_err_t to_bin(const bjd_doc_t* d, int fmt, uint8_t* out, size_t cap, size_t* len){
+  if (!d || !len) return BJD_EINVAL;
+  bw_t w; memset(&w, 0, sizeof(w));
+  w.out = out; w.cap = out ? cap : 0; w.fmt = (uint8_t)fmt;
+  w.arr[0] = d->arr;
+  put_cont(&w, !d->arr, d->count);
+  int rc = bjd_visit(d, put_ent, &w);
+  *len = w.pos;
+  if (rc) return BJD_ECORRUPT;
+  return (!out || w.pos > cap) ? BJD_EBUF : BJD_OK;
+}
+
+/**
+ * @brief Serialize a document as CBOR (RFC 8949) into a caller buffer.
+ *
+ * A map with the stored keys (key IDs as their dictionary names); see
+ * the mapping at the top of this file. With `out` NULL (or too short)
+ * `*len` still receives the exact length.
+ *
+ * @param doc Document.
+ * @param out Output buffer, or NULL for size only.
+ * @param cap Capacity of `out`.
+ * @param len[out] CBOR length (also when it did not fit).
+ * @return BJD_OK, BJD_EBUF if `out` is NULL or too short, BJD_ECORRUPT
+ *         on an entry that cannot be written.
+ */
+bjd_err_t bjd_to_cbor(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len){
+  return to_bin(doc, BIN_CBOR, out, cap, len);
+}
+
+/**
+ * @brief Serialize a document as MessagePack into a caller buffer.
+ *
+ * Same as bjd_to_cbor; FIX values become float64.
+ *
+ * @param doc Document.
+ * @param out Output buffer, or NULL for size only.
+ * @param cap Capacity of `out`.
+ * @param len[out] MessagePack length (also when it did not fit).
+ * @return BJD_OK, BJD_EBUF if `out` is NULL or too short, BJD_ECORRUPT
+ *         on an entry that cannot be written.
+ */
+bjd_err_t bjd_to_msgpack(const bjd_doc_t* doc, uint8_t* out, size_t cap, size_t* len){
+  return to_bin(doc, BIN_MSGPACK, out, cap, len);
+}
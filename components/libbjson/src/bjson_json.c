@@ -0,0 +1,460 @@
+#include "bjson.h"
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * BJSON -> compact JSON text (bjd_to_json / bjd_to_json_cb).
+ *
+ * No printf: integers go through a two-digit table, FIX values are exact
+ * decimal, floats use Grisu2 (cached powers of ten, 64-bit arithmetic
+ * only) with the float or double rounding interval, so every number
+ * parses back to the same bits. Strings are escaped in one pass; runs
+ * that need no escaping are copied whole.
+ */
+
+#define JSON_CHUNK 256   // sink mode: bytes batched per write callback
+
+/**
+ * Output state. Bytes go into a window (the caller buffer, or `buf` in
+ * sink mode); `done` counts what left the window: passed to the sink, or
+ * did not fit a short caller buffer.
+ */
+typedef struct {
+  char* out; size_t cap, pos;         // window
+  size_t done;
+  bjd_write_fn fn; void* user;        // sink mode
+  int err;                            // sink refused a write
+  uint8_t first[BJD_DEPTH_MAX+1];     // no member written yet at this depth
+  uint8_t arr[BJD_DEPTH_MAX+1];       // this depth is an array (no keys)
+  char buf[JSON_CHUNK];
+} jw_t;
+
+/**
+ * @brief Pass the window to the sink and empty it.
+ */
+static void flush(jw_t* w){
+  if (w->pos && !w->err && w->fn(w->out, w->pos, w->user)) w->err=1;
+  w->done += w->pos; w->pos = 0;
+}
+
+/**
+ * @brief Append `n` bytes that do not fit the window.
+ *
+ * Sink mode flushes (long pieces go to the sink directly). Buffer mode
+ * closes the window and only counts from here on, so a short buffer
+ * still yields the exact required length.
+ */
+static void put_slow(jw_t* w, const char* s, size_t n){
+  if (w->fn){
+    flush(w);
+    if (n <= w->cap){ memcpy(w->out, s, n); w->pos = n; return; }
+    if (!w->err && w->fn(s, n, w->user)) w->err=1;
+  } else w->cap = w->pos;
+  w->done += n;
+}
+static inline void put(jw_t* w, const char* s, size_t n){
+  if (n <= w->cap - w->pos){ memcpy(w->out + w->pos, s, n); w->pos += n; }
+  else put_slow(w, s, n);
+}
+static inline void put1(jw_t* w, char c){
+  if (w->pos < w->cap) w->out[w->pos++] = c;
+  else put_slow(w, &c, 1);
+}
+
+static const char k_dig2[201] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+/**
+ * @brief Write `v` in decimal ending just before `end`, two digits per step.
+ *
+ * @return Number of digits written (they start at end - return value).
+ */
+static size_t dec_u64(uint64_t v, char* end){
+  char* p=end;
+  while (v >= 100){ unsigned r=(unsigned)(v % 100); v /= 100; p-=2; memcpy(p, k_dig2 + r*2, 2); }
+  if (v >= 10){ p-=2; memcpy(p, k_dig2 + v*2, 2); }
+  else *--p = (char)('0' + v);
+  return (size_t)(end - p);
+}
+
+static void put_u64(jw_t* w, uint64_t v){
+  char t[20]; size_t k = dec_u64(v, t + sizeof(t));
+  put(w, t + sizeof(t) - k, k);
+}
+static void put_i64(jw_t* w, int64_t v){
+  if (v < 0){ put1(w, '-'); put_u64(w, 0 - (uint64_t)v); }
+  else put_u64(w, (uint64_t)v);
+}
+
+/**
+ * @brief Write a FIX value raw / 10^scale as an exact decimal ("-0.05").
+ */
+static void put_fix(jw_t* w, int32_t raw, int scale){
+  char t[24]; char* end = t + sizeof(t);
+  uint64_t u = raw < 0 ? 0 - (uint64_t)(int64_t)raw : (uint64_t)raw;
+  size_t k = dec_u64(u, end);
+  while (k < (size_t)scale + 1) t[sizeof(t) - ++k] = '0';
+  if (raw < 0) put1(w, '-');
+  put(w, end - k, k - (size_t)scale);
+  if (scale){ put1(w, '.'); put(w, end - scale, (size_t)scale); }
+}
+
+#define ESC_ONES 0x0101010101010101ull
+#define ESC_HI   (ESC_ONES * 0x80)
+/** Non-zero if some byte of `v` is a control byte, '"' or '\\' (SWAR). */
+static inline uint64_t esc_word(uint64_t v){
+  uint64_t q = v ^ (ESC_ONES * '"'), b = v ^ (ESC_ONES * '\\');
+  return ((v - ESC_ONES * 0x20) & ~v & ESC_HI) | ((q - ESC_ONES) & ~q & ESC_HI) | ((b - ESC_ONES) & ~b & ESC_HI);
+}
+static inline int esc_byte(unsigned char c){ return c < 0x20 || c == '"' || c == '\\'; }
+
+/**
+ * @brief Write `s` as a quoted JSON string.
+ *
+ * '"', '\\' and control bytes are escaped (short forms where JSON has
+ * them, \\u00XX otherwise); everything else, UTF-8 included, is copied.
+ * Plain runs are found a word at a time and copied with one put.
+ */
+static void put_str(jw_t* w, const char* s, size_t n){
+  static const char k_ctl[32] = "uuuuuuuubtnufruuuuuuuuuuuuuuuuuu";
+  static const char k_hex[16] = "0123456789abcdef";
+  size_t run=0, i=0;
+  put1(w, '"');
+  while (i < n){
+    uint64_t v;
+    if (i + 8 <= n && (memcpy(&v, s + i, 8), !esc_word(v))){ i += 8; continue; }
+    size_t stop = i + 8 < n ? i + 8 : n;
+    while (i < stop && !esc_byte((unsigned char)s[i])) i++;
+    if (i == stop) continue;
+    unsigned char c = (unsigned char)s[i];
+    put(w, s + run, i - run); run = ++i;
+    char e[6] = { '\\', (char)c, '0', '0', 0, 0 };
+    if (c < 0x20){
+      e[1] = k_ctl[c];
+      if (e[1] == 'u'){ e[4] = k_hex[c >> 4]; e[5] = k_hex[c & 15]; put(w, e, 6); continue; }
+    }
+    put(w, e, 2);
+  }
+  put(w, s + run, n - run);
+  put1(w, '"');
+}
+
+/* ---- Grisu2 ---------------------------------------------------------- */
+
+/** f * 2^e */
+typedef struct { uint64_t f; int e; } dfp_t;
+
+/** 10^k for k = -348, -340, ..., 340, normalized, rounded to nearest. */
+static const struct { uint64_t f; int16_t e; } k_pow10[87] = {
+  {0xfa8fd5a0081c0288ull,-1220}, {0xbaaee17fa23ebf76ull,-1193}, {0x8b16fb203055ac76ull,-1166},
+  {0xcf42894a5dce35eaull,-1140}, {0x9a6bb0aa55653b2dull,-1113}, {0xe61acf033d1a45dfull,-1087},
+  {0xab70fe17c79ac6caull,-1060}, {0xff77b1fcbebcdc4full,-1034}, {0xbe5691ef416bd60cull,-1007},
+  {0x8dd01fad907ffc3cull,-980}, {0xd3515c2831559a83ull,-954}, {0x9d71ac8fada6c9b5ull,-927},
+  {0xea9c227723ee8bcbull,-901}, {0xaecc49914078536dull,-874}, {0x823c12795db6ce57ull,-847},
+  {0xc21094364dfb5637ull,-821}, {0x9096ea6f3848984full,-794}, {0xd77485cb25823ac7ull,-768},
+  {0xa086cfcd97bf97f4ull,-741}, {0xef340a98172aace5ull,-715}, {0xb23867fb2a35b28eull,-688},
+  {0x84c8d4dfd2c63f3bull,-661}, {0xc5dd44271ad3cdbaull,-635}, {0x936b9fcebb25c996ull,-608},
+  {0xdbac6c247d62a584ull,-582}, {0xa3ab66580d5fdaf6ull,-555}, {0xf3e2f893dec3f126ull,-529},
+  {0xb5b5ada8aaff80b8ull,-502}, {0x87625f056c7c4a8bull,-475}, {0xc9bcff6034c13053ull,-449},
+  {0x964e858c91ba2655ull,-422}, {0xdff9772470297ebdull,-396}, {0xa6dfbd9fb8e5b88full,-369},
+  {0xf8a95fcf88747d94ull,-343}, {0xb94470938fa89bcfull,-316}, {0x8a08f0f8bf0f156bull,-289},
+  {0xcdb02555653131b6ull,-263}, {0x993fe2c6d07b7facull,-236}, {0xe45c10c42a2b3b06ull,-210},
+  {0xaa242499697392d3ull,-183}, {0xfd87b5f28300ca0eull,-157}, {0xbce5086492111aebull,-130},
+  {0x8cbccc096f5088ccull,-103}, {0xd1b71758e219652cull,-77}, {0x9c40000000000000ull,-50},
+  {0xe8d4a51000000000ull,-24}, {0xad78ebc5ac620000ull,3}, {0x813f3978f8940984ull,30},
+  {0xc097ce7bc90715b3ull,56}, {0x8f7e32ce7bea5c70ull,83}, {0xd5d238a4abe98068ull,109},
+  {0x9f4f2726179a2245ull,136}, {0xed63a231d4c4fb27ull,162}, {0xb0de65388cc8ada8ull,189},
+  {0x83c7088e1aab65dbull,216}, {0xc45d1df942711d9aull,242}, {0x924d692ca61be758ull,269},
+  {0xda01ee641a708deaull,295}, {0xa26da3999aef774aull,322}, {0xf209787bb47d6b85ull,348},
+  {0xb454e4a179dd1877ull,375}, {0x865b86925b9bc5c2ull,402}, {0xc83553c5c8965d3dull,428},
+  {0x952ab45cfa97a0b3ull,455}, {0xde469fbd99a05fe3ull,481}, {0xa59bc234db398c25ull,508},
+  {0xf6c69a72a3989f5cull,534}, {0xb7dcbf5354e9beceull,561}, {0x88fcf317f22241e2ull,588},
+  {0xcc20ce9bd35c78a5ull,614}, {0x98165af37b2153dfull,641}, {0xe2a0b5dc971f303aull,667},
+  {0xa8d9d1535ce3b396ull,694}, {0xfb9b7cd9a4a7443cull,720}, {0xbb764c4ca7a44410ull,747},
+  {0x8bab8eefb6409c1aull,774}, {0xd01fef10a657842cull,800}, {0x9b10a4e5e9913129ull,827},
+  {0xe7109bfba19c0c9dull,853}, {0xac2820d9623bf429ull,880}, {0x80444b5e7aa7cf85ull,907},
+  {0xbf21e44003acdd2dull,933}, {0x8e679c2f5e44ff8full,960}, {0xd433179d9c8cb841ull,986},
+  {0x9e19db92b4e31ba9ull,1013}, {0xeb96bf6ebadf77d9ull,1039}, {0xaf87023b9bf0ee6bull,1066},
+};
+
+static const uint64_t k_p10[20] = {
+  1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+  1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+  100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+  1000000000000000000ull, 10000000000000000000ull
+};
+
+/** Upper 64 bits of the 128-bit product, rounded. */
+static dfp_t dfp_mul(dfp_t a, dfp_t b){
+  const uint64_t M32 = 0xFFFFFFFFu;
+  uint64_t ah=a.f>>32, al=a.f&M32, bh=b.f>>32, bl=b.f&M32;
+  uint64_t hh=ah*bh, lh=al*bh, hl=ah*bl, ll=al*bl;
+  uint64_t mid = (ll>>32) + (hl&M32) + (lh&M32) + (1u<<31);
+  dfp_t r = { hh + (hl>>32) + (lh>>32) + (mid>>32), a.e + b.e + 64 };
+  return r;
+}
+static dfp_t dfp_norm(dfp_t x){ int s=__builtin_clzll(x.f); x.f <<= s; x.e -= s; return x; }
+
+/**
+ * @brief Step the last digit down while that moves closer to the value.
+ */
+static void grisu_round(char* buf, int len, uint64_t delta, uint64_t rest, uint64_t ten_k, uint64_t wp_w){
+  while (rest < wp_w && delta - rest >= ten_k &&
+         (rest + ten_k < wp_w || wp_w - rest > rest + ten_k - wp_w)){
+    buf[len-1]--; rest += ten_k;
+  }
+}
+
+/**
+ * @brief Generate the digits of W inside the interval (Mp - delta, Mp).
+ *
+ * @param K[in,out] Decimal exponent; the value is digits * 10^K.
+ * @return Number of digits in `buf` (at most 17).
+ */
+static int digit_gen(dfp_t W, dfp_t Mp, uint64_t delta, char* buf, int* K){
+  dfp_t one = { 1ull << -Mp.e, Mp.e };
+  uint64_t wp_w = Mp.f - W.f;
+  uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+  uint64_t p2 = Mp.f & (one.f - 1);
+  int kappa = 1, len = 0;
+  while (kappa < 10 && p1 >= k_p10[kappa]) kappa++;
+  while (kappa > 0){
+    uint32_t q = (uint32_t)k_p10[kappa-1], d = p1 / q;
+    p1 %= q;
+    if (d || len) buf[len++] = (char)('0' + d);
+    kappa--;
+    uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+    if (rest <= delta){ *K += kappa; grisu_round(buf, len, delta, rest, k_p10[kappa] << -one.e, wp_w); return len; }
+  }
+  for (;;){
+    p2 *= 10; delta *= 10;
+    char d = (char)(p2 >> -one.e);
+    if (d || len) buf[len++] = (char)('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta){ *K += kappa; grisu_round(buf, len, delta, p2, one.f, -kappa < 20 ? wp_w * k_p10[-kappa] : 0); return len; }
+  }
+}
+
+/**
+ * @brief Shortest-ish digits of f * 2^e that round back to it.
+ *
+ * The rounding interval is that of the source format: `hidden` is the
+ * hidden-bit position (52 for double, 23 for float), so a float gets
+ * float-length digits ("0.1", not "0.100000001").
+ *
+ * @param K[out] Decimal exponent of the digit string.
+ * @return Number of digits in `buf`.
+ */
+static int grisu2(uint64_t f, int e, int hidden, char* buf, int* K){
+  dfp_t v = { f, e };
+  dfp_t pl = { (f << 1) + 1, e - 1 };
+  dfp_t mi = f == (1ull << hidden) ? (dfp_t){ (f << 2) - 1, e - 2 } : (dfp_t){ (f << 1) - 1, e - 1 };
+  pl = dfp_norm(pl);
+  mi.f <<= mi.e - pl.e; mi.e = pl.e;
+
+  // cached power bringing the product's exponent into [-60, -32]
+  double dk = (-61 - pl.e) * 0.30102999566398114 + 347;
+  int k = (int)dk;
+  if (dk - k > 0.0) k++;
+  unsigned i = (unsigned)((k >> 3) + 1);
+  *K = -(-348 + (int)(i << 3));
+  dfp_t c = { k_pow10[i].f, k_pow10[i].e };
+
+  dfp_t W = dfp_mul(dfp_norm(v), c), Wp = dfp_mul(pl, c), Wm = dfp_mul(mi, c);
+  Wm.f++; Wp.f--;
+  return digit_gen(W, Wp, Wp.f - Wm.f, buf, K);
+}
+
+/**
+ * @brief Lay out digits * 10^K as a JSON number (plain or exponent form).
+ */
+static void put_digits(jw_t* w, const char* d, int len, int K){
+  char t[32]; int kk = len + K, n;   // decimal point after kk digits
+  if (K >= 0 && kk <= 21){                 // 1234e7 -> 12340000000
+    memcpy(t, d, (size_t)len); memset(t + len, '0', (size_t)K); n = kk;
+  } else if (0 < kk && kk <= 21){          // 1234e-2 -> 12.34
+    memcpy(t, d, (size_t)kk); t[kk] = '.'; memcpy(t + kk + 1, d + kk, (size_t)(len - kk)); n = len + 1;
+  } else if (-6 < kk && kk <= 0){          // 1234e-6 -> 0.001234
+    t[0] = '0'; t[1] = '.'; memset(t + 2, '0', (size_t)-kk); memcpy(t + 2 - kk, d, (size_t)len); n = 2 - kk + len;
+  } else {                                 // 1234e30 -> 1.234e33
+    n = 0; t[n++] = d[0];
+    if (len > 1){ t[n++] = '.'; memcpy(t + n, d + 1, (size_t)(len - 1)); n += len - 1; }
+    t[n++] = 'e';
+    int x = kk - 1;
+    if (x < 0){ t[n++] = '-'; x = -x; }
+    char xe[4]; size_t xl = dec_u64((uint64_t)x, xe + sizeof(xe));
+    memcpy(t + n, xe + sizeof(xe) - xl, xl); n += (int)xl;
+  }
+  put(w, t, (size_t)n);
+}
+
+/**
+ * @brief Write a binary float given its fields; NaN and infinities become null.
+ *
+ * @param neg Sign bit.
+ * @param ex Biased exponent field.
+ * @param man Mantissa field.
+ * @param mbits Mantissa bits (52 or 23).
+ * @param exmax All-ones exponent (NaN/Inf).
+ * @param bias Exponent bias plus mbits (1075 or 150).
+ */
+static void put_float(jw_t* w, int neg, int ex, uint64_t man, int mbits, int exmax, int bias){
+  if (ex == exmax){ put(w, "null", 4); return; }   // JSON has no Inf/NaN
+  if (neg) put1(w, '-');
+  if (!ex && !man){ put1(w, '0'); return; }
+  char d[20]; int K;
+  uint64_t f = ex ? man | (1ull << mbits) : man;
+  int len = grisu2(f, ex ? ex - bias : 1 - bias, mbits, d, &K);
+  put_digits(w, d, len, K);
+}
+static void put_f64(jw_t* w, double x){
+  uint64_t b; memcpy(&b, &x, 8);
+  put_float(w, (int)(b >> 63), (int)((b >> 52) & 0x7FF), b & ((1ull << 52) - 1), 52, 0x7FF, 1075);
+}
+static void put_f32(jw_t* w, float x){
+  uint32_t b; memcpy(&b, &x, 4);
+  put_float(w, (int)(b >> 31), (int)((b >> 23) & 0xFF), b & ((1u << 23) - 1), 23, 0xFF, 150);
+}
+
+/* ---- walk ------------------------------------------------------------ */
+
+#define JW_STOP_SINK    1   // sink refused a write
+#define JW_STOP_CORRUPT 2   // entry cannot be written
+
+/**
+ * @brief Write the elements of a packed typed array as a JSON array.
+ */
+static int put_packed(jw_t* w, const bjd_entry_t* e){
+  const bjd_type_info_t* ti = bjd_type_info(BJD_ELEM_TYPE(e->type));
+  if (!ti || !ti->width || e->val_len % ti->width) return JW_STOP_CORRUPT;
+  uint32_t n = e->val_len / ti->width;
+  const uint8_t* p = e->val;
+  put1(w, '[');
+  for (uint32_t i=0;i<n;i++, p+=ti->width){
+    if (i) put1(w, ',');
+    switch (BJD_ELEM_TYPE(e->type)){
+      case BJD_T_I16: { int16_t v;  memcpy(&v, p, 2); put_i64(w, v); break; }
+      case BJD_T_U16: { uint16_t v; memcpy(&v, p, 2); put_u64(w, v); break; }
+      case BJD_T_I32: { int32_t v;  memcpy(&v, p, 4); put_i64(w, v); break; }
+      case BJD_T_U32: { uint32_t v; memcpy(&v, p, 4); put_u64(w, v); break; }
+      case BJD_T_I64: { int64_t v;  memcpy(&v, p, 8); put_i64(w, v); break; }
+      case BJD_T_U64: { uint64_t v; memcpy(&v, p, 8); put_u64(w, v); break; }
+      case BJD_T_F32: { float v;    memcpy(&v, p, 4); put_f32(w, v); break; }
+      case BJD_T_F64: { double v;   memcpy(&v, p, 8); put_f64(w, v); break; }
+      default: return JW_STOP_CORRUPT;
+    }
+  }
+  put1(w, ']');
+  return 0;
+}
+
+/**
+ * @brief bjd_visit callback: write one entry (or close a container).
+ */
+static int put_ent(const bjd_entry_t* e, uint32_t depth, int leave, void* user){
+  jw_t* w = (jw_t*)user;
+  if (leave){ put1(w, e->type == BJD_T_OBJ ? '}' : ']'); return w->err ? JW_STOP_SINK : 0; }
+  if (!w->first[depth]) put1(w, ',');
+  w->first[depth] = 0;
+  uint8_t nl; const char* nm = bjd_entry_name(e, &nl);
+  if (!w->arr[depth]){ put_str(w, nm, nl); put1(w, ':'); }
+
+  if (BJD_IS_PACKED(e->type)) return put_packed(w, e) ? JW_STOP_CORRUPT : (w->err ? JW_STOP_SINK : 0);
+  const bjd_type_info_t* ti = bjd_type_info((uint8_t)e->type);
+  if (!ti) return JW_STOP_CORRUPT;
+  int64_t i; uint64_t u; double f; float g; uint8_t b; int32_t raw;
+  switch (ti->kind){
+    case BJD_K_STR: put_str(w, (const char*)e->val, e->val_len); break;
+    case BJD_K_INT:  if (bjd_entry_value(e, BJD_T_I64, &i)) return JW_STOP_CORRUPT; put_i64(w, i); break;
+    case BJD_K_UINT: if (bjd_entry_value(e, BJD_T_U64, &u)) return JW_STOP_CORRUPT; put_u64(w, u); break;
+    case BJD_K_FLOAT:
+      if (ti->width == 4){ if (bjd_entry_value(e, BJD_T_F32, &g)) return JW_STOP_CORRUPT; put_f32(w, g); }
+      else { if (bjd_entry_value(e, BJD_T_F64, &f)) return JW_STOP_CORRUPT; put_f64(w, f); }
+      break;
+    case BJD_K_BOOL:
+      if (bjd_entry_value(e, BJD_T_BOOL, &b)) return JW_STOP_CORRUPT;
+      if (b) put(w, "true", 4); else put(w, "false", 5);
+      break;
+    case BJD_K_FIX: {
+      const bjd_prefix_t* pr = bjd_classify_key(nm, nl);
+      int sc = pr ? bjd_key_scale(nm, nl, pr) : -1;
+      if (sc < 0 || bjd_entry_value(e, BJD_T_FIX32, &raw)) return JW_STOP_CORRUPT;
+      put_fix(w, raw, sc);
+      break;
+    }
+    case BJD_K_OBJ: case BJD_K_ARR:   // children follow from bjd_visit
+      if (depth + 1 > BJD_DEPTH_MAX) return JW_STOP_CORRUPT;
+      put1(w, ti->kind == BJD_K_OBJ ? '{' : '[');
+      w->first[depth+1] = 1; w->arr[depth+1] = ti->kind == BJD_K_ARR;
+      break;
+    default: return JW_STOP_CORRUPT;
+  }
+  return w->err ? JW_STOP_SINK : 0;
+}
+
+/**
+ * @brief Shared body of bjd_to_json and bjd_to_json_cb.
+ *
+ * A bjd_enter view of an array (`d->arr`, empty ones included) is
+ * written as [...], every other document as {...}.
+ */
+static bjd_err_t to_json(const bjd_doc_t* d, jw_t* w){
+  w->first[0] = 1; w->arr[0] = d->arr;
+  put1(w, d->arr ? '[' : '{');
+  int rc = bjd_visit(d, put_ent, w);
+  put1(w, d->arr ? ']' : '}');
+  if (w->fn) flush(w);
+  if (rc == JW_STOP_SINK || w->err || (!w->fn && w->done)) return BJD_EBUF;  // buffer mode: done > 0 = did not fit
+  return rc ? BJD_ECORRUPT : BJD_OK;
+}
+
+/**
+ * @brief Serialize a document as compact JSON into a caller buffer.
+ *
+ * Keys are written as stored (type prefixes included; key IDs as their
+ * dictionary names), so the output encodes back to the same BJSON with
+ * bjson_encode_from_json and the same options. The text is
+ * not NUL-terminated. With `out` NULL (or too short) nothing more is
+ * written but `*len` still receives the exact length, so a size-only
+ * call followed by one sized call never truncates.
+ *
+ * @param doc Document (validated documents are walked unchecked).
+ * @param out Output buffer, or NULL for size only.
+ * @param cap Capacity of `out`.
+ * @param len[out] Length of the JSON text (also when it did not fit).
+ * @return BJD_OK, BJD_EBUF if `out` is NULL or too short, BJD_ECORRUPT
+ *         on an entry that cannot be written.
+ */
+bjd_err_t bjd_to_json(const bjd_doc_t* doc, char* out, size_t cap, size_t* len){
+  if (!doc || !len) return BJD_EINVAL;
+  jw_t w; memset(&w, 0, offsetof(jw_t, buf));
+  w.out = out ? out : w.buf; w.cap = out ? cap : 0;
+  bjd_err_t rc = to_json(doc, &w);
+  *len = w.done + w.pos;
+  return rc;
+}
+
+/**
+ * @brief Serialize a document as compact JSON through a write callback.
+ *
+ * Output is batched into JSON_CHUNK-byte pieces (longer strings go
+ * through in one call); the callback returns non-zero to abort.
+ *
+ * @param doc Document.
+ * @param fn Sink callback.
+ * @param user Passed to `fn`.
+ * @param len[out] Bytes produced, may be NULL.
+ * @return BJD_OK, BJD_EBUF if the sink aborted, BJD_ECORRUPT on an entry
+ *         that cannot be written.
+ */
+bjd_err_t bjd_to_json_cb(const bjd_doc_t* doc, bjd_write_fn fn, void* user, size_t* len){
+  if (!doc || !fn) return BJD_EINVAL;
+  jw_t w; memset(&w, 0, offsetof(jw_t, buf));
+  w.out = w.buf; w.cap = sizeof(w.buf); w.fn = fn; w.user = user;
+  bjd_err_t rc = to_json(doc, &w);
+  if (len) *len = w.done;
+  return rc;
+}
@@ -0,0 +1,92 @@
+#include "bjson_map.h"
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Map the image named `name` read-only.
+ *
+ * @param name Partition label (ESP-IDF) or file path (host).
+ * @param m[out] Receives map, map_len and handle.
+ * @return 1 on success, 0 if the image cannot be found or mapped.
+ */
+static int map_image(const char* name, bjd_map_t* m){
+#ifdef ESP_PLATFORM
+  const esp_partition_t* part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)BJD_PART_SUBTYPE, name);
+  if (!part) return 0;
+  esp_partition_mmap_handle_t h;
+  if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &m->map, &h) != ESP_OK) return 0;
+  m->map_len = part->size; m->handle = (uint32_t)h;
+  return 1;
+#else
+  int fd = open(name, O_RDONLY);
+  if (fd < 0) return 0;
+  struct stat st;
+  void* p = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0)
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);   // mapping stays valid
+  if (p == MAP_FAILED) return 0;
+  m->map = p; m->map_len = (size_t)st.st_size;
+  return 1;
+#endif
+}
+
+/**
+ * @brief Unmap whatever map_image mapped.
+ */
+static void unmap_image(bjd_map_t* m){
+#ifdef ESP_PLATFORM
+  esp_partition_munmap((esp_partition_mmap_handle_t)m->handle);
+#else
+  munmap((void*)m->map, m->map_len);
+#endif
+}
+
+/**
+ * @brief Open a precompiled BJSON image in place.
+ *
+ * The image may be followed by unused space (erased flash, file
+ * padding); bjd_doc_len finds where the document ends. All bjd_* calls
+ * on `m->doc` then read the mapping directly until bjd_close_mapped.
+ *
+ * @param name Partition label (ESP-IDF) or file path (host).
+ * @param validate Non-zero to run bjd_validate once after opening.
+ * @param dict Key-ID dictionary for BJD_F_DICT images, or NULL.
+ * @param m[out] Mapping and document.
+ * @return BJD_OK, BJD_EINVAL if the image is missing or truncated, or
+ *         the bjd_open / bjd_use_dict / bjd_validate error.
+ */
+bjd_err_t bjd_open_mapped(const char* name, int validate, const bjd_dict_t* dict, bjd_map_t* m){
+  if (!name || !m) return BJD_EINVAL;
+  memset(m,0,sizeof(*m));
+  if (!map_image(name, m)) return BJD_EINVAL;
+  size_t len;
+  bjd_err_t rc = bjd_doc_len((const uint8_t*)m->map, m->map_len, &len);
+  if (rc == BJD_OK) rc = bjd_open((const uint8_t*)m->map, len, &m->doc);
+  if (rc == BJD_OK && dict && (m->doc.flags & BJD_F_DICT)) rc = bjd_use_dict(&m->doc, dict);   // validate resolves key IDs
+  if (rc == BJD_OK && validate) rc = bjd_validate(&m->doc);
+  if (rc != BJD_OK){ unmap_image(m); memset(m,0,sizeof(*m)); }
+  return rc;
+}
+
+/**
+ * @brief Release a mapping from bjd_open_mapped.
+ *
+ * Entries, strings and arrays obtained from `m->doc` are invalid
+ * afterwards. Safe on a zeroed or already closed map.
+ *
+ * @param m Mapping.
+ */
+void bjd_close_mapped(bjd_map_t* m){
+  if (!m || !m->map) return;
+  unmap_image(m);
+  memset(m,0,sizeof(*m));
+}
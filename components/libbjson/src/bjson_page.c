@@ -0,0 +1,422 @@
+#include "bjson_page.h"
+#include <string.h>
+
+/*
+ * Paged reader (bjson_page.h): the lookups of bjson.c on document
+ * offsets, every byte fetched through a small block cache.
+ *
+ * A cached block normally holds the block-aligned range around the
+ * requested bytes; a request that straddles two such blocks gets a
+ * window of its own starting at the 8-byte boundary below it, so any
+ * range up to one block is contiguous in memory and values keep their
+ * alignment (documents are laid out for an 8-byte aligned base).
+ * Pointers from pc_get are only valid until the next pc_get, except in
+ * a pinned block.
+ */
+
+/** @brief Read 32-bit little-endian unsigned integer. */
+static uint32_t r32(const uint8_t* p){ return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24); }
+
+/** @brief Header size: the fixed header, plus the dictionary hash with BJD_F_DICT. */
+static uint32_t hdr_size(uint16_t flags){ return (flags & BJD_F_DICT) ? BJD_DICT_HDR_SIZE : BJD_HDR_SIZE; }
+
+/**
+ * @brief `n` document bytes at `off`, contiguous, from the cache.
+ *
+ * Looks at the last used block first, then every block; on a miss the
+ * least recently used unpinned block is refilled through the read
+ * callback.
+ *
+ * @param c Cache.
+ * @param off Document offset.
+ * @param n Byte count, at most one block.
+ * @param slot[out] Block holding the bytes (for pinning), may be NULL.
+ * @return Pointer to the bytes, NULL if out of range, every block is
+ *         pinned or the read failed.
+ */
+static const uint8_t* pc_get(bjd_pcache_t* c, uint32_t off, uint32_t n, int* slot){
+  if (n > c->block || off > c->len || n > c->len - off) return NULL;
+  uint32_t i = c->last;
+  bjd_pslot_t* s = &c->slot[i];
+  if (!(s->n && off >= s->off && off - s->off + n <= s->n)){
+    for (i=0;i<c->nslots;i++){ s = &c->slot[i]; if (s->n && off >= s->off && off - s->off + n <= s->n) break; }
+    if (i == c->nslots){   // miss: refill the least recently used unpinned block
+      uint32_t v = c->nslots;
+      for (uint32_t k=0;k<c->nslots;k++) if (!c->slot[k].pins && (v == c->nslots || c->slot[k].used < c->slot[v].used)) v = k;
+      if (v == c->nslots) return NULL;
+      i = v; s = &c->slot[i];
+      uint32_t start = off - off % c->block;
+      if ((uint64_t)off + n > (uint64_t)start + c->block){   // straddles: a window at the range
+        start = off & ~7u;
+        if ((uint64_t)off + n > (uint64_t)start + c->block) start = off;
+      }
+      uint32_t cnt = (c->len - start < c->block) ? c->len - start : c->block;
+      s->n = 0;
+      c->reads++; c->read_bytes += cnt;
+      if (c->read(c->user, start, c->mem + (size_t)i*c->block, cnt)) return NULL;
+      s->off = start; s->n = cnt;
+    } else c->hits++;
+    c->last = i;
+  } else c->hits++;
+  if (!++c->tick){ for (uint32_t k=0;k<c->nslots;k++) c->slot[k].used = 0; c->tick = 1; }
+  s->used = c->tick;
+  if (slot) *slot = (int)i;
+  return c->mem + (size_t)i*c->block + (off - s->off);
+}
+
+/**
+ * @brief Copy any document range through the cache.
+ *
+ * Works block by block, so `n` is not limited by the block size.
+ *
+ * @param c Cache.
+ * @param off Document offset.
+ * @param dst[out] Destination.
+ * @param n Byte count.
+ * @return 0 on success, -1 if out of range or a read failed.
+ */
+int bjd_pg_read(bjd_pcache_t* c, uint32_t off, void* dst, size_t n){
+  if (!c || (n && !dst) || off > c->len || n > c->len - off) return -1;
+  uint8_t* d = (uint8_t*)dst;
+  while (n){
+    uint32_t k = c->block - off % c->block;
+    if (k > n) k = (uint32_t)n;
+    const uint8_t* p = pc_get(c, off, k, NULL);
+    if (!p) return -1;
+    memcpy(d, p, k); d += k; off += k; n -= k;
+  }
+  return 0;
+}
+
+/**
+ * @brief Read a LEB128 varint (BJD_F_COMPACT lengths and counts).
+ *
+ * @param c Cache.
+ * @param off Offset of the first byte.
+ * @param room Bytes readable from `off`.
+ * @param v[out] Value.
+ * @return Varint length in bytes, 0 if truncated or wider than 32 bits.
+ */
+static uint32_t pg_varint(bjd_pcache_t* c, uint32_t off, uint32_t room, uint32_t* v){
+  const uint8_t* p = pc_get(c, off, room < 5 ? room : 5, NULL);
+  if (!p) return 0;
+  uint32_t x = 0;
+  for (uint32_t k=0; k<5 && k<room; k++){
+    if (k == 4 && p[k] > 0x0F) return 0;
+    x |= (uint32_t)(p[k] & 0x7F) << (7*k);
+    if (!(p[k] & 0x80)){ *v = x; return k + 1; }
+  }
+  return 0;
+}
+
+/**
+ * @brief Decode the entry at `off`; it must end by `end`.
+ *
+ * The checks of load_ent / load_cent: the name and value fit, the pad is
+ * inside the value, reserved words stay in front of `end`. A string
+ * back-reference is resolved as in sref: `val` becomes the earlier
+ * string, which must end before the entry.
+ *
+ * @return 1 on success, 0 if the entry is truncated or unreadable.
+ */
+static int pg_ent(const bjd_pdoc_t* d, uint32_t off, uint32_t end, bjd_pentry_t* e){
+  bjd_pcache_t* c = d->c;
+  const uint8_t* p;
+  if (off > end) return 0;
+  uint32_t room = end - off;
+  if (d->compact){
+    if (room < 2 || !(p = pc_get(c, off, 2, NULL)) || room - 2 < p[1]) return 0;
+    e->type = (bjd_type_t)p[0]; e->name_len = p[1];
+    uint32_t at = off + 2 + e->name_len, vlen, k = pg_varint(c, at, end - at, &vlen);
+    if (!k || end - (at + k) < vlen) return 0;
+    e->val = at + k; e->val_len = vlen; e->next = e->val + vlen;
+  } else {
+    if (room < 8 || !(p = pc_get(c, off, 8, NULL))) return 0;
+    uint8_t nlen = p[1], pad = p[2], rsv = p[3];
+    uint32_t vlen = r32(p+4);
+    if ((uint64_t)room - 8 < (uint64_t)nlen + vlen || pad > vlen) return 0;
+    uint64_t nx = ((uint64_t)off + 8 + nlen + vlen + 3) & ~(uint64_t)3;
+    if (rsv){ if (nx > end || end - nx < 4u*rsv) return 0; nx += 4u*rsv; }
+    e->type = (bjd_type_t)p[0]; e->name_len = nlen;
+    e->val = off + 8 + nlen + pad; e->val_len = vlen - pad;
+    e->next = nx > UINT32_MAX ? UINT32_MAX : (uint32_t)nx;   // past `end`: the next pg_ent fails
+  }
+  e->off = off; e->compact = d->compact; e->dict = d->dict; e->sref = d->sref;
+  if (e->type == BJD_T_SREF){
+    if (!d->sref || e->val_len != 8 || !(p = pc_get(c, e->val, 8, NULL))) return 0;
+    uint32_t at = r32(p), n = r32(p+4);
+    if (at > off || n > off - at) return 0;
+    e->type = BJD_T_STR; e->val = at; e->val_len = n;
+  }
+  return 1;
+}
+
+/** @brief The stored name of `e` equals `key`. */
+static int name_eq(const bjd_pdoc_t* d, const bjd_pentry_t* e, const char* key, size_t klen){
+  if (e->name_len != klen) return 0;
+  const uint8_t* p = pc_get(d->c, e->off + (e->compact ? 2 : 8), (uint32_t)klen, NULL);
+  return p && memcmp(p, key, klen) == 0;
+}
+
+/** @brief Linear lookup, as find_linear: one entry header (and name) per step. */
+static int find_linear(const bjd_pdoc_t* d, const char* key, size_t klen, bjd_pentry_t* out){
+  uint32_t off = d->entries, end = d->base + d->len;
+  for (uint32_t i=0;i<d->count;i++){
+    bjd_pentry_t e;
+    if (!pg_ent(d, off, end, &e)) return -1;
+    if (name_eq(d, &e, key, klen)){ *out = e; return (int)i; }
+    off = e.next;
+  }
+  return -1;
+}
+
+/** @brief Indexed lookup, as find_indexed: slot, offset, entry. */
+static int find_indexed(const bjd_pdoc_t* d, const char* key, size_t klen, uint32_t h, bjd_pentry_t* out){
+  uint32_t mask = d->nslots - 1;
+  for (uint32_t n=0, i=h&mask; n<d->nslots; n++, i=(i+1)&mask){
+    const uint8_t* s = pc_get(d->c, d->slots + i*8, 8, NULL);
+    if (!s) return -1;
+    uint32_t ref = r32(s+4);
+    if (!ref) return -1;
+    if (r32(s) != h || ref > d->count) continue;
+    const uint8_t* o = pc_get(d->c, d->offs + (ref-1)*4, 4, NULL);
+    bjd_pentry_t e;
+    if (!o || !pg_ent(d, r32(o), d->len, &e)) return -1;
+    if (name_eq(d, &e, key, klen)){ *out = e; return (int)(ref-1); }
+  }
+  return -1;
+}
+
+/**
+ * @brief Set up a block cache over caller memory.
+ *
+ * @param c[out] Cache.
+ * @param read Read callback (pread-style).
+ * @param user Passed to `read`.
+ * @param mem 8-byte aligned block memory.
+ * @param mem_size Size of `mem`; mem_size / block blocks are used (at
+ *                 most BJD_PAGE_SLOTS_MAX).
+ * @param block Block size: at least BJD_PAGE_BLOCK_MIN, a multiple of 8.
+ * @return BJD_OK, or BJD_EINVAL on bad arguments or room for no block.
+ */
+bjd_err_t bjd_pcache_init(bjd_pcache_t* c, bjd_read_fn read, void* user, void* mem, size_t mem_size, uint32_t block){
+  if (!c || !read || !mem || ((uintptr_t)mem & 7) || block < BJD_PAGE_BLOCK_MIN || (block & 7) || mem_size < block) return BJD_EINVAL;
+  memset(c, 0, sizeof(*c));
+  c->read = read; c->user = user; c->mem = (uint8_t*)mem; c->block = block;
+  c->nslots = (mem_size / block > BJD_PAGE_SLOTS_MAX) ? BJD_PAGE_SLOTS_MAX : (uint32_t)(mem_size / block);
+  return BJD_OK;
+}
+
+/**
+ * @brief Open a document behind a block cache.
+ *
+ * The counterpart of bjd_open: reads the header and, with BJD_F_INDEX,
+ * checks the index section location. Blocks of a previously opened
+ * document are dropped. Only the header is checked here; entries are
+ * checked as they are read.
+ *
+ * @param c Cache from bjd_pcache_init (no pins outstanding).
+ * @param len Exact document length (index section and CRC trailer included).
+ * @param d[out] Root document.
+ * @return BJD_OK, BJD_EMAGIC, or BJD_EINVAL on a bad header, index or read error.
+ */
+bjd_err_t bjd_open_paged(bjd_pcache_t* c, size_t len, bjd_pdoc_t* d){
+  if (!c || !d || len < BJD_HDR_SIZE || len > UINT32_MAX - 8) return BJD_EINVAL;
+  memset(c->slot, 0, sizeof(c->slot));
+  c->len = (uint32_t)len; c->last = 0;
+  const uint8_t* h = pc_get(c, 0, BJD_HDR_SIZE, NULL);
+  if (!h) return BJD_EINVAL;
+  if (memcmp(h, "BJSN", 4) != 0) return BJD_EMAGIC;
+  memset(d, 0, sizeof(*d));
+  d->c = c; d->len = (uint32_t)len; d->count = r32(h+8);
+  d->flags = (uint16_t)(h[6] | (h[7]<<8));
+  uint32_t hdr = hdr_size(d->flags), plen = d->len - ((d->flags & BJD_F_CRC) ? 4 : 0);
+  d->entries = hdr; d->compact = (d->flags & BJD_F_COMPACT) != 0; d->sref = (d->flags & BJD_F_SREF) != 0;
+  if (len < hdr + ((d->flags & BJD_F_CRC) ? 4u : 0u)) return BJD_EINVAL;
+  if (d->compact && (d->flags & (BJD_F_INDEX | BJD_F_RESERVE))) return BJD_EINVAL;
+  if (d->flags & BJD_F_INDEX){   // as open_index
+    const uint8_t* p;
+    if (plen < hdr + 8 || !(p = pc_get(c, plen - 4, 4, NULL))) return BJD_EINVAL;
+    uint32_t off = r32(p);
+    if (off < hdr || off > plen - 8 || !(p = pc_get(c, off, 4, NULL))) return BJD_EINVAL;
+    uint32_t nslots = r32(p);
+    if (nslots == 0 || (nslots & (nslots-1)) || nslots < d->count) return BJD_EINVAL;
+    if (4 + (uint64_t)nslots*8 + (uint64_t)d->count*4 > (uint64_t)plen - 4 - off) return BJD_EINVAL;
+    d->nslots = nslots; d->slots = off + 4; d->offs = d->slots + nslots*8;
+  }
+  return BJD_OK;
+}
+
+/**
+ * @brief Attach the key dictionary of a BJD_F_DICT document (root only).
+ *
+ * @return BJD_OK, BJD_EDICT on a hash mismatch, BJD_EINVAL otherwise.
+ */
+bjd_err_t bjd_pg_use_dict(bjd_pdoc_t* d, const bjd_dict_t* dict){
+  uint8_t h[4];
+  if (!d || !dict || !(d->flags & BJD_F_DICT) || d->base || d->entries != BJD_DICT_HDR_SIZE) return BJD_EINVAL;
+  if (bjd_pg_read(d->c, BJD_HDR_SIZE, h, 4)) return BJD_EINVAL;
+  if (r32(h) != dict->hash) return BJD_EDICT;
+  d->dict = dict;
+  return BJD_OK;
+}
+
+/**
+ * @brief Find an entry by key name, as bjd_find.
+ *
+ * Reads the index slots probed, or the entry headers and names walked,
+ * and the matching entry's header; no value bytes.
+ *
+ * @param d Document or view.
+ * @param key NUL-terminated key name.
+ * @param out[out] Entry on success.
+ * @return Index of entry on success, -1 if not found or on error.
+ */
+int bjd_pg_find(const bjd_pdoc_t* d, const char* key, bjd_pentry_t* out){
+  size_t klen = strlen(key); char id[BJD_KEY_ID_LEN];
+  int i = d->dict ? bjd_dict_id(d->dict, key, klen) : -1;
+  if (i >= 0){ id[0]=0; id[1]=(char)(uint8_t)i; id[2]=(char)(uint8_t)(i>>8); key = id; klen = BJD_KEY_ID_LEN; }
+  if (d->nslots) return find_indexed(d, key, klen, bjd_hash(key, klen), out);
+  return find_linear(d, key, klen, out);
+}
+
+/**
+ * @brief View a container entry as a document of its children, as bjd_enter.
+ *
+ * @return BJD_OK, or BJD_EINVAL if `e` is not a well-formed container.
+ */
+bjd_err_t bjd_pg_enter(const bjd_pdoc_t* d, const bjd_pentry_t* e, bjd_pdoc_t* sub){
+  if (!d || !e || !sub || (e->type != BJD_T_OBJ && e->type != BJD_T_ARR)) return BJD_EINVAL;
+  uint32_t cnt, k;
+  if (e->compact){ if (!(k = pg_varint(d->c, e->val, e->val_len, &cnt))) return BJD_EINVAL; }
+  else {
+    const uint8_t* p;
+    if (e->val_len < 4 || !(p = pc_get(d->c, e->val, 4, NULL))) return BJD_EINVAL;
+    cnt = r32(p); k = 4;
+  }
+  memset(sub, 0, sizeof(*sub));
+  sub->c = d->c; sub->base = e->val; sub->len = e->val_len; sub->count = cnt; sub->entries = e->val + k;
+  sub->dict = e->dict; sub->compact = e->compact; sub->sref = e->sref;
+  return BJD_OK;
+}
+
+/**
+ * @brief Convert a fixed-size value, as bjd_entry_value.
+ *
+ * The value bytes are copied out of the cache and converted by
+ * bjd_entry_value, so the stored-type rules are the same. Strings,
+ * containers and packed arrays: bjd_pg_get_str / bjd_pg_enter /
+ * bjd_pg_get_array.
+ *
+ * @return 0 on success, -1 on type/size mismatch or a read error.
+ */
+int bjd_pg_entry_value(const bjd_pdoc_t* d, const bjd_pentry_t* e, bjd_type_t want, void* dst){
+  const bjd_type_info_t* wi = bjd_type_info((uint8_t)want);
+  if (!wi || wi->kind == BJD_K_STR || wi->kind == BJD_K_OBJ || wi->kind == BJD_K_ARR || e->val_len > 8) return -1;
+  uint8_t v[8]; bjd_entry_t t;
+  if (bjd_pg_read(d->c, e->val, v, e->val_len)) return -1;
+  memset(&t, 0, sizeof(t));
+  t.type = e->type; t.val = v; t.val_len = e->val_len; t.dict = e->dict; t.compact = e->compact;
+  return bjd_entry_value(&t, want, dst);
+}
+
+/** @brief Shared body of the copying getters. */
+static int pg_get(const bjd_pdoc_t* d, const char* key, bjd_type_t want, void* dst){
+  bjd_pentry_t e;
+  if (bjd_pg_find(d, key, &e) < 0) return -1;
+  return bjd_pg_entry_value(d, &e, want, dst);
+}
+
+/** @brief bjd_get_i32 on a paged document. */
+int bjd_pg_get_i32(const bjd_pdoc_t* d, const char* key, int32_t* out){ return pg_get(d, key, BJD_T_I32, out); }
+/** @brief bjd_get_u32 on a paged document. */
+int bjd_pg_get_u32(const bjd_pdoc_t* d, const char* key, uint32_t* out){ return pg_get(d, key, BJD_T_U32, out); }
+/** @brief bjd_get_i64 on a paged document. */
+int bjd_pg_get_i64(const bjd_pdoc_t* d, const char* key, int64_t* out){ return pg_get(d, key, BJD_T_I64, out); }
+/** @brief bjd_get_u64 on a paged document. */
+int bjd_pg_get_u64(const bjd_pdoc_t* d, const char* key, uint64_t* out){ return pg_get(d, key, BJD_T_U64, out); }
+/** @brief bjd_get_f32 on a paged document. */
+int bjd_pg_get_f32(const bjd_pdoc_t* d, const char* key, float* out){ return pg_get(d, key, BJD_T_F32, out); }
+/** @brief bjd_get_f64 on a paged document. */
+int bjd_pg_get_f64(const bjd_pdoc_t* d, const char* key, double* out){ return pg_get(d, key, BJD_T_F64, out); }
+/** @brief bjd_get_bool on a paged document. */
+int bjd_pg_get_bool(const bjd_pdoc_t* d, const char* key, bool* out){
+  uint8_t v; if (pg_get(d, key, BJD_T_BOOL, &v) < 0) return -1;
+  *out = v != 0; return 0;
+}
+
+/**
+ * @brief bjd_get_fix on a paged document (scale from the stored name).
+ */
+int bjd_pg_get_fix(const bjd_pdoc_t* d, const char* key, int32_t* raw, uint8_t* scale){
+  bjd_pentry_t e; char nm[255];
+  if (bjd_pg_find(d, key, &e) < 0 || bjd_pg_entry_value(d, &e, BJD_T_FIX32, raw) < 0) return -1;
+  if (bjd_pg_read(d->c, e.off + (e.compact ? 2 : 8), nm, e.name_len)) return -1;
+  bjd_entry_t t; memset(&t, 0, sizeof(t));
+  t.type = e.type; t.name = nm; t.name_len = e.name_len; t.dict = e.dict;
+  uint8_t nl; const char* n = bjd_entry_name(&t, &nl);   // key IDs through the dictionary
+  const bjd_prefix_t* pr = bjd_classify_key(n, nl);
+  int sc = pr ? bjd_key_scale(n, nl, pr) : -1;
+  if (sc < 0) return -1;
+  *scale = (uint8_t)sc; return 0;
+}
+
+/**
+ * @brief Pin `n` value bytes at `off` in the cache.
+ */
+static int pin(bjd_pcache_t* c, uint32_t off, uint32_t n, bjd_pin_t* out){
+  int slot;
+  const uint8_t* p = pc_get(c, off, n, &slot);
+  if (!p) return -1;
+  c->slot[slot].pins++;
+  out->p = p; out->slot = (int16_t)slot;
+  return 0;
+}
+
+/**
+ * @brief String value by key as a pinned slice, as bjd_get_str.
+ *
+ * `s->p` stays valid until bjd_pg_unpin; the string must fit in one block.
+ *
+ * @return 0 on success, -1 if not found, not a string, too long or every block is pinned.
+ */
+int bjd_pg_get_str(const bjd_pdoc_t* d, const char* key, bjd_pin_t* s){
+  bjd_pentry_t e;
+  s->p = NULL; s->n = 0; s->slot = -1;
+  if (bjd_pg_find(d, key, &e) < 0) return -1;
+  const bjd_type_info_t* si = bjd_type_info((uint8_t)e.type);
+  if (!si || si->kind != BJD_K_STR || pin(d->c, e.val, e.val_len, s)) return -1;
+  s->n = e.val_len;
+  return 0;
+}
+
+/**
+ * @brief Packed typed array by key as a pinned slice, as bjd_get_array.
+ *
+ * `a->n` is the element count. Aligned when `mem` is; the array must fit
+ * in one block.
+ *
+ * @return 0 on success, -1 on not found, type mismatch, an element type
+ *         without a packed form, misalignment or no block.
+ */
+int bjd_pg_get_array(const bjd_pdoc_t* d, const char* key, bjd_type_t elem, bjd_pin_t* a){
+  bjd_pentry_t e;
+  a->p = NULL; a->n = 0; a->slot = -1;
+  uint8_t w = bjd_packed_width((uint8_t)elem);
+  if (!w || bjd_pg_find(d, key, &e) < 0 || !BJD_IS_PACKED(e.type) || BJD_ELEM_TYPE(e.type) != (uint8_t)elem) return -1;
+  if (e.val_len % w || pin(d->c, e.val, e.val_len, a)) return -1;
+  if ((uintptr_t)a->p & (uintptr_t)(w-1)){ bjd_pg_unpin(d->c, a); return -1; }
+  a->n = e.val_len / w;
+  return 0;
+}
+
+/**
+ * @brief Release a pinned slice; the block may be evicted again.
+ *
+ * Safe on an empty or already released pin.
+ */
+void bjd_pg_unpin(bjd_pcache_t* c, bjd_pin_t* p){
+  if (!c || !p) return;
+  if (p->slot >= 0 && (uint32_t)p->slot < c->nslots && c->slot[p->slot].pins) c->slot[p->slot].pins--;
+  p->p = NULL; p->slot = -1;
+}
@@ -0,0 +1,89 @@
+#include "bjson_types.h"
+
+static const bjd_type_info_t k_wire[] = {
+#define BJD_X_INFO(name, id, kind, width, mn, mx) [id] = { id, kind, width, mn, mx },
+  BJD_WIRE_TYPES(BJD_X_INFO)
+#undef BJD_X_INFO
+};
+
+static const bjd_prefix_t k_prefix[] = {
+#define BJD_X_PREFIX(pfx, name, limit) { pfx, sizeof(pfx)-1, BJD_T_##name, limit },
+  BJD_KEY_PREFIXES(BJD_X_PREFIX)
+#undef BJD_X_PREFIX
+};
+#define N_PREFIX (sizeof(k_prefix)/sizeof(k_prefix[0]))
+
+/**
+ * @brief Look up the registry row of a wire type byte.
+ *
+ * @param type Wire type byte.
+ * @return Row pointer, or NULL for unregistered types.
+ */
+const bjd_type_info_t* bjd_type_info(uint8_t type){
+  if (type >= sizeof(k_wire)/sizeof(k_wire[0]) || k_wire[type].type != type) return NULL;
+  return &k_wire[type];
+}
+
+/**
+ * @brief Element width of a packed array.
+ *
+ * Only BJD_PACKED_TYPES scalars are packed; anything else a document
+ * (or a caller) names as the element type gets 0, so the width can be
+ * used as a divisor once checked.
+ *
+ * @param elem Element type byte (BJD_ELEM_TYPE of the wire type).
+ * @return 2, 4 or 8, or 0 if `elem` has no packed form.
+ */
+uint8_t bjd_packed_width(uint8_t elem){
+  switch (elem){
+#define BJD_X_WIDTH(name, ctype, sfx) case BJD_T_##name: return (uint8_t)sizeof(ctype);
+    BJD_PACKED_TYPES(BJD_X_WIDTH)
+#undef BJD_X_WIDTH
+    default: return 0;
+  }
+}
+
+/**
+ * @brief Classify a key by its registered type prefix.
+ *
+ * The prefix table is sorted, so the rows that agree with the first `i`
+ * key bytes form a contiguous range [lo, hi), and a row whose prefix ends
+ * at `i` sits at `lo`. Each key byte only moves the two bounds inward,
+ * so the cost is O(key length + table rows) with no strlen/strncmp per
+ * row. The longest matching prefix wins.
+ *
+ * @param key Key bytes (need not be NUL-terminated).
+ * @param klen Key length.
+ * @return Matching prefix row, or NULL if the key has no known prefix.
+ */
+const bjd_prefix_t* bjd_classify_key(const char* key, size_t klen){
+  size_t lo=0, hi=N_PREFIX;
+  const bjd_prefix_t* best=NULL;
+  for (size_t i=0; lo<hi; i++){
+    if (k_prefix[lo].plen == i){ best=&k_prefix[lo]; if (++lo >= hi) break; }
+    if (i >= klen) break;
+    unsigned char c = (unsigned char)key[i];
+    while (lo<hi && (unsigned char)k_prefix[lo].prefix[i] < c) lo++;
+    while (lo<hi && (unsigned char)k_prefix[hi-1].prefix[i] > c) hi--;
+  }
+  return best;
+}
+
+/**
+ * @brief Parse the decimal scale that follows a BJD_K_FIX prefix.
+ *
+ * @param key Key bytes.
+ * @param klen Key length.
+ * @param pr Prefix row returned by bjd_classify_key for `key`.
+ * @return Scale 0..BJD_FIX_SCALE_MAX, or -1 if the key is not
+ *         "<prefix><digits>_..." or the scale is out of range.
+ */
+int bjd_key_scale(const char* key, size_t klen, const bjd_prefix_t* pr){
+  size_t i = pr->plen; int sc = 0;
+  if (i >= klen || key[i] < '0' || key[i] > '9') return -1;
+  while (i < klen && key[i] >= '0' && key[i] <= '9'){
+    sc = sc*10 + (key[i]-'0'); i++;
+    if (sc > BJD_FIX_SCALE_MAX) return -1;
+  }
+  return (i < klen && key[i]=='_') ? sc : -1;
+}
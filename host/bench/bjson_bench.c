@@ -0,0 +1,1242 @@
+#include "bjson_enc.h"
+#include "bjson.h"
+#include "bjson_batch.h"
+#include "bjson_compact.h"
+#include "bjson_delta.h"
+#include "bjson_map.h"
+#include "bjson_page.h"
+#include "bjson_scan.h"
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * bjson_bench - host benchmark for json_enc and libbjson.
+ *
+ *   bjson_bench [-q] [-o out.json]
+ *
+ *   -q   quick run (short timing windows, for smoke tests)
+ *   -o   write the report to a file instead of stdout
+ *
+ * Documents are generated, not read: flat objects with N keys, string
+ * values of a given size, compact or pretty-printed, plus a number-heavy
+ * telemetry profile, one with escaped strings and two with Korean and mixed
+ * UTF-8 strings. The startup rows compare bringing a document up
+ * from JSON text (encode + validate) with mapping a precompiled image
+ * (bjd_open_mapped), the two boot paths of app_main; the paged rows
+ * bjd_open_paged lookups from a file at several block and cache sizes
+ * (reads per lookup, hit rate); the to_json rows
+ * time the reverse direction, the patch rows an in-place config update
+ * against a re-encode, the delta rows bjson_diff / bjson_patch, the
+ * dict rows key-ID documents (BJD_F_DICT) against plain ones, the
+ * compact rows the varint profile (BJD_F_COMPACT) and its conversion
+ * back to the aligned one on flat, number-heavy and nested shapes, the
+ * transcode rows BJSON to and from CBOR / MessagePack next to the JSON
+ * text route, the dedup rows string back-references (BJSON_ENC_F_DEDUP)
+ * on a generated fleet config: image size and encoder and read cost, the
+ * batch rows bjson_encode_batch scaling from 1 to 8 worker threads, the
+ * utf8 rows the UTF-8 validator on ASCII, Korean and mixed text. Every
+ * timed path is checked on its own data first (the three encoders
+ * produce the same bytes, bjd_to_json output encodes back to the same
+ * document, a delta rebuilds the new image exactly, lookups return the
+ * generated values, paged lookups return the same values as in-memory
+ * ones, a key-ID document reads back as the same JSON, a compact
+ * document reads back the same and expands to the original bytes, CBOR
+ * and MessagePack forms encode back to the same document, a
+ * deduplicated document reads back as the plain one, every batch item
+ * matches its single-threaded encode, the scan and UTF-8 kernels agree
+ * with the scalar references); a mismatch fails the run with exit code
+ * 1 before anything is reported. Checks on fixed inputs are in
+ * test/bjson_test.c (ctest).
+ *
+ * The report is one JSON object; each result row has a "bench" name, its
+ * parameters and its metrics, so runs can be diffed and tracked.
+ */
+
+#define LOOKUP_KEYS 1024   // lookup probes per timed round
+
+static double g_min_s = 0.2;   // timing window per measurement (-q: 0.02)
+static FILE*  g_out;
+static int    g_rows;
+static volatile uint64_t g_sink;   // keeps timed results alive
+
+/** Monotonic time in seconds. */
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/** Print a check failure and exit: numbers from a broken path are worthless. */
+static void fail(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "bjson_bench: check failed: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(1);
+}
+
+/** Open one report row; fields follow as printf fragments, closed by row_end. */
+static void row_begin(const char* bench)
+{
+    fprintf(g_out, "%s\n    {\"bench\": \"%s\"", g_rows++ ? "," : "", bench);
+}
+static void row_end(void) { fprintf(g_out, "}"); }
+
+/* ---------------------------------------------------------------------- */
+/* document generator                                                      */
+
+/** Growable text buffer. */
+typedef struct { char* s; size_t n, cap; } text_t;
+
+static void tx_put(text_t* t, const char* fmt, ...)
+{
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int k = vsnprintf(t->s + t->n, t->cap - t->n, fmt, ap);
+        va_end(ap);
+        if (k >= 0 && (size_t)k < t->cap - t->n) { t->n += (size_t)k; return; }
+        t->cap = t->cap * 2 + (size_t)k + 64;
+        t->s = realloc(t->s, t->cap);
+        if (!t->s) fail("out of memory");
+    }
+}
+
+typedef enum { PROF_MIXED, PROF_NUMBERS, PROF_ESCAPED, PROF_KOREAN, PROF_UTF8MIX } profile_t;
+
+/** Bytes of a generated string value of `slen` characters. */
+static int str_bytes(int slen, profile_t prof)
+{
+    return prof == PROF_KOREAN ? 3 * slen : prof == PROF_UTF8MIX ? slen / 2 * 3 + (slen + 1) / 2 : slen;
+}
+
+/**
+ * @brief Generate a flat object with `nkeys` members.
+ *
+ * Mixed profile: every 4th member is a string of `slen` bytes, the rest
+ * are INT32. Numbers profile (telemetry): INT32, FLOAT32, FLOAT64, FIX16
+ * in turn. Escaped profile: mixed, with every 16th string byte written
+ * as a JSON escape (\\n, \\", \\u0041), the encoders' decoding path.
+ * Korean and UTF-8 mix profiles: mixed, with `slen` Hangul syllables
+ * (3 bytes each) or alternating ASCII/Hangul characters per string; the
+ * STR_N prefix fits the bytes, so byte and code-point limits both hold.
+ * Key i is named "<PREFIX>K<i>" and INT32 key i holds i * 7 - 3, which
+ * the lookup benches check.
+ *
+ * @param t[out] Text (t->n reset first).
+ * @param nkeys Members.
+ * @param slen String value size (mixed profile).
+ * @param pretty 1 for newline + 4-space indent layout, 0 for compact.
+ * @param prof Value profile.
+ */
+static void gen_doc(text_t* t, int nkeys, int slen, int pretty, profile_t prof)
+{
+    const char* sep = pretty ? ",\n    " : ",";
+    t->n = 0;
+    tx_put(t, pretty ? "{\n    " : "{");
+    for (int i = 0; i < nkeys; i++) {
+        if (i) tx_put(t, "%s", sep);
+        int kind = prof == PROF_NUMBERS ? 4 + i % 4 : (i % 4 == 3);
+        switch (kind) {
+        case 0: case 4: tx_put(t, "\"INT32_K%d\"%s%d", i, pretty ? ": " : ":", i * 7 - 3); break;
+        case 1: {
+            int nb = str_bytes(slen, prof);
+            const char* pfx = nb <= 32 ? "STR_32_" : nb <= 64 ? "STR_64_" : nb <= 128 ? "STR_128_" : "STR_256_";
+            tx_put(t, "\"%sK%d\"%s\"", pfx, i, pretty ? ": " : ":");
+            for (int k = 0; k < slen; k++) {
+                if (prof == PROF_ESCAPED && k % 16 == 15) tx_put(t, "%s", (const char*[]){ "\\n", "\\\"", "\\u0041" }[k / 16 % 3]);
+                else if (prof == PROF_KOREAN || (prof == PROF_UTF8MIX && k % 2)) {
+                    unsigned cp = 0xAC00 + (unsigned)(i * 31 + k * 7) % 11172;   // 가..힣
+                    tx_put(t, "%c%c%c", 0xE0 | cp >> 12, 0x80 | (cp >> 6 & 0x3F), 0x80 | (cp & 0x3F));
+                }
+                else tx_put(t, "%c", 'a' + (i + k) % 26);
+            }
+            tx_put(t, "\"");
+            break;
+        }
+        case 5: tx_put(t, "\"FLOAT32_K%d\"%s%d.%03d", i, pretty ? ": " : ":", i % 100, (i * 37) % 1000); break;
+        case 6: tx_put(t, "\"FLOAT64_K%d\"%s-%d.%06de-3", i, pretty ? ": " : ":", i, (i * 7919) % 1000000); break;
+        case 7: tx_put(t, "\"FIX16_2_K%d\"%s%d.%02d", i, pretty ? ": " : ":", i % 300, i % 100); break;
+        }
+    }
+    tx_put(t, pretty ? "\n}\n" : "}");
+}
+
+/**
+ * @brief Generate an array of `n` small device records (nested shape).
+ *
+ * {"devs":[{"INT32_id":i,"STR_32_name":"dev-i","FLOAT32_temp":..,
+ * "ARR_INT16_samples":[..4..]}, ...]}
+ */
+static void gen_nested(text_t* t, int n)
+{
+    t->n = 0;
+    tx_put(t, "{\"devs\":[");
+    for (int i = 0; i < n; i++)
+        tx_put(t, "%s{\"INT32_id\":%d,\"STR_32_name\":\"dev-%d\",\"FLOAT32_temp\":%d.%d,\"ARR_INT16_samples\":[%d,%d,%d,%d]}",
+               i ? "," : "", i, i, 20 + i % 15, i % 10, i % 100, -(i % 50), i * 3 % 1000, 7);
+    tx_put(t, "]}");
+}
+
+/**
+ * @brief Generate a fleet config: `n` device records sharing a few values.
+ *
+ * The shape of the provisioning documents pushed to gateways: every
+ * record has a unique host name and id, and takes its owner, model,
+ * region, firmware, broker URL, Wi-Fi SSID and CA path from small
+ * pools (7, 4, 5, 3, 5, 6 and 1 values), as fleet inventories do.
+ */
+static void gen_fleet(text_t* t, int n)
+{
+    static const char* owner[] = { "owner-1f3a9c21", "owner-7be04d17", "owner-c29e61aa", "owner-0d4f8b3e",
+                                   "owner-95a7c2f0", "owner-e6113b5d", "owner-4c8d0e92" };
+    static const char* model[] = { "ESP32-S3-DevKitC-1", "ESP32-C3-MINI-1", "ESP32-S3-WROOM-1U", "ESP32-C6-WROOM-1" };
+    static const char* region[] = { "eu-west-1", "us-east-1", "ap-northeast-2", "eu-central-1", "us-west-2" };
+    static const char* fw[] = { "2.4.17-release", "2.5.0-rc3", "2.4.16-release" };
+    static const char* ssid[] = { "fleet-iot-5g", "fleet-iot-2g", "plant-floor-a", "plant-floor-b", "warehouse-north", "lab" };
+    t->n = 0;
+    tx_put(t, "{\"STR_64_ntp\":\"pool.ntp.fleet.example.org\",\"devices\":[");
+    for (int i = 0; i < n; i++) {
+        const char* rg = region[i % 5];
+        tx_put(t, "%s{\"INT32_id\":%d,\"STR_64_host\":\"gw-%s-%04d.fleet.example.net\",\"STR_32_owner\":\"%s\","
+                  "\"STR_32_model\":\"%s\",\"STR_32_region\":\"%s\",\"STR_32_fw\":\"%s\","
+                  "\"STR_64_mqtt\":\"mqtts://broker.%s.fleet.example.net:8883\",\"BOOL_ota\":%s,"
+                  "\"net\":{\"STR_32_ssid\":\"%s\",\"STR_64_ca\":\"/spiffs/certs/fleet-root-ca-2024.pem\",\"UINT16_port\":8883}}",
+               i ? "," : "", 1000 + i, rg, i, owner[i * 3 % 7], model[i % 4], rg, fw[i % 7 % 3], rg, i % 3 ? "true" : "false",
+               ssid[i % 6]);
+    }
+    tx_put(t, "]}");
+}
+
+/* ---------------------------------------------------------------------- */
+/* encode                                                                  */
+
+static void* std_alloc(size_t n, void* user) { (void)user; return malloc(n); }
+static void  std_free(void* p, void* user) { (void)user; free(p); }
+
+/* Counting heap for bench_startup: bytes live and the peak since the last reset. */
+static size_t g_heap_live, g_heap_peak;
+
+static void* cnt_alloc(size_t n, void* user)
+{
+    (void)user;
+    size_t* p = malloc(n + 16);   // size header, keeps 16-byte alignment
+    if (!p) return NULL;
+    p[0] = n;
+    g_heap_live += n;
+    if (g_heap_live > g_heap_peak) g_heap_peak = g_heap_live;
+    return (char*)p + 16;
+}
+
+static void cnt_free(void* q, void* user)
+{
+    (void)user;
+    if (!q) return;
+    size_t* p = (size_t*)((char*)q - 16);
+    g_heap_live -= p[0];
+    free(p);
+}
+
+/** Encode with the chunked encoder, fed in 512-byte pieces like app_main. */
+static bjson_err_t enc_stream(const char* json, size_t n, uint32_t flags, uint8_t* out, size_t cap, size_t* len)
+{
+    bjson_enc_stream_t st;
+    bjson_enc_opts_t opts = { .flags = flags };
+    bjson_err_t rc = bjson_enc_begin(&st, &opts, out, cap);
+    for (size_t i = 0; rc == BJSON_OK && i < n; i += 512)
+        rc = bjson_enc_feed(&st, json + i, n - i < 512 ? n - i : 512);
+    return rc == BJSON_OK ? bjson_enc_end(&st, len) : rc;
+}
+
+/**
+ * @brief Encode one document with the AST, direct and stream encoders.
+ *
+ * All three must produce the same bytes; then each is timed. Reports
+ * MB/s of JSON input, bytes per entry and the AST arena high-water mark.
+ */
+static void bench_encode(const char* doc_name, const text_t* t, int nkeys, int slen, int pretty, uint32_t flags)
+{
+    size_t cap = t->n * 4 + 4096, lens[3];
+    uint8_t* out[3];
+    bjson_alloc_t al = { std_alloc, std_free, NULL, 0 };
+    bjson_enc_ctx_t ctx;
+    bjson_enc_ctx_init(&ctx, NULL, 0, &al);
+    bjson_enc_opts_t ast = { .flags = flags }, direct = { .flags = flags | BJSON_ENC_F_DIRECT };
+
+    for (int m = 0; m < 3; m++) if (!(out[m] = malloc(cap))) fail("out of memory");
+    if (bjson_encode_ctx(&ctx, t->s, &ast, out[0], cap, &lens[0]) != BJSON_OK) fail("%s: ast encode", doc_name);
+    if (bjson_encode_ctx(&ctx, t->s, &direct, out[1], cap, &lens[1]) != BJSON_OK) fail("%s: direct encode", doc_name);
+    if (enc_stream(t->s, t->n, flags, out[2], cap, &lens[2]) != BJSON_OK) fail("%s: stream encode", doc_name);
+    for (int m = 1; m < 3; m++)
+        if (lens[m] != lens[0] || memcmp(out[m], out[0], lens[0]) != 0) fail("%s: encoder %d output differs", doc_name, m);
+
+    static const char* mode[3] = { "ast", "direct", "stream" };
+    for (int m = 0; m < 3; m++) {
+        size_t iters = 0, len = 0;
+        double t0 = now_s(), el;
+        do {
+            bjson_err_t rc = m == 2 ? enc_stream(t->s, t->n, flags, out[m], cap, &len)
+                                    : bjson_encode_ctx(&ctx, t->s, m ? &direct : &ast, out[m], cap, &len);
+            if (rc != BJSON_OK) fail("%s: %s encode in loop", doc_name, mode[m]);
+            g_sink += len;
+            iters++;
+        } while ((el = now_s() - t0) < g_min_s);
+        row_begin("encode");
+        fprintf(g_out, ", \"doc\": \"%s\", \"mode\": \"%s\", \"keys\": %d, \"str_len\": %d, \"pretty\": %d, \"flags\": %" PRIu32,
+                doc_name, mode[m], nkeys, slen, pretty, flags);
+        fprintf(g_out, ", \"json_bytes\": %zu, \"bjson_bytes\": %zu, \"bytes_per_entry\": %.2f, \"mb_s\": %.1f, \"arena_peak\": %zu",
+                t->n, lens[0], (double)lens[0] / nkeys, (double)t->n * (double)iters / el / 1e6, m ? (size_t)0 : ctx.high_water);
+        row_end();
+    }
+    for (int m = 0; m < 3; m++) free(out[m]);
+    bjson_enc_ctx_release(&ctx);
+}
+
+/* ---------------------------------------------------------------------- */
+/* to_json                                                                 */
+
+static int sink_count(const char* p, size_t n, void* user) { (void)p; *(size_t*)user += n; return 0; }
+
+/**
+ * @brief Time bjd_to_json (buffer and sink) on one document.
+ *
+ * Checked first: the size-only length matches the written length, and
+ * the JSON text encodes back to the same BJSON bytes. MB/s counts JSON
+ * output.
+ */
+static void bench_to_json(const char* doc_name, const text_t* t, int nkeys, int slen)
+{
+    size_t cap = t->n * 4 + 4096, len, jlen, slen_only, blen;
+    uint8_t* bin = malloc(cap);
+    uint8_t* back = malloc(cap);
+    char* json = malloc(cap);
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT };
+    if (!bin || !back || !json || bjson_encode_from_json_ex(t->s, &opts, bin, cap, &len) != BJSON_OK) fail("%s: to_json encode", doc_name);
+    bjd_doc_t doc;
+    if (bjd_open(bin, len, &doc) != BJD_OK || bjd_validate(&doc) != BJD_OK) fail("%s: to_json open", doc_name);
+    if (bjd_to_json(&doc, NULL, 0, &slen_only) != BJD_EBUF) fail("%s: to_json size only", doc_name);
+    if (bjd_to_json(&doc, json, cap - 1, &jlen) != BJD_OK || jlen != slen_only) fail("%s: to_json length", doc_name);
+    json[jlen] = '\0';
+    if (bjson_encode_from_json_ex(json, &opts, back, cap, &blen) != BJSON_OK || blen != len || memcmp(back, bin, len) != 0)
+        fail("%s: to_json round trip", doc_name);
+
+    double mb[2];
+    for (int cb = 0; cb < 2; cb++) {
+        size_t bytes = 0;
+        double t0 = now_s(), el;
+        do {
+            size_t n = 0;
+            bjd_err_t rc = cb ? bjd_to_json_cb(&doc, sink_count, &n, NULL) : bjd_to_json(&doc, json, cap, &n);
+            if (rc != BJD_OK || n != jlen) fail("%s: to_json in loop", doc_name);
+            bytes += n;
+        } while ((el = now_s() - t0) < g_min_s);
+        mb[cb] = (double)bytes / el / 1e6;
+    }
+    row_begin("to_json");
+    fprintf(g_out, ", \"doc\": \"%s\", \"keys\": %d, \"str_len\": %d, \"json_bytes\": %zu, \"buffer_mb_s\": %.1f, \"sink_mb_s\": %.1f",
+            doc_name, nkeys, slen, jlen, mb[0], mb[1]);
+    row_end();
+    free(bin); free(back); free(json);
+}
+
+/* ---------------------------------------------------------------------- */
+/* lookup                                                                  */
+
+/**
+ * @brief Time bjd_find hits and misses on one document.
+ *
+ * Keys are probed in a scrambled order so the linear walk does not get a
+ * cache-friendly sequence. Each hit is checked against the generated value.
+ */
+static void bench_lookup(const bjd_doc_t* doc, int nkeys, char (*names)[24], char (*miss)[24], const char* variant)
+{
+    for (int i = 0; i < nkeys; i++) {
+        int32_t v;
+        if (i % 4 != 3 && (bjd_get_i32(doc, names[i], &v) != 0 || v != i * 7 - 3)) fail("lookup %s: %s", variant, names[i]);
+        bjd_entry_t e;
+        if (bjd_find(doc, miss[i % LOOKUP_KEYS], &e) >= 0) fail("lookup %s: miss %s found", variant, miss[i % LOOKUP_KEYS]);
+    }
+    double ns[2];
+    for (int hit = 1; hit >= 0; hit--) {
+        size_t probes = 0;
+        double t0 = now_s(), el;
+        do {
+            bjd_entry_t e;
+            for (int k = 0; k < LOOKUP_KEYS; k++) {
+                const char* key = hit ? names[(k * 7919) % nkeys] : miss[k];
+                g_sink += (uint64_t)bjd_find(doc, key, &e);
+            }
+            probes += LOOKUP_KEYS;
+        } while ((el = now_s() - t0) < g_min_s);
+        ns[hit] = el * 1e9 / (double)probes;
+    }
+    row_begin("lookup");
+    fprintf(g_out, ", \"variant\": \"%s\", \"keys\": %d, \"hit_ns\": %.1f, \"miss_ns\": %.1f", variant, nkeys, ns[1], ns[0]);
+    row_end();
+}
+
+/** Lookups at one key count: linear vs index, checked vs trusted (bjd_validate). */
+static void bench_lookups(int nkeys)
+{
+    static char names[1000][24], miss[LOOKUP_KEYS][24];
+    text_t t = {0};
+    gen_doc(&t, nkeys, 16, 0, PROF_MIXED);
+    for (int i = 0; i < nkeys; i++)
+        snprintf(names[i], sizeof(names[i]), "%sK%d", i % 4 == 3 ? "STR_32_" : "INT32_", i);
+    for (int k = 0; k < LOOKUP_KEYS; k++) snprintf(miss[k], sizeof(miss[k]), "INT32_M%d", k);
+
+    for (int idx = 0; idx < 2; idx++) {
+        size_t cap = t.n * 4 + 4096, len;
+        uint8_t* buf = malloc(cap);
+        bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | (idx ? BJSON_ENC_F_INDEX : 0) };
+        bjson_err_t rc = buf ? bjson_encode_from_json_ex(t.s, &opts, buf, cap, &len) : BJSON_ENOMEM;
+        if (rc != BJSON_OK) fail("lookup doc encode: %d", rc);
+        bjd_doc_t doc;
+        if (bjd_open(buf, len, &doc) != BJD_OK) fail("lookup doc open");
+        bench_lookup(&doc, nkeys, names, miss, idx ? "index" : "linear");
+        if (bjd_validate(&doc) != BJD_OK) fail("lookup doc validate");
+        bench_lookup(&doc, nkeys, names, miss, idx ? "index_trusted" : "linear_trusted");
+        free(buf);
+    }
+    free(t.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* paged                                                                   */
+
+#define PAGED_PROBES 256   // paged lookups per timed round
+
+/** bjd_read_fn over a file descriptor (the host stand-in for SPIFFS / a partition). */
+static int paged_read(void* user, uint32_t off, void* dst, size_t n)
+{
+    return pread(*(int*)user, dst, n, (off_t)off) == (ssize_t)n ? 0 : -1;
+}
+
+/**
+ * @brief bjd_open_paged lookups from a file at several cache sizes.
+ *
+ * The document is written to a temporary file and read back only
+ * through pread. Every INT32 key is checked against the generated value
+ * and every string against the in-memory document first; then hits in a
+ * scrambled order are timed on a warm cache. "reads" counts read
+ * callbacks per lookup, "hit_pct" cache accesses served without one,
+ * "memory_ns" the same lookup with the whole document in RAM.
+ */
+static void bench_paged(int nkeys, int idx)
+{
+    static uint8_t mem[BJD_PAGE_SLOTS_MAX * 4096] __attribute__((aligned(8)));
+    static const uint32_t blocks[] = { 512, 4096 };
+    static const uint32_t nblk[] = { 1, 4, 16, 32 };
+    static char names[10000][24];
+    text_t t = {0};
+    gen_doc(&t, nkeys, 16, 0, PROF_MIXED);
+    for (int i = 0; i < nkeys; i++)
+        snprintf(names[i], sizeof(names[i]), "%sK%d", i % 4 == 3 ? "STR_32_" : "INT32_", i);
+    size_t cap = t.n * 4 + 4096, len;
+    uint8_t* buf = malloc(cap);
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | (idx ? BJSON_ENC_F_INDEX : 0) };
+    bjd_doc_t doc;
+    if (!buf || bjson_encode_from_json_ex(t.s, &opts, buf, cap, &len) != BJSON_OK || bjd_open(buf, len, &doc) != BJD_OK)
+        fail("paged doc encode");
+    FILE* f = tmpfile();
+    int fd = f ? fileno(f) : -1;
+    if (fd < 0 || fwrite(buf, 1, len, f) != len || fflush(f) != 0) fail("paged doc write");
+
+    double mem_ns;
+    {
+        size_t probes = 0;
+        double t0 = now_s(), el;
+        do {
+            bjd_entry_t e;
+            for (int k = 0; k < PAGED_PROBES; k++) g_sink += (uint64_t)bjd_find(&doc, names[(k * 7919) % nkeys], &e);
+            probes += PAGED_PROBES;
+        } while ((el = now_s() - t0) < g_min_s);
+        mem_ns = el * 1e9 / (double)probes;
+    }
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++)
+        for (size_t n = 0; n < sizeof(nblk) / sizeof(nblk[0]); n++) {
+            bjd_pcache_t c;
+            bjd_pdoc_t pd;
+            if (bjd_pcache_init(&c, paged_read, &fd, mem, (size_t)blocks[b] * nblk[n], blocks[b]) != BJD_OK ||
+                bjd_open_paged(&c, len, &pd) != BJD_OK) fail("paged open");
+            for (int i = 0; i < nkeys; i++) {
+                int32_t v;
+                bjd_pin_t s;
+                const char* ms;
+                uint32_t mn;
+                if (i % 4 != 3) {
+                    if (bjd_pg_get_i32(&pd, names[i], &v) != 0 || v != i * 7 - 3) fail("paged: %s", names[i]);
+                } else if (bjd_pg_get_str(&pd, names[i], &s) != 0 || bjd_get_str(&doc, names[i], &ms, &mn) != 0 ||
+                           s.n != mn || memcmp(s.p, ms, mn) != 0) fail("paged: %s", names[i]);
+                else bjd_pg_unpin(&c, &s);
+            }
+            size_t probes = 0;
+            c.reads = c.hits = 0; c.read_bytes = 0;
+            double t0 = now_s(), el;
+            do {
+                bjd_pentry_t e;
+                for (int k = 0; k < PAGED_PROBES; k++)
+                    if (bjd_pg_find(&pd, names[(k * 7919) % nkeys], &e) < 0) fail("paged: lookup in loop");
+                probes += PAGED_PROBES;
+            } while ((el = now_s() - t0) < g_min_s);
+            row_begin("paged");
+            fprintf(g_out, ", \"variant\": \"%s\", \"keys\": %d, \"doc_bytes\": %zu, \"block\": %u, \"blocks\": %u, \"cache_bytes\": %u"
+                    ", \"reads\": %.2f, \"read_kb\": %.2f, \"hit_pct\": %.1f, \"lookup_ns\": %.0f, \"memory_ns\": %.1f",
+                    idx ? "index" : "linear", nkeys, len, blocks[b], c.nslots, blocks[b] * c.nslots,
+                    (double)c.reads / (double)probes, (double)c.read_bytes / 1024.0 / (double)probes,
+                    100.0 * (double)c.hits / (double)(c.hits + c.reads), el * 1e9 / (double)probes, mem_ns);
+            row_end();
+        }
+    fclose(f);
+    free(buf);
+    free(t.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* startup                                                                 */
+
+/**
+ * @brief Time document bring-up: JSON text vs mapped precompiled image.
+ *
+ * "encode" reads the JSON file, encodes it into a heap buffer sized for
+ * the image and validates it; "mapped" runs bjd_open_mapped on the
+ * bjsonc-style image. Both end with the same validated, trusted
+ * document. The encode path allocates through a counting allocator (text
+ * buffer, image buffer, encoder arena): "encode_heap_peak" is the most
+ * it held at once, "encode_heap_kept" what stays while the document is
+ * open. bjd_open_mapped allocates nothing (the image stays in flash, or
+ * the page cache on the host), so it has no heap field.
+ */
+static void bench_startup(int nkeys)
+{
+    char jpath[] = "/tmp/bjson_bench_XXXXXX", ipath[] = "/tmp/bjson_bench_XXXXXX";
+    int jfd = mkstemp(jpath), ifd = mkstemp(ipath);
+    if (jfd < 0 || ifd < 0) fail("mkstemp");
+    text_t t = {0};
+    gen_doc(&t, nkeys, 64, 1, PROF_MIXED);
+    size_t cap = t.n * 4 + 4096, len;
+    uint8_t* img = malloc(cap);
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC };
+    if (!img || bjson_encode_from_json_ex(t.s, &opts, img, cap, &len) != BJSON_OK) fail("startup encode");
+    if (write(jfd, t.s, t.n) != (ssize_t)t.n || write(ifd, img, len) != (ssize_t)len) fail("startup write");
+    close(jfd); close(ifd);
+
+    double us[2];
+    size_t kept = 0;
+    bjson_alloc_t al = { cnt_alloc, cnt_free, NULL, 0 };
+    g_heap_peak = g_heap_live;
+    size_t heap0 = g_heap_live;
+    for (int mapped = 0; mapped < 2; mapped++) {
+        size_t iters = 0;
+        double t0 = now_s(), el;
+        do {
+            bjd_doc_t doc;
+            if (mapped) {
+                bjd_map_t m;
+                if (bjd_open_mapped(ipath, 1, NULL, &m) != BJD_OK) fail("startup mapped open");
+                g_sink += m.doc.count;
+                bjd_close_mapped(&m);
+            } else {
+                FILE* fp = fopen(jpath, "rb");
+                char* json = cnt_alloc(t.n + 1, NULL);
+                uint8_t* bin = cnt_alloc(len, NULL);
+                size_t n = fp && json ? fread(json, 1, t.n, fp) : 0, blen;
+                if (fp) fclose(fp);
+                if (!bin || n != t.n) fail("startup read");
+                json[n] = '\0';
+                bjson_enc_ctx_t ctx;
+                bjson_enc_ctx_init(&ctx, NULL, 0, &al);
+                bjson_err_t rc = bjson_encode_ctx(&ctx, json, &opts, bin, len, &blen);
+                bjson_enc_ctx_release(&ctx);
+                cnt_free(json, NULL);
+                if (rc != BJSON_OK || bjd_open(bin, blen, &doc) != BJD_OK || bjd_validate(&doc) != BJD_OK) fail("startup encode path");
+                kept = g_heap_live - heap0;
+                g_sink += doc.count;
+                cnt_free(bin, NULL);
+            }
+            iters++;
+        } while ((el = now_s() - t0) < g_min_s);
+        us[mapped] = el * 1e6 / (double)iters;
+    }
+    row_begin("startup");
+    fprintf(g_out, ", \"keys\": %d, \"json_bytes\": %zu, \"image_bytes\": %zu, \"encode_us\": %.1f, \"encode_heap_peak\": %zu, \"encode_heap_kept\": %zu, \"mapped_us\": %.1f",
+            nkeys, t.n, len, us[0], g_heap_peak - heap0, kept, us[1]);
+    row_end();
+    unlink(jpath); unlink(ipath);
+    free(img); free(t.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* patch                                                                   */
+
+/**
+ * @brief Time a two-value config update: in-place patch vs re-encode.
+ *
+ * The image is encoded with BJSON_ENC_F_RESERVE (+ index and CRC), so a
+ * string can grow to its STR_N limit. "patch" is bjd_set_i32 + bjd_set_str
+ * on the live buffer (CRC trailer included); "reencode" regenerates the
+ * image from JSON text. "bytes_changed" counts bytes that differ after one
+ * patch, i.e. what a persisted image would have to rewrite.
+ */
+static void bench_patch(int nkeys)
+{
+    text_t t = {0};
+    gen_doc(&t, nkeys, 8, 0, PROF_MIXED);
+    size_t cap = t.n * 8 + 4096, len, plain;
+    uint8_t* img = malloc(cap);
+    uint8_t* ref = malloc(cap);
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC };
+    if (!img || !ref || bjson_encode_from_json_ex(t.s, &opts, img, cap, &plain) != BJSON_OK) fail("patch encode");
+    opts.flags |= BJSON_ENC_F_RESERVE;
+    if (bjson_encode_from_json_ex(t.s, &opts, img, cap, &len) != BJSON_OK) fail("patch encode reserve");
+    memcpy(ref, img, len);
+
+    static const char grown[] = "a-string-grown-to-the-cap-of-32b";   // 32 bytes: STR_32_ limit
+    bjd_doc_t doc;
+    int32_t v;
+    const char* s;
+    uint32_t sn;
+    if (bjd_open(img, len, &doc) != BJD_OK || bjd_set_i32(&doc, "INT32_K0", 4242) != 0 ||
+        bjd_set_str(&doc, "STR_32_K3", grown, 32) != 0 || bjd_validate(&doc) != BJD_OK ||
+        bjd_get_i32(&doc, "INT32_K0", &v) != 0 || v != 4242 ||
+        bjd_get_str(&doc, "STR_32_K3", &s, &sn) != 0 || sn != 32 || memcmp(s, grown, 32) != 0) fail("patch check");
+    size_t changed = 0;
+    for (size_t i = 0; i < len; i++) changed += img[i] != ref[i];
+
+    double us[2];
+    for (int re = 0; re < 2; re++) {
+        size_t iters = 0;
+        double t0 = now_s(), el;
+        do {
+            if (re) {
+                size_t n;
+                if (bjson_encode_from_json_ex(t.s, &opts, ref, cap, &n) != BJSON_OK) fail("patch reencode");
+                g_sink += n;
+            } else if (bjd_set_i32(&doc, "INT32_K0", (int32_t)(iters & 0xFFFF)) != 0 ||
+                       bjd_set_str(&doc, "STR_32_K3", grown, 8 + iters % 25) != 0) fail("patch in loop");
+            iters++;
+        } while ((el = now_s() - t0) < g_min_s);
+        us[re] = el * 1e6 / (double)iters;
+    }
+    row_begin("patch");
+    fprintf(g_out, ", \"keys\": %d, \"image_bytes\": %zu, \"reserve_bytes\": %zu, \"bytes_changed\": %zu, \"patch_us\": %.2f, \"reencode_us\": %.1f",
+            nkeys, len, len - plain, changed, us[0], us[1]);
+    row_end();
+    free(img); free(ref); free(t.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* delta                                                                   */
+
+/**
+ * @brief Time bjson_diff / bjson_patch for a one-setting config change.
+ *
+ * The new document differs from the old one in one integer value. The
+ * patch must rebuild the new image byte for byte; "patch_bytes" is what
+ * an incremental sync sends instead of "image_bytes", "insert_patch_bytes"
+ * the same for one key inserted near the front instead.
+ */
+static void bench_delta(int nkeys)
+{
+    text_t t = {0};
+    gen_doc(&t, nkeys, 16, 0, PROF_MIXED);
+    size_t cap = t.n * 4 + 4096, olen, nlen, plen, alen;
+    uint8_t* img[6];   // old, new, patch, applied, inserted, insert patch
+    for (int i = 0; i < 6; i++) if (!(img[i] = malloc(cap))) fail("delta alloc");
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC };
+    if (bjson_encode_from_json_ex(t.s, &opts, img[0], cap, &olen) != BJSON_OK) fail("delta encode old");
+    char* v = strstr(t.s, "\"INT32_K0\":");   // -3 -> -4
+    if (!v) fail("delta key");
+    v[strlen("\"INT32_K0\":-")] = '4';
+    if (bjson_encode_from_json_ex(t.s, &opts, img[1], cap, &nlen) != BJSON_OK) fail("delta encode new");
+    bjd_doc_t od, nd, pd;
+    if (bjd_open(img[0], olen, &od) != BJD_OK || bjd_open(img[1], nlen, &nd) != BJD_OK ||
+        bjson_diff(&od, &nd, img[2], cap, &plen) != BJSON_OK || bjd_open(img[2], plen, &pd) != BJD_OK ||
+        bjd_validate(&pd) != BJD_OK || bjson_patch(&od, &pd, img[3], cap, &alen) != BJSON_OK ||
+        alen != nlen || memcmp(img[3], img[1], nlen) != 0) fail("delta check");
+    text_t ins = {0};
+    const char* k1 = strchr(t.s, ',');   // after the first key
+    if (!k1) fail("delta insert");
+    tx_put(&ins, "%.*s,\"INT32_NEW\":1%s", (int)(k1 - t.s), t.s, k1);
+    size_t ilen, inlen;
+    bjd_doc_t id, ipd;
+    if (bjson_encode_from_json_ex(ins.s, &opts, img[4], cap, &inlen) != BJSON_OK || bjd_open(img[4], inlen, &id) != BJD_OK ||
+        bjson_diff(&nd, &id, img[5], cap, &ilen) != BJSON_OK || bjd_open(img[5], ilen, &ipd) != BJD_OK ||
+        bjson_patch(&nd, &ipd, img[3], cap, &alen) != BJSON_OK || alen != inlen || memcmp(img[3], img[4], inlen) != 0) fail("delta insert check");
+    free(ins.s);
+
+    double us[2];
+    for (int apply = 0; apply < 2; apply++) {
+        size_t iters = 0, n;
+        double t0 = now_s(), el;
+        do {
+            bjson_err_t rc = apply ? bjson_patch(&od, &pd, img[3], cap, &n) : bjson_diff(&od, &nd, img[2], cap, &n);
+            if (rc != BJSON_OK) fail("delta in loop");
+            g_sink += n;
+            iters++;
+        } while ((el = now_s() - t0) < g_min_s);
+        us[apply] = el * 1e6 / (double)iters;
+    }
+    row_begin("delta");
+    fprintf(g_out, ", \"keys\": %d, \"image_bytes\": %zu, \"patch_bytes\": %zu, \"insert_patch_bytes\": %zu, \"diff_us\": %.1f, \"apply_us\": %.1f",
+            nkeys, nlen, plen, ilen, us[0], us[1]);
+    row_end();
+    for (int i = 0; i < 6; i++) free(img[i]);
+    free(t.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* key dictionary                                                          */
+
+static int cmp_name(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/**
+ * @brief Key-ID document (BJD_F_DICT) against the plain one.
+ *
+ * The dictionary lists every generated key. Both documents must read
+ * back as the same JSON and return the generated values; the timed
+ * lookups use pre-resolved handles (bjd_key_init vs bjd_key_init_dict),
+ * i.e. a name compare against a 3-byte key-ID compare.
+ */
+static void bench_dict(int nkeys)
+{
+    static char names[1000][24];
+    static const char* sorted[1000];
+    static bjd_key_t kplain[1000], kdict[1000];
+    text_t t = {0};
+    gen_doc(&t, nkeys, 16, 0, PROF_MIXED);
+    for (int i = 0; i < nkeys; i++) {
+        snprintf(names[i], sizeof(names[i]), "%sK%d", i % 4 == 3 ? "STR_32_" : "INT32_", i);
+        sorted[i] = names[i];
+    }
+    qsort(sorted, (size_t)nkeys, sizeof(sorted[0]), cmp_name);
+    bjd_dict_t dict;
+    if (bjd_dict_init(&dict, sorted, (uint16_t)nkeys) != 0) fail("dict init");
+
+    size_t cap = t.n * 4 + 4096, len[2], jlen[2];
+    uint8_t* img[2];
+    char* js[2];
+    bjd_doc_t doc[2];
+    for (int d = 0; d < 2; d++) {
+        bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT, .dict = d ? &dict : NULL };
+        if (!(img[d] = malloc(cap)) || !(js[d] = malloc(t.n + 64))) fail("dict alloc");
+        if (bjson_encode_from_json_ex(t.s, &opts, img[d], cap, &len[d]) != BJSON_OK || bjd_open(img[d], len[d], &doc[d]) != BJD_OK ||
+            (d && bjd_use_dict(&doc[d], &dict) != BJD_OK) || bjd_validate(&doc[d]) != BJD_OK) fail("dict doc %d", d);
+        if (bjd_to_json(&doc[d], js[d], t.n + 64, &jlen[d]) != BJD_OK) fail("dict to_json %d", d);
+    }
+    if (jlen[0] != jlen[1] || memcmp(js[0], js[1], jlen[0]) != 0) fail("dict doc reads back differently");
+    for (int i = 0; i < nkeys; i++) {
+        bjd_entry_t e;
+        int32_t v;
+        bjd_key_init(&kplain[i], names[i]);
+        bjd_key_init_dict(&kdict[i], &dict, names[i]);
+        if (bjd_find_key(&doc[1], &kdict[i], &e) != i) fail("dict key %s", names[i]);
+        if (i % 4 != 3 && (bjd_get_i32(&doc[1], names[i], &v) != 0 || v != i * 7 - 3)) fail("dict value %s", names[i]);
+    }
+    double ns[2];
+    for (int d = 0; d < 2; d++) {
+        size_t probes = 0;
+        double t0 = now_s(), el;
+        do {
+            bjd_entry_t e;
+            for (int k = 0; k < LOOKUP_KEYS; k++) {
+                int i = (k * 7919) % nkeys;
+                g_sink += (uint64_t)bjd_find_key(&doc[d], d ? &kdict[i] : &kplain[i], &e);
+            }
+            probes += LOOKUP_KEYS;
+        } while ((el = now_s() - t0) < g_min_s);
+        ns[d] = el * 1e9 / (double)probes;
+    }
+    row_begin("dict");
+    fprintf(g_out, ", \"keys\": %d, \"plain_bytes\": %zu, \"dict_bytes\": %zu, \"plain_key_ns\": %.1f, \"dict_key_ns\": %.1f",
+            nkeys, len[0], len[1], ns[0], ns[1]);
+    row_end();
+    for (int d = 0; d < 2; d++) { free(img[d]); free(js[d]); }
+    free(t.s);
+}
+
+/**
+ * @brief Compact profile (BJD_F_COMPACT) against the aligned one.
+ *
+ * The aligned image carries a CRC trailer, which the compact image
+ * keeps. Checked first: the compact document reads back as the same
+ * JSON and bjson_expand rebuilds the aligned image byte for byte. MB/s
+ * counts aligned bytes in both directions. `nkeys` is the member count
+ * (records for the nested shape).
+ */
+static void bench_compact(const char* doc_name, const text_t* t, int nkeys, int slen)
+{
+    size_t cap = t->n * 4 + 4096, alen, zlen, xlen, j[2];
+    uint8_t* img = malloc(cap);
+    uint8_t* z = malloc(cap);
+    uint8_t* x = malloc(cap);
+    char* js[2] = { malloc(t->n + 64), malloc(t->n + 64) };
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | BJSON_ENC_F_CRC };
+    bjd_doc_t doc, zdoc;
+    if (!img || !z || !x || !js[0] || !js[1]) fail("compact alloc");
+    if (bjson_encode_from_json_ex(t->s, &opts, img, cap, &alen) != BJSON_OK || bjd_open(img, alen, &doc) != BJD_OK ||
+        bjd_validate(&doc) != BJD_OK) fail("%s: compact source", doc_name);
+    if (bjson_compact(&doc, z, alen, &zlen) != BJSON_OK || bjd_open(z, zlen, &zdoc) != BJD_OK || bjd_validate(&zdoc) != BJD_OK)
+        fail("%s: compact", doc_name);
+    if (bjd_to_json(&doc, js[0], t->n + 64, &j[0]) != BJD_OK || bjd_to_json(&zdoc, js[1], t->n + 64, &j[1]) != BJD_OK ||
+        j[0] != j[1] || memcmp(js[0], js[1], j[0]) != 0) fail("%s: compact doc reads back differently", doc_name);
+    if (bjson_expand(&zdoc, BJSON_ENC_F_CRC, x, cap, &xlen) != BJSON_OK || xlen != alen || memcmp(x, img, alen) != 0)
+        fail("%s: expand differs", doc_name);
+
+    double mb[2];
+    for (int dir = 0; dir < 2; dir++) {
+        size_t bytes = 0, n;
+        double t0 = now_s(), el;
+        do {
+            bjson_err_t rc = dir ? bjson_expand(&zdoc, BJSON_ENC_F_CRC, x, cap, &n) : bjson_compact(&doc, z, cap, &n);
+            if (rc != BJSON_OK) fail("%s: compact in loop", doc_name);
+            g_sink += n;
+            bytes += alen;
+        } while ((el = now_s() - t0) < g_min_s);
+        mb[dir] = (double)bytes / el / 1e6;
+    }
+    row_begin("compact");
+    fprintf(g_out, ", \"doc\": \"%s\", \"keys\": %d, \"str_len\": %d, \"aligned_bytes\": %zu, \"compact_bytes\": %zu"
+            ", \"saved_pct\": %.1f, \"compact_mb_s\": %.1f, \"expand_mb_s\": %.1f",
+            doc_name, nkeys, slen, alen, zlen, 100.0 * (double)(alen - zlen) / (double)alen, mb[0], mb[1]);
+    row_end();
+    free(img); free(z); free(x); free(js[0]); free(js[1]);
+}
+
+/**
+ * @brief BJSON to and from CBOR / MessagePack against the JSON text route.
+ *
+ * Checked first: each binary form encodes back to the same BJSON bytes
+ * and its size-only call reports the written length. Into BJSON times
+ * bjson_encode_from_json_ex (direct), bjson_encode_from_cbor and
+ * bjson_encode_from_msgpack; out of BJSON bjd_to_json, bjd_to_cbor and
+ * bjd_to_msgpack. MB/s counts BJSON bytes in both directions, so the
+ * routes compare directly.
+ */
+static void bench_transcode(const char* doc_name, const text_t* t, int nkeys, int slen)
+{
+    static const char* op_name[6] = { "from_json", "from_cbor", "from_msgpack", "to_json", "to_cbor", "to_msgpack" };
+    size_t cap = t->n * 4 + 4096, len, blen, size[3];
+    uint8_t* bin = malloc(cap);
+    uint8_t* back = malloc(cap);
+    uint8_t* form[3] = { malloc(cap), malloc(cap), malloc(cap) };   // JSON, CBOR, MessagePack
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT };
+    bjd_doc_t doc;
+    if (!bin || !back || !form[0] || !form[1] || !form[2]) fail("transcode alloc");
+    if (bjson_encode_from_json_ex(t->s, &opts, bin, cap, &len) != BJSON_OK || bjd_open(bin, len, &doc) != BJD_OK)
+        fail("%s: transcode source", doc_name);
+    for (int f = 0; f < 3; f++) {
+        size_t only;
+        bjd_err_t rc = f == 0 ? bjd_to_json(&doc, (char*)form[0], cap - 1, &size[0])
+                     : f == 1 ? bjd_to_cbor(&doc, form[1], cap, &size[1]) : bjd_to_msgpack(&doc, form[2], cap, &size[2]);
+        bjd_err_t ro = f == 0 ? bjd_to_json(&doc, NULL, 0, &only)
+                     : f == 1 ? bjd_to_cbor(&doc, NULL, 0, &only) : bjd_to_msgpack(&doc, NULL, 0, &only);
+        if (rc != BJD_OK || ro != BJD_EBUF || only != size[f]) fail("%s: %s", doc_name, op_name[3 + f]);
+        if (f == 0) form[0][size[0]] = '\0';
+        bjson_err_t re = f == 0 ? bjson_encode_from_json_ex((char*)form[0], &opts, back, cap, &blen)
+                       : f == 1 ? bjson_encode_from_cbor(form[1], size[1], &opts, back, cap, &blen)
+                       : bjson_encode_from_msgpack(form[2], size[2], &opts, back, cap, &blen);
+        if (re != BJSON_OK || blen != len || memcmp(back, bin, len) != 0) fail("%s: %s round trip", doc_name, op_name[f]);
+    }
+
+    double mb[6];
+    for (int op = 0; op < 6; op++) {
+        size_t bytes = 0, n;
+        double t0 = now_s(), el;
+        do {
+            int rc;
+            switch (op) {
+            case 0:  rc = bjson_encode_from_json_ex((char*)form[0], &opts, back, cap, &n); break;
+            case 1:  rc = bjson_encode_from_cbor(form[1], size[1], &opts, back, cap, &n); break;
+            case 2:  rc = bjson_encode_from_msgpack(form[2], size[2], &opts, back, cap, &n); break;
+            case 3:  rc = bjd_to_json(&doc, (char*)form[0], cap - 1, &n); break;
+            case 4:  rc = bjd_to_cbor(&doc, form[1], cap, &n); break;
+            default: rc = bjd_to_msgpack(&doc, form[2], cap, &n); break;
+            }
+            if (rc != 0) fail("%s: %s in loop", doc_name, op_name[op]);
+            g_sink += n;
+            bytes += len;
+        } while ((el = now_s() - t0) < g_min_s);
+        mb[op] = (double)bytes / el / 1e6;
+    }
+    row_begin("transcode");
+    fprintf(g_out, ", \"doc\": \"%s\", \"keys\": %d, \"str_len\": %d, \"bjson_bytes\": %zu, \"json_bytes\": %zu"
+            ", \"cbor_bytes\": %zu, \"msgpack_bytes\": %zu", doc_name, nkeys, slen, len, size[0], size[1], size[2]);
+    for (int op = 0; op < 6; op++) fprintf(g_out, ", \"%s_mb_s\": %.1f", op_name[op], mb[op]);
+    row_end();
+    free(bin); free(back); free(form[0]); free(form[1]); free(form[2]);
+}
+
+/** bjd_visit callback for bench_dedup: sums string bytes, counts strings. */
+static int visit_str(const bjd_entry_t* e, uint32_t depth, int leave, void* user)
+{
+    (void)depth;
+    if (!leave && e->type == BJD_T_STR) { ((size_t*)user)[0] += e->val_len; ((size_t*)user)[1]++; }
+    return 0;
+}
+
+/**
+ * @brief String deduplication (BJSON_ENC_F_DEDUP) against plain encoding.
+ *
+ * Checked first: the three encoders agree on the deduplicated image, it
+ * reads back as the same JSON and string bytes as the plain one, and its
+ * compact form expands back to it byte for byte. Sizes are reported for
+ * the aligned and compact profiles; encode MB/s (JSON input) for each
+ * encoder with and without the flag; str_ns is the cost per string of
+ * reading every string value through bjd_visit (back-references resolve
+ * on the way).
+ */
+static void bench_dedup(const char* doc_name, const text_t* t, int nrec)
+{
+    static const char* mode[3] = { "ast", "direct", "stream" };
+    size_t cap = t->n * 2 + 4096, len[2], zlen[2], xlen, jlen[2], sum[2][2] = { { 0 } };
+    uint8_t* img[2] = { malloc(cap), malloc(cap) };
+    uint8_t* z[2] = { malloc(cap), malloc(cap) };
+    uint8_t* x = malloc(cap);
+    char* js[2] = { malloc(t->n + 64), malloc(t->n + 64) };
+    bjson_alloc_t al = { std_alloc, std_free, NULL, 0 };
+    bjson_enc_ctx_t ctx;
+    bjson_enc_ctx_init(&ctx, NULL, 0, &al);
+    bjd_doc_t doc[2], zdoc;
+    if (!img[0] || !img[1] || !z[0] || !z[1] || !x || !js[0] || !js[1]) fail("dedup alloc");
+    for (int d = 0; d < 2; d++) {
+        uint32_t fl = d ? BJSON_ENC_F_DEDUP : 0;
+        bjson_enc_opts_t ast = { .flags = fl }, direct = { .flags = fl | BJSON_ENC_F_DIRECT };
+        if (bjson_encode_ctx(&ctx, t->s, &ast, img[d], cap, &len[d]) != BJSON_OK) fail("%s: dedup %d encode", doc_name, d);
+        if (bjson_encode_ctx(&ctx, t->s, &direct, x, cap, &xlen) != BJSON_OK || xlen != len[d] || memcmp(x, img[d], xlen) != 0 ||
+            enc_stream(t->s, t->n, fl, x, cap, &xlen) != BJSON_OK || xlen != len[d] || memcmp(x, img[d], xlen) != 0)
+            fail("%s: dedup %d encoders differ", doc_name, d);
+        if (bjd_open(img[d], len[d], &doc[d]) != BJD_OK || bjd_validate(&doc[d]) != BJD_OK) fail("%s: dedup %d open", doc_name, d);
+        if (bjd_to_json(&doc[d], js[d], t->n + 64, &jlen[d]) != BJD_OK) fail("%s: dedup %d to_json", doc_name, d);
+        if (bjd_visit(&doc[d], visit_str, sum[d]) != 0) fail("%s: dedup %d visit", doc_name, d);
+        if (bjson_compact(&doc[d], z[d], len[d], &zlen[d]) != BJSON_OK) fail("%s: dedup %d compact", doc_name, d);
+    }
+    if (jlen[0] != jlen[1] || memcmp(js[0], js[1], jlen[0]) != 0 || sum[0][0] != sum[1][0] || sum[0][1] != sum[1][1])
+        fail("%s: dedup doc reads back differently", doc_name);
+    if (!(doc[1].flags & BJD_F_SREF) || len[1] > len[0] || zlen[1] > zlen[0]) fail("%s: dedup did not shrink", doc_name);
+    if (bjd_open(z[1], zlen[1], &zdoc) != BJD_OK || bjd_validate(&zdoc) != BJD_OK ||
+        bjson_expand(&zdoc, BJSON_ENC_F_DEDUP, x, cap, &xlen) != BJSON_OK || xlen != len[1] || memcmp(x, img[1], xlen) != 0)
+        fail("%s: dedup compact does not expand back", doc_name);
+
+    double mb[2][3], ns[2];
+    for (int d = 0; d < 2; d++) {
+        uint32_t fl = d ? BJSON_ENC_F_DEDUP : 0;
+        bjson_enc_opts_t ast = { .flags = fl }, direct = { .flags = fl | BJSON_ENC_F_DIRECT };
+        for (int m = 0; m < 3; m++) {
+            size_t iters = 0;
+            double t0 = now_s(), el;
+            do {
+                bjson_err_t rc = m == 2 ? enc_stream(t->s, t->n, fl, x, cap, &xlen)
+                                        : bjson_encode_ctx(&ctx, t->s, m ? &direct : &ast, x, cap, &xlen);
+                if (rc != BJSON_OK) fail("%s: dedup %s encode in loop", doc_name, mode[m]);
+                g_sink += xlen;
+                iters++;
+            } while ((el = now_s() - t0) < g_min_s);
+            mb[d][m] = (double)t->n * (double)iters / el / 1e6;
+        }
+        size_t strs = 0;
+        double t0 = now_s(), el;
+        do {
+            size_t acc[2] = { 0, 0 };
+            bjd_visit(&doc[d], visit_str, acc);
+            g_sink += acc[0];
+            strs += acc[1];
+        } while ((el = now_s() - t0) < g_min_s);
+        ns[d] = el * 1e9 / (double)strs;
+    }
+    row_begin("dedup");
+    fprintf(g_out, ", \"doc\": \"%s\", \"records\": %d, \"strings\": %zu, \"plain_bytes\": %zu, \"dedup_bytes\": %zu, \"saved_pct\": %.1f"
+            ", \"compact_plain_bytes\": %zu, \"compact_dedup_bytes\": %zu, \"compact_saved_pct\": %.1f",
+            doc_name, nrec, sum[0][1], len[0], len[1], 100.0 * (double)(len[0] - len[1]) / (double)len[0],
+            zlen[0], zlen[1], 100.0 * (double)(zlen[0] - zlen[1]) / (double)zlen[0]);
+    for (int m = 0; m < 3; m++) fprintf(g_out, ", \"%s_mb_s\": %.1f, \"%s_dedup_mb_s\": %.1f", mode[m], mb[0][m], mode[m], mb[1][m]);
+    fprintf(g_out, ", \"str_ns\": %.1f, \"str_dedup_ns\": %.1f", ns[0], ns[1]);
+    row_end();
+    for (int d = 0; d < 2; d++) { free(img[d]); free(z[d]); free(js[d]); }
+    free(x);
+    bjson_enc_ctx_release(&ctx);
+}
+
+/**
+ * @brief bjson_encode_batch from 1 to BJSON_BATCH_THREADS_MAX workers.
+ *
+ * A queue of small documents (8..67 keys) with a large one (400 keys)
+ * every 16th, the uneven mix per-peer configs and queued telemetry give.
+ * Every item is checked against bjson_encode_from_json_ex first. Worker
+ * contexts are kept across runs, so the timed rounds reuse their arenas.
+ * MB/s counts JSON input; "cpus" is the online CPU count of the host.
+ */
+static void bench_batch(void)
+{
+    enum { NDOCS = 512 };
+    static text_t doc[NDOCS];
+    static bjson_batch_item_t items[NDOCS];
+    static uint8_t* ref[NDOCS];
+    static size_t ref_len[NDOCS];
+    size_t json_bytes = 0;
+    for (int i = 0; i < NDOCS; i++) {
+        gen_doc(&doc[i], i % 16 == 0 ? 400 : 8 + (i * 37) % 60, 8 + i % 3 * 24, i % 2, i % 5 == 0 ? PROF_NUMBERS : PROF_MIXED);
+        size_t cap = doc[i].n * 4 + 4096;
+        if (!(ref[i] = malloc(cap)) || !(items[i].out = malloc(cap))) fail("batch alloc");
+        if (bjson_encode_from_json_ex(doc[i].s, NULL, ref[i], cap, &ref_len[i]) != BJSON_OK) fail("batch reference %d", i);
+        items[i].json = doc[i].s;
+        items[i].cap = cap;
+        json_bytes += doc[i].n;
+    }
+
+    bjson_alloc_t al = { std_alloc, std_free, NULL, 0 };
+    bjson_enc_ctx_t ctx[BJSON_BATCH_THREADS_MAX];
+    for (int k = 0; k < BJSON_BATCH_THREADS_MAX; k++) bjson_enc_ctx_init(&ctx[k], NULL, 0, &al);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 0;
+    for (int th = 1; th <= BJSON_BATCH_THREADS_MAX; th *= 2) {
+        if (bjson_encode_batch(items, NDOCS, NULL, ctx, th) != BJSON_OK) fail("batch, %d threads", th);
+        for (int i = 0; i < NDOCS; i++)
+            if (items[i].err != BJSON_OK || items[i].len != ref_len[i] || memcmp(items[i].out, ref[i], ref_len[i]) != 0)
+                fail("batch, %d threads: item %d differs", th, i);
+
+        size_t rounds = 0;
+        double t0 = now_s(), el;
+        do {
+            if (bjson_encode_batch(items, NDOCS, NULL, ctx, th) != BJSON_OK) fail("batch in loop");
+            g_sink += items[NDOCS - 1].len;
+            rounds++;
+        } while ((el = now_s() - t0) < g_min_s);
+        double mb = (double)json_bytes * (double)rounds / el / 1e6;
+        if (th == 1) base = mb;
+        row_begin("batch");
+        fprintf(g_out, ", \"threads\": %d, \"cpus\": %ld, \"docs\": %d, \"json_bytes\": %zu, \"mb_s\": %.1f, \"docs_s\": %.0f, \"speedup\": %.2f",
+                th, cpus, NDOCS, json_bytes, mb, (double)NDOCS * (double)rounds / el, mb / base);
+        row_end();
+    }
+    for (int k = 0; k < BJSON_BATCH_THREADS_MAX; k++) bjson_enc_ctx_release(&ctx[k]);
+    for (int i = 0; i < NDOCS; i++) { free(doc[i].s); free(ref[i]); free(items[i].out); }
+}
+
+/* ---------------------------------------------------------------------- */
+/* scan kernels                                                            */
+
+/**
+ * @brief Compare the build's scan kernel with the scalar reference.
+ *
+ * Cross-checks scan_str/scan_ws against the byte loops at every offset
+ * of a random buffer, then times both over long runs (the string body
+ * and indentation cases the encoders jump over).
+ */
+static void bench_scan(void)
+{
+    enum { N = 1 << 16 };
+    static char buf[N];
+    unsigned seed = 12345;
+    for (int i = 0; i < N; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned r = (seed >> 16) % 64;
+        buf[i] = r == 0 ? '"' : r == 1 ? '\\' : r < 10 ? " \t\r\n"[r % 4] : (char)('a' + r % 26);
+    }
+    for (size_t i = 0; i < N; i++) {
+        size_t n = N - i < 300 ? N - i : 300;
+        if (scan_str(buf + i, n) != scan_str_scalar(buf + i, n)) fail("scan_str kernel at %zu", i);
+        if (scan_ws(buf + i, n) != scan_ws_scalar(buf + i, n)) fail("scan_ws kernel at %zu", i);
+    }
+
+    // long runs: no stop byte in the string buffer, all blanks in the ws buffer
+    static char str[N + 1], blank[N + 1];
+    memset(str, 'x', N); str[N] = '"';
+    memset(blank, ' ', N); blank[N] = 'x';
+    for (int run = 16; run <= 1024; run *= 8) {
+        for (int k = 0; k < 2; k++) {
+            const char* kernel = k ? BJSON_SCAN_KERNEL : "scalar";
+            double mb[2];
+            for (int which = 0; which < 2; which++) {
+                const char* s = which ? blank : str;
+                size_t bytes = 0;
+                double t0 = now_s(), el;
+                do {
+                    for (size_t off = 0; off + (size_t)run <= N; off += (size_t)run + 1) {
+                        size_t r = which ? (k ? scan_ws(s + off, (size_t)run) : scan_ws_scalar(s + off, (size_t)run))
+                                         : (k ? scan_str(s + off, (size_t)run) : scan_str_scalar(s + off, (size_t)run));
+                        g_sink += r;
+                        bytes += (size_t)run;
+                    }
+                } while ((el = now_s() - t0) < g_min_s);
+                mb[which] = (double)bytes / el / 1e6;
+            }
+            row_begin("scan");
+            fprintf(g_out, ", \"kernel\": \"%s\", \"run\": %d, \"str_mb_s\": %.1f, \"ws_mb_s\": %.1f", kernel, run, mb[0], mb[1]);
+            row_end();
+        }
+    }
+}
+
+/**
+ * @brief Generate `n` bytes of well-formed UTF-8 text.
+ *
+ * @param buf[out] Text.
+ * @param n Size; the tail is padded with ASCII.
+ * @param hangul_pct Share of Hangul syllables among the characters (0..100).
+ */
+static void gen_utf8(char* buf, size_t n, int hangul_pct)
+{
+    unsigned seed = 2024;
+    size_t i = 0;
+    while (i < n) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned r = seed >> 16;
+        if ((int)(r % 100) < hangul_pct && n - i >= 3) {
+            unsigned cp = 0xAC00 + r % 11172;
+            buf[i++] = (char)(0xE0 | cp >> 12); buf[i++] = (char)(0x80 | (cp >> 6 & 0x3F)); buf[i++] = (char)(0x80 | (cp & 0x3F));
+        } else buf[i++] = (char)(' ' + r % 95);
+    }
+}
+
+/**
+ * @brief UTF-8 validation kernel against the scalar reference and memcpy.
+ *
+ * Cross-checks scan_utf8 against scan_utf8_scalar at every offset of
+ * each corpus, intact and with malformed bytes planted, then times
+ * both (and a memcpy of the same runs, as the bandwidth ceiling) over
+ * runs cut at character boundaries: ASCII only (the fast exit), Korean
+ * (Hangul, 3-byte sequences) and a 50/50 mix.
+ */
+static void bench_utf8(void)
+{
+    enum { N = 1 << 16 };
+    static char buf[N + 1], bad[N], dst[N];   // buf[N] = 0 stops the boundary search
+    static const struct { const char* name; int pct; } corpus[] = { { "ascii", 0 }, { "korean", 100 }, { "mixed", 50 } };
+    static const char* junk[] = { "\xFF", "\xC0\x80", "\xED\xA0\x80", "\xE0\x9F\xBF", "\xF4\x90\x80\x80", "\x80", "\xEA\xB0" };
+    for (size_t c = 0; c < sizeof(corpus) / sizeof(corpus[0]); c++) {
+        gen_utf8(buf, N, corpus[c].pct);
+        memcpy(bad, buf, N);
+        for (size_t i = 97; i + 4 < N; i += 97 + i % 89) {
+            const char* j = junk[i % 7];
+            memcpy(bad + i, j, strlen(j));
+        }
+        if (scan_utf8(buf, N) != N) fail("utf8 %s: corpus rejected", corpus[c].name);
+        for (size_t i = 0; i < N; i++) {
+            size_t n = N - i < 300 ? N - i : 300;
+            if (scan_utf8(buf + i, n) != scan_utf8_scalar(buf + i, n)) fail("utf8 %s kernel at %zu", corpus[c].name, i);
+            if (scan_utf8(bad + i, n) != scan_utf8_scalar(bad + i, n)) fail("utf8 %s kernel at %zu (malformed)", corpus[c].name, i);
+        }
+
+        for (int run = 64; run <= 1024; run *= 16) {
+            for (int k = 0; k < 3; k++) {
+                const char* kernel = k == 0 ? "scalar" : k == 1 ? BJSON_UTF8_KERNEL : "memcpy";
+                size_t bytes = 0;
+                double t0 = now_s(), el;
+                do {
+                    for (size_t off = 0; off + (size_t)run <= N;) {
+                        size_t n = (size_t)run;
+                        while (n && (buf[off + n] & 0xC0) == 0x80) n--;   // end on a character boundary
+                        if (k == 2) { memcpy(dst + off, buf + off, n); g_sink += (uint8_t)dst[off]; }
+                        else {
+                            size_t r = k ? scan_utf8(buf + off, n) : scan_utf8_scalar(buf + off, n);
+                            if (r != n) fail("utf8 %s: run at %zu rejected", corpus[c].name, off);
+                            g_sink += r;
+                        }
+                        bytes += n;
+                        off += n;
+                    }
+                } while ((el = now_s() - t0) < g_min_s);
+                row_begin("utf8");
+                fprintf(g_out, ", \"corpus\": \"%s\", \"kernel\": \"%s\", \"run\": %d, \"mb_s\": %.1f",
+                        corpus[c].name, kernel, run, (double)bytes / el / 1e6);
+                row_end();
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) g_min_s = 0.02;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) path = argv[++i];
+        else { fprintf(stderr, "usage: %s [-q] [-o out.json]\n", argv[0]); return 2; }
+    }
+    g_out = path ? fopen(path, "w") : stdout;
+    if (!g_out) { fprintf(stderr, "bjson_bench: cannot write %s\n", path); return 1; }
+
+    fprintf(g_out, "{\n  \"tool\": \"bjson_bench\",\n  \"scan_kernel\": \"%s\",\n  \"utf8_kernel\": \"%s\",\n  \"quick\": %d,\n  \"results\": [",
+            BJSON_SCAN_KERNEL, BJSON_UTF8_KERNEL, g_min_s < 0.2);
+
+    static const int keys[] = { 10, 100, 1000 };
+    static const int slens[] = { 8, 64, 200 };
+    text_t t = {0};
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+        for (size_t s = 0; s < sizeof(slens) / sizeof(slens[0]); s++)
+            for (int pretty = 0; pretty < 2; pretty++) {
+                gen_doc(&t, keys[k], slens[s], pretty, PROF_MIXED);
+                bench_encode("mixed", &t, keys[k], slens[s], pretty, 0);
+            }
+    gen_doc(&t, 1000, 0, 1, PROF_NUMBERS);
+    bench_encode("numbers", &t, 1000, 0, 1, 0);
+    bench_to_json("numbers", &t, 1000, 0);
+    for (size_t s = 0; s < sizeof(slens) / sizeof(slens[0]); s++) {
+        gen_doc(&t, 1000, slens[s], 0, PROF_MIXED);
+        bench_to_json("mixed", &t, 1000, slens[s]);
+    }
+    gen_doc(&t, 1000, 64, 1, PROF_MIXED);
+    bench_encode("mixed", &t, 1000, 64, 1, BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC);
+    gen_doc(&t, 1000, 64, 1, PROF_ESCAPED);
+    bench_encode("escaped", &t, 1000, 64, 1, 0);
+    bench_to_json("escaped", &t, 1000, 64);
+    static const struct { const char* name; profile_t prof; } text[] = { { "mixed", PROF_MIXED }, { "korean", PROF_KOREAN }, { "utf8mix", PROF_UTF8MIX } };
+    for (size_t p = 0; p < sizeof(text) / sizeof(text[0]); p++) {
+        gen_doc(&t, 1000, 64, 0, text[p].prof);
+        bench_encode(text[p].name, &t, 1000, 64, 0, BJSON_ENC_F_UTF8);
+        bench_encode(text[p].name, &t, 1000, 64, 0, BJSON_ENC_F_CPLIMIT);
+        if (p) bench_encode(text[p].name, &t, 1000, 64, 0, 0);   // mixed/0 is in the grid above
+    }
+    for (size_t s = 0; s < 2; s++) {
+        gen_doc(&t, 1000, slens[s], 0, PROF_MIXED);
+        bench_compact("mixed", &t, 1000, slens[s]);
+    }
+    gen_doc(&t, 1000, 0, 0, PROF_NUMBERS);
+    bench_compact("numbers", &t, 1000, 0);
+    gen_nested(&t, 250);
+    bench_compact("nested", &t, 250, 0);
+    bench_transcode("nested", &t, 250, 0);
+    gen_doc(&t, 1000, 0, 0, PROF_NUMBERS);
+    bench_transcode("numbers", &t, 1000, 0);
+    for (size_t s = 0; s < 2; s++) {
+        gen_doc(&t, 1000, slens[s], 0, PROF_MIXED);
+        bench_transcode("mixed", &t, 1000, slens[s]);
+    }
+    gen_fleet(&t, 100);
+    bench_dedup("fleet", &t, 100);
+    gen_fleet(&t, 1000);
+    bench_dedup("fleet", &t, 1000);
+    gen_doc(&t, 1000, 64, 0, PROF_KOREAN);
+    bench_dedup("korean", &t, 1000);   // 250 distinct strings: hashing cost, no repeats
+    free(t.s);
+
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) bench_lookups(keys[k]);
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) bench_startup(keys[k]);
+    bench_paged(1000, 0);
+    bench_paged(1000, 1);
+    bench_paged(10000, 1);
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) bench_patch(keys[k]);
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) bench_delta(keys[k]);
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) bench_dict(keys[k]);
+    bench_batch();
+    bench_scan();
+    bench_utf8();
+
+    fprintf(g_out, "\n  ]\n}\n");
+    if (path) fclose(g_out);
+    return 0;
+}
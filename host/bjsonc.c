@@ -0,0 +1,231 @@
+#include "bjson_enc.h"
+#include "bjson_compact.h"
+#include "bjson_map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * bjsonc - compile a JSON file into a BJSON image.
+ *
+ *   bjsonc [-i] [-c] [-r] [-z] [-u | -U] [-k KEYS] [-H OUT.h] [-p SIZE] in.json out.bjson
+ *
+ *   -i       add the key index section (BJD_F_INDEX)
+ *   -c       add the CRC-32 trailer (BJD_F_CRC)
+ *   -r       reserve STR_N bytes per string for bjd_set_str (BJD_F_RESERVE)
+ *   -z       write the compact profile (BJD_F_COMPACT, not with -i or -r)
+ *   -u       strict UTF-8: fail on malformed keys or strings
+ *   -U       like -u, and STR_N limits count code points instead of bytes
+ *   -k KEYS  store the keys listed in KEYS (one per line, '#' comments)
+ *            as 16-bit key IDs (BJD_F_DICT); keys of 3 bytes or less are
+ *            skipped, they would not get shorter
+ *   -H OUT.h write the sorted key table for the firmware (needs -k)
+ *   -p SIZE  pad the image with 0xFF to SIZE bytes (erased flash), fail if larger
+ *
+ * The written image is mapped back with bjd_open_mapped and validated,
+ * the same way the firmware opens it.
+ */
+
+/**
+ * @brief Read a whole file into a NUL-terminated heap buffer.
+ *
+ * @param path File path.
+ * @param n[out] File size in bytes.
+ * @return Buffer (free with free), or NULL on error.
+ */
+static char* read_file(const char* path, size_t* n)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return NULL;
+    char* buf = NULL;
+    long sz;
+    if (fseek(fp, 0, SEEK_END) == 0 && (sz = ftell(fp)) >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        buf = malloc((size_t)sz + 1);
+        if (buf && fread(buf, 1, (size_t)sz, fp) != (size_t)sz) { free(buf); buf = NULL; }
+        if (buf) { buf[sz] = '\0'; *n = (size_t)sz; }
+    }
+    fclose(fp);
+    return buf;
+}
+
+static int cmp_key(const void* a, const void* b)
+{
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+/**
+ * @brief Load a key list file into a dictionary.
+ *
+ * One key per line; surrounding blanks, empty lines and lines starting
+ * with '#' are ignored. Keys are sorted and duplicates dropped, as
+ * bjd_dict_init requires.
+ *
+ * @param path Key list file.
+ * @param dict[out] Dictionary; its keys point into `*text` and `*keys`.
+ * @param text[out] File contents (free with free).
+ * @param keys[out] Key pointer table (free with free).
+ * @return 0 on success, -1 on a read error, too many or too long keys.
+ */
+static int load_keys(const char* path, bjd_dict_t* dict, char** text, const char*** keys)
+{
+    size_t n = 0, cnt = 0;
+    char* buf = read_file(path, &n);
+    if (!buf) return -1;
+    const char** tab = malloc((n / 2 + 1) * sizeof(*tab));   // a key takes at least 2 bytes
+    if (!tab) { free(buf); return -1; }
+    for (char* line = strtok(buf, "\r\n"); line; line = strtok(NULL, "\r\n")) {
+        while (*line == ' ' || *line == '\t') line++;
+        size_t k = strlen(line);
+        while (k && (line[k - 1] == ' ' || line[k - 1] == '\t')) line[--k] = '\0';
+        if (k > BJD_KEY_ID_LEN && line[0] != '#') tab[cnt++] = line;
+    }
+    qsort(tab, cnt, sizeof(*tab), cmp_key);
+    size_t u = 0;
+    for (size_t k = 0; k < cnt; k++)
+        if (!u || strcmp(tab[u - 1], tab[k])) tab[u++] = tab[k];
+    if (u > UINT16_MAX || bjd_dict_init(dict, tab, (uint16_t)u) != 0) { free(tab); free(buf); return -1; }
+    *text = buf; *keys = tab;
+    return 0;
+}
+
+/**
+ * @brief Write the dictionary as a C header for the firmware.
+ *
+ * The firmware passes `bjson_dict_keys` to bjd_dict_init and gets the
+ * same hash as the image (BJSON_DICT_HASH, for a build-time check).
+ *
+ * @param path Header file to write.
+ * @param dict Dictionary from load_keys.
+ * @return 0 on success, -1 on a write error.
+ */
+static int write_header(const char* path, const bjd_dict_t* dict)
+{
+    FILE* fp = fopen(path, "w");
+    if (!fp) return -1;
+    fprintf(fp, "/* Generated by bjsonc -k; key IDs are array indices. Do not edit. */\n#pragma once\n\n");
+    fprintf(fp, "#define BJSON_DICT_COUNT %uu\n#define BJSON_DICT_HASH  0x%08lxu\n\n",
+            (unsigned)dict->count, (unsigned long)dict->hash);
+    fprintf(fp, "static const char* const bjson_dict_keys[BJSON_DICT_COUNT] = {\n");
+    for (uint16_t k = 0; k < dict->count; k++) {
+        fputs("    \"", fp);
+        for (const unsigned char* c = (const unsigned char*)dict->keys[k]; *c; c++) {
+            if (*c == '"' || *c == '\\') fprintf(fp, "\\%c", *c);
+            else if (*c < 0x20 || *c >= 0x7F) fprintf(fp, "\\%03o", *c);
+            else fputc(*c, fp);
+        }
+        fprintf(fp, "\", /* %u */\n", (unsigned)k);
+    }
+    fprintf(fp, "};\n");
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Encode `json`, growing the output buffer until it fits.
+ *
+ * @param json NUL-terminated JSON text of `n` bytes.
+ * @param n Text length.
+ * @param flags BJSON_ENC_F_* flags.
+ * @param dict Key dictionary, or NULL.
+ * @param out[out] Heap buffer with the image (free with free).
+ * @param out_len[out] Image length.
+ * @return Encoder status.
+ */
+static bjson_err_t encode(const char* json, size_t n, uint32_t flags, const bjd_dict_t* dict, uint8_t** out, size_t* out_len)
+{
+    bjson_enc_opts_t opts = { .flags = flags | BJSON_ENC_F_DIRECT, .dict = dict };
+    size_t cap = n + 1024;
+    for (;;) {
+        uint8_t* buf = malloc(cap);
+        if (!buf) return BJSON_ENOMEM;
+        bjson_err_t rc = bjson_encode_from_json_ex(json, &opts, buf, cap, out_len);
+        if (rc != BJSON_EBUF) {
+            if (rc == BJSON_OK) *out = buf;
+            else free(buf);
+            return rc;
+        }
+        free(buf);
+        cap *= 2;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t flags = 0;
+    int compact = 0;
+    size_t pad = 0;
+    const char* keys_path = NULL;
+    const char* hdr_path = NULL;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "-i")) flags |= BJSON_ENC_F_INDEX;
+        else if (!strcmp(argv[i], "-c")) flags |= BJSON_ENC_F_CRC;
+        else if (!strcmp(argv[i], "-r")) flags |= BJSON_ENC_F_RESERVE;
+        else if (!strcmp(argv[i], "-z")) compact = 1;
+        else if (!strcmp(argv[i], "-u")) flags |= BJSON_ENC_F_UTF8;
+        else if (!strcmp(argv[i], "-U")) flags |= BJSON_ENC_F_CPLIMIT;
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc) keys_path = argv[++i];
+        else if (!strcmp(argv[i], "-H") && i + 1 < argc) hdr_path = argv[++i];
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) pad = strtoul(argv[++i], NULL, 0);
+        else break;
+    }
+    if (argc - i != 2 || (hdr_path && !keys_path) || (compact && (flags & (BJSON_ENC_F_INDEX | BJSON_ENC_F_RESERVE)))) {
+        fprintf(stderr, "usage: %s [-i] [-c] [-r] [-z] [-u | -U] [-k KEYS] [-H OUT.h] [-p SIZE] in.json out.bjson\n", argv[0]);
+        return 2;
+    }
+    const char* in = argv[i];
+    const char* out = argv[i + 1];
+
+    bjd_dict_t dict;
+    char* key_text = NULL;
+    const char** key_tab = NULL;
+    if (keys_path && load_keys(keys_path, &dict, &key_text, &key_tab) != 0) {
+        fprintf(stderr, "bjsonc: %s: cannot load key list\n", keys_path);
+        return 1;
+    }
+    if (hdr_path && write_header(hdr_path, &dict) != 0) {
+        fprintf(stderr, "bjsonc: cannot write %s\n", hdr_path);
+        return 1;
+    }
+
+    size_t n = 0, len = 0;
+    char* json = read_file(in, &n);
+    if (!json) { fprintf(stderr, "bjsonc: cannot read %s\n", in); return 1; }
+    uint8_t* img = NULL;
+    bjson_err_t rc = encode(json, n, flags, keys_path ? &dict : NULL, &img, &len);
+    free(json);
+    if (rc != BJSON_OK) { fprintf(stderr, "bjsonc: %s: encode failed: %d\n", in, rc); return 1; }
+    if (compact) {   // never larger than the aligned image
+        bjd_doc_t d;
+        uint8_t* z = malloc(len);
+        rc = BJSON_ENOMEM;
+        if (z && bjd_open(img, len, &d) == BJD_OK) rc = bjson_compact(&d, z, len, &len);
+        free(img);
+        img = z;
+        if (rc != BJSON_OK) { fprintf(stderr, "bjsonc: %s: compact failed: %d\n", in, rc); free(img); return 1; }
+    }
+    if (pad && len > pad) {
+        fprintf(stderr, "bjsonc: %s: image is %zu bytes, partition only %zu\n", in, len, pad);
+        free(img);
+        return 1;
+    }
+
+    FILE* fp = fopen(out, "wb");
+    int ok = fp && fwrite(img, 1, len, fp) == len;
+    for (size_t k = len; ok && k < pad; k++) ok = fputc(0xFF, fp) != EOF;   // erased flash
+    if (fp && fclose(fp) != 0) ok = 0;
+    free(img);
+    if (!ok) { fprintf(stderr, "bjsonc: cannot write %s\n", out); return 1; }
+
+    // 펌웨어와 같은 경로로 다시 열어서 확인
+    bjd_map_t m;
+    bjd_err_t v = bjd_open_mapped(out, 1, keys_path ? &dict : NULL, &m);
+    if (v != BJD_OK) { fprintf(stderr, "bjsonc: %s: mapped check failed: %d\n", out, v); bjd_close_mapped(&m); return 1; }
+    printf("%s -> %s: %zu bytes JSON, %zu bytes BJSON, %u entries", in, out, n, len, (unsigned)m.doc.count);
+    if (keys_path) printf(", %u dictionary keys", (unsigned)dict.count);
+    printf("\n");
+    bjd_close_mapped(&m);
+    free(key_tab);
+    free(key_text);
+    return 0;
+}
@@ -0,0 +1,457 @@
+/*
+ * bjson_test - correctness checks for json_enc and libbjson on the host.
+ *
+ *   bjson_test
+ *
+ * Fixed inputs, one check per behaviour the readers and encoders have
+ * to keep: the key prefix registry is sorted, string escapes decode to
+ * the expected bytes and bad ones (and NUL bytes in keys) fail, array
+ * views print as arrays in JSON, CBOR and MessagePack, a CRC image with
+ * one flipped bit fails bjd_validate, bjd_get_array / bjd_pg_get_array
+ * refuse element types without a packed form, a code-point STR_N string
+ * patches in place up to its limit, a delta rebuilds the new image
+ * exactly (inserts, deletes, nested, packed, reordered and duplicate
+ * keys, compacted patches) and a key-ID image maps with its dictionary.
+ * The first failure is printed and exits 1; registered with CTest
+ * (`ctest --test-dir build-host`). Timing lives in bjson_bench.
+ */
+#include "bjson_enc.h"
+#include "bjson.h"
+#include "bjson_compact.h"
+#include "bjson_delta.h"
+#include "bjson_map.h"
+#include "bjson_page.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Print a check failure and exit. */
+static void fail(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "bjson_test: check failed: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(1);
+}
+
+/** Growable text buffer. */
+typedef struct { char* s; size_t n, cap; } text_t;
+
+static void tx_put(text_t* t, const char* fmt, ...)
+{
+    va_list ap;
+    for (;;) {
+        va_start(ap, fmt);
+        int k = vsnprintf(t->s + t->n, t->cap - t->n, fmt, ap);
+        va_end(ap);
+        if (k >= 0 && (size_t)k < t->cap - t->n) { t->n += (size_t)k; return; }
+        t->cap = t->cap * 2 + (size_t)k + 64;
+        t->s = realloc(t->s, t->cap);
+        if (!t->s) fail("out of memory");
+    }
+}
+
+/**
+ * @brief Flat object with `nkeys` members, as bjson_bench's mixed profile.
+ *
+ * Every 4th member is "STR_32_K<i>" with 16 letters, the rest
+ * "INT32_K<i>" holding i * 7 - 3.
+ */
+static void gen_flat(text_t* t, int nkeys)
+{
+    t->n = 0;
+    tx_put(t, "{");
+    for (int i = 0; i < nkeys; i++) {
+        if (i % 4 != 3) tx_put(t, "%s\"INT32_K%d\":%d", i ? "," : "", i, i * 7 - 3);
+        else {
+            tx_put(t, ",\"STR_32_K%d\":\"", i);
+            for (int k = 0; k < 16; k++) tx_put(t, "%c", 'a' + (i + k) % 26);
+            tx_put(t, "\"");
+        }
+    }
+    tx_put(t, "}");
+}
+
+/* ---------------------------------------------------------------------- */
+/* key registry                                                            */
+
+/**
+ * @brief The key prefix registry is sorted and every row classifies.
+ *
+ * bjd_classify_key narrows a sorted range, so a BJD_KEY_PREFIXES row
+ * added out of order would misclassify keys without any other symptom.
+ */
+static void check_prefixes(void)
+{
+    static const struct { const char* pfx; uint8_t type; uint16_t limit; } row[] = {
+#define X(pfx, name, limit) { pfx, BJD_T_##name, limit },
+        BJD_KEY_PREFIXES(X)
+#undef X
+    };
+    char key[32];
+    for (size_t i = 0; i < sizeof row / sizeof row[0]; i++) {
+        if (i && strcmp(row[i - 1].pfx, row[i].pfx) >= 0)
+            fail("BJD_KEY_PREFIXES: \"%s\" must sort before \"%s\"", row[i].pfx, row[i - 1].pfx);
+        snprintf(key, sizeof key, "%sKEY", row[i].pfx);
+        const bjd_prefix_t* pr = bjd_classify_key(key, strlen(key));
+        if (!pr || strcmp(pr->prefix, row[i].pfx) != 0 || pr->type != row[i].type || pr->limit != row[i].limit)
+            fail("BJD_KEY_PREFIXES: %s classified as %s", key, pr ? pr->prefix : "nothing");
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* encode                                                                  */
+
+/**
+ * @brief JSON string escapes decode to the expected bytes, or are refused.
+ *
+ * Fixed inputs through the AST, direct and stream encoders; the stream
+ * one is fed a byte at a time, so every escape is split across feeds.
+ * Surrogate pairs combine into one 4-byte sequence; a lone or unpaired
+ * surrogate and an unknown escape fail with BJSON_ESYNTAX.
+ */
+static void check_escapes(void)
+{
+    static const struct { const char* in; const char* out; size_t n; } ok[] = {
+        { "\\uD83D\\uDE00", "\xF0\x9F\x98\x80", 4 },   // U+1F600
+        { "\\uDBFF\\uDFFF", "\xF4\x8F\xBF\xBF", 4 },   // U+10FFFF
+        { "\\u00e9\\u20AC", "\xC3\xA9\xE2\x82\xAC", 5 },
+        { "a\\u0041\\u0000b", "aA\0b", 4 },
+        { "\\b\\f\\n\\r\\t\\\"\\\\\\/", "\b\f\n\r\t\"\\/", 8 },
+    };
+    static const char* const bad[] = { "\\uD83D", "\\uDE00", "\\uD83D\\u0041", "\\uD83Dx", "\\uDE00\\uD83D", "\\x", "\\u12G4" };
+    char json[96];
+    uint8_t out[256];
+    size_t len;
+    for (size_t i = 0; i < sizeof ok / sizeof ok[0] + sizeof bad / sizeof bad[0]; i++) {
+        int good = i < sizeof ok / sizeof ok[0];
+        snprintf(json, sizeof json, "{\"STR_32_s\":\"%s\"}", good ? ok[i].in : bad[i - sizeof ok / sizeof ok[0]]);
+        for (int m = 0; m < 3; m++) {
+            bjson_enc_opts_t opts = { .flags = m == 1 ? BJSON_ENC_F_DIRECT : 0 };
+            bjson_err_t rc;
+            if (m == 2) {
+                bjson_enc_stream_t st;
+                rc = bjson_enc_begin(&st, &opts, out, sizeof out);
+                for (size_t k = 0; rc == BJSON_OK && json[k]; k++) rc = bjson_enc_feed(&st, json + k, 1);
+                if (rc == BJSON_OK) rc = bjson_enc_end(&st, &len);
+            } else rc = bjson_encode_from_json_ex(json, &opts, out, sizeof out, &len);
+            bjd_doc_t doc;
+            const char* v;
+            uint32_t vn;
+            if (!good) {
+                if (rc != BJSON_ESYNTAX) fail("escape %s: encoder %d returned %d", json, m, rc);
+            } else if (rc != BJSON_OK || bjd_open(out, len, &doc) != BJD_OK || bjd_get_str(&doc, "STR_32_s", &v, &vn) != 0 ||
+                       vn != ok[i].n || memcmp(v, ok[i].out, vn) != 0) fail("escape %s: encoder %d", json, m);
+        }
+    }
+    // raw 0x00 in a key: only the stream encoder takes sized input; with a
+    // dictionary "\x00\x01\x00" would read back as key ID 1
+    static const char* const names[] = { "INT32_a" };
+    static const char nul_key[][16] = { "{\"\0\1\0\":{}}", "{\"a\0b\":{}}" };
+    static const size_t nul_len[] = { 11, 10 };
+    bjd_dict_t dict;
+    if (bjd_dict_init(&dict, names, 1) != 0) fail("escape dict init");
+    for (size_t i = 0; i < sizeof nul_len / sizeof nul_len[0]; i++)
+        for (size_t step = 1; step <= nul_len[i]; step += nul_len[i] - 1) {
+            bjson_enc_opts_t opts = { .dict = &dict };
+            bjson_enc_stream_t st;
+            bjson_err_t rc = bjson_enc_begin(&st, &opts, out, sizeof out);
+            for (size_t k = 0; rc == BJSON_OK && k < nul_len[i]; k += step)
+                rc = bjson_enc_feed(&st, nul_key[i] + k, step < nul_len[i] - k ? step : nul_len[i] - k);
+            if (rc == BJSON_OK) rc = bjson_enc_end(&st, &len);
+            if (rc != BJSON_ESYNTAX) fail("NUL key %zu: stream encoder returned %d (feed %zu)", i, rc, step);
+        }
+}
+
+/* ---------------------------------------------------------------------- */
+/* views                                                                   */
+
+/**
+ * @brief bjd_to_json of bjd_enter views, empty containers included.
+ *
+ * An array view prints as [...] whether or not it has children, in both
+ * entry layouts.
+ */
+static void check_view_json(void)
+{
+    static const char json[] = "{\"a\":[],\"b\":[{\"INT32_x\":1},{}],\"c\":{},\"d\":{\"e\":[]}}";
+    static const char* const want[] = { "[]", "[{\"INT32_x\":1},{}]", "{}", "{\"e\":[]}" };
+    static const char* const path[] = { "a", "b", "c", "d" };
+    uint8_t img[256], z[256];
+    char out[64];
+    size_t len, zlen, n;
+    bjd_doc_t doc, sub;
+    bjd_entry_t e;
+    if (bjson_encode_from_json(json, img, sizeof img, &len) != BJSON_OK || bjd_open(img, len, &doc) != BJD_OK ||
+        bjson_compact(&doc, z, sizeof z, &zlen) != BJSON_OK) fail("view json encode");
+    for (int c = 0; c < 2; c++) {
+        if (c && bjd_open(z, zlen, &doc) != BJD_OK) fail("view json compact");
+        for (int i = 0; i < 4; i++)
+            if (bjd_find_path(&doc, path[i], &e) < 0 || bjd_enter(&e, &sub) != BJD_OK ||
+                bjd_to_json(&sub, out, sizeof out, &n) != BJD_OK || n != strlen(want[i]) || memcmp(out, want[i], n) != 0)
+                fail("view json %s (%s)", path[i], c ? "compact" : "aligned");
+    }
+}
+
+/**
+ * @brief bjd_to_cbor / bjd_to_msgpack of bjd_enter views.
+ *
+ * The leading item must be an array for array views (empty ones
+ * included) and a map otherwise, with the view's element count.
+ */
+static void check_view_bin(void)
+{
+    static const char json[] = "{\"a\":[],\"b\":[{\"INT32_x\":1},{}],\"c\":{},\"d\":{\"e\":[]}}";
+    static const char* const path[] = { "a", "b", "c", "d" };
+    static const uint8_t cbor[] = { 0x80, 0x82, 0xA0, 0xA1 }, mp[] = { 0x90, 0x92, 0x80, 0x81 };
+    uint8_t img[256], out[64];
+    size_t len, n;
+    bjd_doc_t doc, sub;
+    bjd_entry_t e;
+    if (bjson_encode_from_json(json, img, sizeof img, &len) != BJSON_OK || bjd_open(img, len, &doc) != BJD_OK) fail("view bin encode");
+    for (int i = 0; i < 4; i++) {
+        if (bjd_find_path(&doc, path[i], &e) < 0 || bjd_enter(&e, &sub) != BJD_OK) fail("view bin %s", path[i]);
+        if (bjd_to_cbor(&sub, out, sizeof out, &n) != BJD_OK || out[0] != cbor[i]) fail("view cbor %s", path[i]);
+        if (bjd_to_msgpack(&sub, out, sizeof out, &n) != BJD_OK || out[0] != mp[i]) fail("view msgpack %s", path[i]);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* reader                                                                  */
+
+/**
+ * @brief bjd_validate rejects a BJD_F_CRC image with one flipped bit.
+ *
+ * Every byte position is tried (up to ~512 spread over the image), with
+ * the bit rotating; in the flags byte the BJD_F_CRC bit itself is left
+ * alone, as clearing it turns the check off (see bjson_format.md).
+ */
+static void check_corrupt(int nkeys)
+{
+    text_t t = {0};
+    gen_flat(&t, nkeys);
+    size_t cap = t.n * 4 + 4096, len;
+    uint8_t* buf = malloc(cap);
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_DIRECT | BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC };
+    bjd_doc_t doc;
+    if (!buf || bjson_encode_from_json_ex(t.s, &opts, buf, cap, &len) != BJSON_OK || bjd_open(buf, len, &doc) != BJD_OK ||
+        bjd_validate(&doc) != BJD_OK) fail("corrupt: encode");
+    for (size_t i = 0, step = len / 512 + 1; i < len; i += step) {
+        uint8_t bit = i == 6 ? 0x01 : (uint8_t)(1u << (i % 8));
+        buf[i] ^= bit;
+        if (bjd_open(buf, len, &doc) == BJD_OK && (bjd_validate(&doc) == BJD_OK || doc.trusted))
+            fail("corrupt: bit %02x of byte %zu of %zu passed bjd_validate", bit, i, len);
+        buf[i] ^= bit;
+    }
+    if (bjd_open(buf, len, &doc) != BJD_OK || bjd_validate(&doc) != BJD_OK) fail("corrupt: restored image");
+    free(buf);
+    free(t.s);
+}
+
+/** bjd_read_fn over a file descriptor. */
+static int paged_read(void* user, uint32_t off, void* dst, size_t n)
+{
+    return pread(*(int*)user, dst, n, (off_t)off) == (ssize_t)n ? 0 : -1;
+}
+
+/**
+ * @brief bjd_get_array / bjd_pg_get_array refuse element types without
+ *        a packed form.
+ *
+ * The packed entry's type byte is rewritten to BJD_PACKED | elem in an
+ * unvalidated document, and the same elem is asked for: strings,
+ * containers, BOOL/FIX and unknown bytes must all return -1, in memory
+ * and through a page cache.
+ */
+static void check_get_array(void)
+{
+    static const uint8_t elems[] = { 0, BJD_T_STR, BJD_T_BOOL, BJD_T_FIX16, BJD_T_OBJ, BJD_T_ARR, BJD_T_SREF, 0x3F };
+    uint8_t buf[256];
+    size_t len;
+    bjd_doc_t doc;
+    bjd_entry_t e;
+    const void* p;
+    uint32_t n;
+    if (bjson_encode_from_json("{\"ARR_INT32_a\":[1,2,3,4]}", buf, sizeof buf, &len) != BJSON_OK || bjd_open(buf, len, &doc) != BJD_OK ||
+        bjd_find(&doc, "ARR_INT32_a", &e) < 0 || bjd_get_array(&doc, "ARR_INT32_a", BJD_T_I32, &p, &n) != 0 || n != 4) fail("get_array: encode");
+    uint8_t* type = (uint8_t*)e.name - 8;
+    static uint8_t mem[2 * 512] __attribute__((aligned(8)));
+    for (size_t i = 0; i < sizeof elems; i++) {
+        *type = (uint8_t)(BJD_PACKED | elems[i]);
+        if (bjd_get_array(&doc, "ARR_INT32_a", (bjd_type_t)elems[i], &p, &n) != -1) fail("get_array: element type %u", elems[i]);
+        FILE* f = tmpfile();
+        int fd = f ? fileno(f) : -1;
+        bjd_pcache_t c;
+        bjd_pdoc_t pd;
+        bjd_pin_t a;
+        if (fd < 0 || fwrite(buf, 1, len, f) != len || fflush(f) != 0 || bjd_pcache_init(&c, paged_read, &fd, mem, sizeof mem, 512) != BJD_OK ||
+            bjd_open_paged(&c, len, &pd) != BJD_OK) fail("get_array: paged open");
+        if (bjd_pg_get_array(&pd, "ARR_INT32_a", (bjd_type_t)elems[i], &a) != -1) fail("pg_get_array: element type %u", elems[i]);
+        fclose(f);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* patch                                                                   */
+
+/**
+ * @brief bjd_set_str on a BJSON_ENC_F_CPLIMIT | BJSON_ENC_F_RESERVE image.
+ *
+ * STR_32_ holds 32 code points there: the stored 12 Hangul syllables
+ * (36 bytes) write back, the reserve lets them grow to 32 (96 bytes) in
+ * place, 33 are refused, and compact + expand restores the reserve.
+ */
+static void check_patch_cplimit(void)
+{
+    char json[160], big[33 * 3];
+    for (int i = 0; i < 33; i++) memcpy(big + 3 * i, "\xEA\xB0\x80", 3);   // U+AC00
+    snprintf(json, sizeof json, "{\"STR_32_NAME\":\"%.*s\",\"INT32_N\":1}", 36, big);
+    uint8_t img[512], z[512], x[512];
+    size_t len, zlen, xlen;
+    const char* s;
+    uint32_t sn;
+    bjd_doc_t doc, zdoc;
+    for (int m = 0; m < 2; m++) {
+        bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_CPLIMIT | BJSON_ENC_F_RESERVE | BJSON_ENC_F_CRC | (m ? BJSON_ENC_F_DIRECT : 0) };
+        if (bjson_encode_from_json_ex(json, &opts, img, sizeof img, &len) != BJSON_OK || bjd_open(img, len, &doc) != BJD_OK ||
+            !(doc.flags & BJD_F_CPLIMIT)) fail("cplimit patch: encode %d", m);
+        if (bjson_compact(&doc, z, sizeof z, &zlen) != BJSON_OK || bjd_open(z, zlen, &zdoc) != BJD_OK ||
+            bjson_expand(&zdoc, BJSON_ENC_F_RESERVE | BJSON_ENC_F_CRC, x, sizeof x, &xlen) != BJSON_OK ||
+            xlen != len || memcmp(x, img, len) != 0) fail("cplimit patch: expand %d", m);
+        if (bjd_set_str(&doc, "STR_32_NAME", big, 36) != 0 || bjd_set_str(&doc, "STR_32_NAME", big, 96) != 0 ||
+            bjd_validate(&doc) != BJD_OK || bjd_get_str(&doc, "STR_32_NAME", &s, &sn) != 0 || sn != 96 ||
+            memcmp(s, big, 96) != 0 || bjd_set_str(&doc, "STR_32_NAME", big, 99) == 0) fail("cplimit patch: set_str %d", m);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* delta                                                                   */
+
+/**
+ * @brief Apply bjson_diff(old, new) to `old`, as is and compacted.
+ *
+ * Both must rebuild the new image byte for byte; returns the patch size.
+ */
+static size_t delta_roundtrip(const char* tag, const char* oj, const char* nj, uint32_t flags)
+{
+    size_t cap = (strlen(oj) + strlen(nj)) * 4 + 4096, olen, nlen, plen, zlen, alen;
+    uint8_t* img[4];
+    for (int i = 0; i < 4; i++) if (!(img[i] = malloc(cap))) fail("delta alloc");
+    bjson_enc_opts_t opts = { .flags = flags };
+    bjd_doc_t od, nd, pd, zd;
+    if (bjson_encode_from_json_ex(oj, &opts, img[0], cap, &olen) != BJSON_OK ||
+        bjson_encode_from_json_ex(nj, &opts, img[1], cap, &nlen) != BJSON_OK ||
+        bjd_open(img[0], olen, &od) != BJD_OK || bjd_open(img[1], nlen, &nd) != BJD_OK) fail("delta %s: encode", tag);
+    if (bjson_diff(&od, &nd, img[2], cap, &plen) != BJSON_OK || bjd_open(img[2], plen, &pd) != BJD_OK ||
+        bjd_validate(&pd) != BJD_OK || bjson_patch(&od, &pd, img[3], cap, &alen) != BJSON_OK ||
+        alen != nlen || memcmp(img[3], img[1], nlen) != 0) fail("delta %s: patch", tag);
+    memcpy(img[3], img[2], plen);
+    if (bjd_open(img[3], plen, &pd) != BJD_OK || bjson_compact(&pd, img[2], cap, &zlen) != BJSON_OK ||
+        bjd_open(img[2], zlen, &zd) != BJD_OK || bjson_patch(&od, &zd, img[3], cap, &alen) != BJSON_OK ||
+        alen != nlen || memcmp(img[3], img[1], nlen) != 0) fail("delta %s: compact patch", tag);
+    for (int i = 0; i < 4; i++) free(img[i]);
+    return plen;
+}
+
+/**
+ * @brief bjson_diff / bjson_patch on fixed edits, one per diff path.
+ *
+ * Inserts (front, middle, end), deletes, nested `sub` levels, packed
+ * arrays, arrays of objects, a reorder and the duplicate-name fallback,
+ * with and without index, CRC and reserve.
+ */
+static void check_delta_cases(void)
+{
+    static const char* const pair[][3] = {
+        { "insert", "{\"INT32_a\":1,\"INT32_b\":2,\"INT32_c\":3}",
+          "{\"INT32_a\":1,\"STR_32_n\":\"new\",\"INT32_b\":2,\"INT32_c\":3}" },
+        { "insert ends", "{\"INT32_a\":1,\"INT32_b\":2}", "{\"BOOL_f\":true,\"INT32_a\":1,\"INT32_b\":2,\"INT32_d\":4}" },
+        { "delete", "{\"INT32_a\":1,\"INT32_b\":2,\"INT32_c\":3}", "{\"INT32_a\":1,\"INT32_c\":3}" },
+        { "insert+delete", "{\"INT32_a\":1,\"INT32_b\":2,\"INT32_c\":3}", "{\"INT32_z\":0,\"INT32_a\":1,\"INT32_c\":3,\"INT32_y\":9}" },
+        { "nested", "{\"net\":{\"STR_32_ssid\":\"a\",\"UINT16_port\":80,\"tls\":{\"BOOL_on\":false}},\"INT32_r\":1}",
+          "{\"net\":{\"STR_32_ssid\":\"bb\",\"UINT16_port\":80,\"tls\":{\"INT32_v\":2,\"BOOL_on\":true}},\"INT32_r\":1}" },
+        { "packed", "{\"ARR_INT16_c\":[1,2],\"ARR_FLOAT64_s\":[1.5],\"INT32_x\":1}",
+          "{\"ARR_INT16_c\":[1,2,3],\"INT32_x\":1,\"ARR_UINT64_q\":[7]}" },
+        { "array", "{\"list\":[{\"INT32_x\":1},{\"INT32_x\":2}]}", "{\"list\":[{\"INT32_x\":1},{\"INT32_x\":3},{}]}" },
+        { "reorder", "{\"INT32_a\":1,\"INT32_b\":2,\"INT32_c\":3}", "{\"INT32_c\":3,\"INT32_a\":1,\"INT32_b\":2}" },
+        { "duplicate", "{\"INT32_a\":1,\"INT32_a\":2,\"INT32_b\":3}", "{\"INT32_a\":1,\"INT32_a\":5,\"INT32_b\":3}" },
+    };
+    static const uint32_t flags[] = { 0, BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC, BJSON_ENC_F_RESERVE | BJSON_ENC_F_CRC };
+    for (size_t i = 0; i < sizeof pair / sizeof pair[0]; i++)
+        for (size_t f = 0; f < sizeof flags / sizeof flags[0]; f++) delta_roundtrip(pair[i][0], pair[i][1], pair[i][2], flags[f]);
+}
+
+/**
+ * @brief One key inserted near the front of a 1000-key document.
+ *
+ * Positioned adds keep the patch to the new entry instead of every
+ * entry after it.
+ */
+static void check_delta_insert(void)
+{
+    text_t t = {0}, ins = {0};
+    gen_flat(&t, 1000);
+    const char* k1 = strchr(t.s, ',');   // after the first key
+    tx_put(&ins, "%.*s,\"INT32_NEW\":1%s", (int)(k1 - t.s), t.s, k1);
+    size_t plen = delta_roundtrip("insert 2nd", t.s, ins.s, BJSON_ENC_F_INDEX | BJSON_ENC_F_CRC);
+    if (plen > 256) fail("delta: insert patch %zu bytes", plen);
+    free(t.s);
+    free(ins.s);
+}
+
+/* ---------------------------------------------------------------------- */
+/* key dictionary                                                          */
+
+/**
+ * @brief bjd_open_mapped of a key-ID image (BJD_F_DICT).
+ *
+ * Validated in the same call, the image opens only with its dictionary;
+ * without one bjd_validate fails with BJD_EDICT.
+ */
+static void check_dict_mapped(void)
+{
+    static const char* const keys[] = { "INT32_a", "STR_32_b" };
+    uint8_t img[256];
+    size_t len;
+    bjd_dict_t dict;
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_CRC, .dict = &dict };
+    if (bjd_dict_init(&dict, keys, 2) != 0 ||
+        bjson_encode_from_json_ex("{\"INT32_a\":5,\"STR_32_b\":\"hi\",\"INT32_c\":1}", &opts, img, sizeof img, &len) != BJSON_OK)
+        fail("dict mapped: encode");
+    char path[] = "/tmp/bjson_test_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, img, len) != (ssize_t)len) fail("dict mapped: write");
+    close(fd);
+    bjd_map_t m;
+    bjd_key_t k;
+    bjd_entry_t e;
+    int32_t v;
+    bjd_key_init_dict(&k, &dict, "STR_32_b");
+    if (bjd_open_mapped(path, 1, NULL, &m) != BJD_EDICT) fail("dict mapped: validated without its dictionary");
+    if (bjd_open_mapped(path, 1, &dict, &m) != BJD_OK || !m.doc.trusted || bjd_find_key(&m.doc, &k, &e) != 1 ||
+        bjd_get_i32(&m.doc, "INT32_a", &v) != 0 || v != 5) fail("dict mapped: open");
+    bjd_close_mapped(&m);
+    unlink(path);
+}
+
+int main(void)
+{
+    check_prefixes();
+    check_escapes();
+    check_view_json();
+    check_view_bin();
+    for (int n = 10; n <= 1000; n *= 10) check_corrupt(n);
+    check_get_array();
+    check_patch_cplimit();
+    check_delta_cases();
+    check_delta_insert();
+    check_dict_mapped();
+    printf("bjson_test: all checks passed\n");
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include "esp_spiffs.h"
 #include "nvs_flash.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -11,9 +12,12 @@
 // JSON Components
 #include "bjson_enc.h"
 #include "bjson.h"
+#include "bjson_map.h"
 
 
 #define TEST_BIN_SIZE 4096
+#define JSON_CHUNK_SIZE 512   // SPIFFS read size for the chunked encoder
+#define BJSON_PART_LABEL "bjson"   // precompiled image partition (host bjsonc, see partitions.csv)
 
 static const char* TAG = "APP";
 
@@ -61,58 +65,45 @@ static bool system_init(void)
 
 
 /**
- * @brief Read a text file from the given path into a heap buffer.
+ * @brief Stream a JSON file from SPIFFS into the chunked BJSON encoder.
  *
- * The returned buffer is NUL-terminated and must be freed by the caller.
- * On failure NULL is returned and an error is logged.
+ * The file is read in JSON_CHUNK_SIZE pieces and fed to
+ * `bjson_enc_feed`, so RAM use is bounded by the chunk size instead of
+ * the file size. Encoder errors are logged.
  *
  * @param path Path to the file to read (e.g. "/spiffs/test.json").
- * @return Pointer to malloc'ed NUL-terminated buffer on success, or NULL.
+ * @param out Output buffer for BJSON data.
+ * @param out_max Capacity of `out` in bytes.
+ * @return Number of bytes written to `out` on success, 0 on failure.
  */
-static char *read_json_file(const char *path)
+static size_t bjson_encode_file(const char *path, uint8_t *out, size_t out_max)
 {
     FILE *fp = fopen(path, "r");
     if (!fp) {
         ESP_LOGE(TAG, "file not found: %s", path);
-        return NULL;
+        return 0;
     }
 
-    fseek(fp, 0, SEEK_END);
-    long sz = ftell(fp);
-    fseek(fp, 0, SEEK_SET);
-
-    char *buf = malloc(sz + 1);
-    fread(buf, 1, sz, fp);
+    char chunk[JSON_CHUNK_SIZE];
+    bjson_enc_stream_t st;
+    bjson_enc_opts_t opts = { .flags = BJSON_ENC_F_CRC };   // bjd_validate 로 무결성 확인
+    bjson_err_t rc = bjson_enc_begin(&st, &opts, out, out_max);
+    size_t total = 0, n;
+    while (rc == BJSON_OK && (n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        rc = bjson_enc_feed(&st, chunk, n);
+        total += n;
+    }
     fclose(fp);
-    buf[sz] = '\0';
 
-    ESP_LOGI(TAG, "Read %ld bytes from %s", sz, path);
-    return buf;
-}
-
-
-
-/**
- * @brief Encode JSON text into BJSON using the public encoder API.
- *
- * This convenience wrapper calls `bjson_encode_from_json` and logs any
- * encoder errors. The caller provides the output buffer `out` of size
- * `out_max`.
- *
- * @param json NUL-terminated JSON text to encode.
- * @param out Output buffer for BJSON data.
- * @param out_max Capacity of `out` in bytes.
- * @return Number of bytes written to `out` on success, 0 on failure.
- */
-static size_t bjson_encode_from_text(const char *json, uint8_t *out, size_t out_max)
-{
     size_t out_len = 0;
-    bjson_err_t rc = bjson_encode_from_json(json, out, out_max, &out_len);
-
+    if (rc == BJSON_OK) {
+        rc = bjson_enc_end(&st, &out_len);
+    }
     if (rc != BJSON_OK) {
         ESP_LOGE(TAG, "BJSON encode failed: %d", rc);
         return 0;
     }
+    ESP_LOGI(TAG, "Read %u bytes from %s", (unsigned)total, path);
     ESP_LOGI(TAG, "JSON To Bin encoded size = %u bytes", (unsigned)out_len);
     return out_len;
 }
@@ -120,136 +111,163 @@ static size_t bjson_encode_from_text(const char *json, uint8_t *out, size_t out_
 
 
 /**
- * @brief Read a 32-bit unsigned little-endian value from a byte pointer.
- *
- * @param p Pointer to at least 4 bytes.
- * @return Decoded 32-bit little-endian value.
- */
-static inline uint32_t rd_u32le(const uint8_t* p) {
-    return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24);
-}
-/**
- * @brief Align a pointer upwards to the next 4-byte boundary.
+ * @brief bjd_visit callback: log one entry, indented by depth.
  *
- * This is used when walking BJSON entries which are padded to 4-byte
- * alignment.
+ * Values are read with `bjd_entry_value`, so the dump accepts exactly
+ * what the getters accept and does no parsing of its own.
  *
- * @param p Input pointer.
- * @return Pointer aligned to 4 bytes at or after `p`.
+ * @param e Entry.
+ * @param depth Nesting depth (0 = top level).
+ * @param leave 1 when closing a container.
+ * @param user Unused.
+ * @return Always 0 (visit everything).
  */
-static inline const uint8_t* align4p(const uint8_t* p) {
-    uintptr_t x = (uintptr_t)p;
-    return (const uint8_t*)((x + 3) & ~(uintptr_t)3);
+static int bjson_dump_entry(const bjd_entry_t *e, uint32_t depth, int leave, void *user)
+{
+    (void)user;
+    int ind = (int)depth * 2;
+
+    // 키 안전 복사 (배열 원소는 이름 없음)
+    char key[65] = {0};
+    uint8_t nlen;
+    const char *name = bjd_entry_name(e, &nlen);  // 키 ID 는 사전 이름으로
+    size_t kcpy = nlen < sizeof(key)-1 ? nlen : sizeof(key)-1;
+    memcpy(key, name, kcpy);
+    if (!kcpy) strcpy(key, "-");
+
+    if (leave) {
+        ESP_LOGI(TAG, "%*s%c", ind, "", e->type == BJD_T_OBJ ? '}' : ']');
+        return 0;
+    }
+
+    const bjd_type_info_t *ti = bjd_type_info((uint8_t)e->type);
+    if (BJD_IS_PACKED(e->type) && bjd_type_info(BJD_ELEM_TYPE(e->type))) {
+        uint8_t w = bjd_type_info(BJD_ELEM_TYPE(e->type))->width;
+        ESP_LOGI(TAG, "%*s%s = [%" PRIu32 " x %u-byte packed]", ind, "", key, e->val_len / w, w);
+        return 0;
+    }
+    if (!ti) {
+        ESP_LOGW(TAG, "%*s%s = (unknown type %u, len=%" PRIu32 ")", ind, "", key, (unsigned)e->type, e->val_len);
+        return 0;
+    }
+
+    int64_t i; uint64_t u; double f; uint8_t b; int32_t raw; bjd_doc_t sub;
+    switch (ti->kind) {
+        case BJD_K_STR: {
+            int vlen = (e->val_len > 1024) ? 1024 : (int)e->val_len; // 로그 폭주 방지
+            ESP_LOGI(TAG, "%*s%s = \"%.*s\"", ind, "", key, vlen, (const char *)e->val);
+            break;
+        }
+        case BJD_K_INT:
+            if (bjd_entry_value(e, BJD_T_I64, &i) == 0) ESP_LOGI(TAG, "%*s%s = %" PRId64, ind, "", key, i);
+            else ESP_LOGW(TAG, "%*s%s: bad int len=%" PRIu32, ind, "", key, e->val_len);
+            break;
+        case BJD_K_UINT:
+            if (bjd_entry_value(e, BJD_T_U64, &u) == 0) ESP_LOGI(TAG, "%*s%s = %" PRIu64, ind, "", key, u);
+            else ESP_LOGW(TAG, "%*s%s: bad uint len=%" PRIu32, ind, "", key, e->val_len);
+            break;
+        case BJD_K_FLOAT:
+            if (bjd_entry_value(e, BJD_T_F64, &f) == 0) ESP_LOGI(TAG, "%*s%s = %.17g", ind, "", key, f);
+            else ESP_LOGW(TAG, "%*s%s: bad float len=%" PRIu32, ind, "", key, e->val_len);
+            break;
+        case BJD_K_BOOL:
+            if (bjd_entry_value(e, BJD_T_BOOL, &b) == 0) ESP_LOGI(TAG, "%*s%s = %s", ind, "", key, b ? "true" : "false");
+            else ESP_LOGW(TAG, "%*s%s: bad bool len=%" PRIu32, ind, "", key, e->val_len);
+            break;
+        case BJD_K_FIX: {
+            // raw / 10^scale, scale 는 키 이름에 있음 (FIX16_2_TEMP)
+            const bjd_prefix_t *pr = bjd_classify_key(name, nlen);
+            int sc = pr ? bjd_key_scale(name, nlen, pr) : -1;
+            if (sc >= 0 && bjd_entry_value(e, BJD_T_FIX32, &raw) == 0) ESP_LOGI(TAG, "%*s%s = %" PRId32 "e-%d", ind, "", key, raw, sc);
+            else ESP_LOGW(TAG, "%*s%s: bad fix len=%" PRIu32, ind, "", key, e->val_len);
+            break;
+        }
+        case BJD_K_OBJ:
+        case BJD_K_ARR:
+            if (bjd_enter(e, &sub) == BJD_OK)
+                ESP_LOGI(TAG, "%*s%s = %c (%" PRIu32 " entries)", ind, "", key, e->type == BJD_T_OBJ ? '{' : '[', sub.count);
+            break;
+        default:
+            ESP_LOGW(TAG, "%*s%s = (unknown kind %u)", ind, "", key, ti->kind);
+            break;
+    }
+    return 0;
 }
 
 /**
  * @brief Pretty-print a BJSON document to the ESP log.
  *
- * The function opens the document with `bjd_open` and iterates entries,
- * logging key/value pairs. Defensive checks are performed to avoid
- * reading beyond the buffer.
+ * Walks every entry, nested ones included, with `bjd_visit` (no
+ * allocation; unchecked once the document has been validated).
  *
- * @param data Pointer to BJSON buffer.
- * @param len Length of the buffer in bytes.
+ * @param doc Open, validated document.
  */
-static void bjson_dump_document(const uint8_t *data, size_t len)
+static void bjson_dump_document(const bjd_doc_t *doc)
 {
-    bjd_doc_t doc;
-    if (bjd_open(data, len, &doc) != BJD_OK) {
-        ESP_LOGE(TAG, "bjd_open failed");
-        return;
+    ESP_LOGI(TAG, "---- BJSON Document Dump (count=%" PRIu32 ") ----", doc->count);
+    if (bjd_visit(doc, bjson_dump_entry, NULL) < 0) {
+        ESP_LOGW(TAG, "corrupt entry; dump stopped");
     }
+    ESP_LOGI(TAG, "---- Dump End ----");
+}
 
-    const uint8_t* cur = doc.entries;
-    const uint8_t* end = doc.base + doc.len;
-
-    ESP_LOGI(TAG, "---- BJSON Document Dump (count=%" PRIu32 ") ----", doc.count);
-
-    for (uint32_t i = 0; i < doc.count; i++) {
-        // 최소 헤더 8바이트 체크: type(1) + nameLen(1) + reserved(2) + valueLen(4)
-        if ((size_t)(end - cur) < 8) {
-            ESP_LOGW(TAG, "truncated entry header at i=%" PRIu32, i);
-            break;
-        }
-
-        uint8_t  type    = cur[0];
-        uint8_t  nameLen = cur[1];
-        uint32_t valueLen= rd_u32le(cur + 4);
-        const uint8_t* name = cur + 8;
-        const uint8_t* val  = name + nameLen;
 
-        // 경계 체크
-        if (name > end || val > end || (size_t)(end - val) < valueLen) {
-            ESP_LOGW(TAG, "truncated entry payload at i=%" PRIu32, i);
-            break;
-        }
 
-        // 키 안전 복사
-        char key[65] = {0};
-        size_t kcpy = nameLen < sizeof(key)-1 ? nameLen : sizeof(key)-1;
-        memcpy(key, name, kcpy);
-        key[kcpy] = '\0';
-
-        // 값 출력
-        switch (type) {
-            case BJD_T_STR: {
-                int vlen = (valueLen > 1024) ? 1024 : (int)valueLen; // 로그 폭주 방지
-                ESP_LOGI(TAG, "%s = \"%.*s\"", key, vlen, (const char*)val);
-                break;
-            }
-            case BJD_T_I16: {
-                if (valueLen != 2) { ESP_LOGW(TAG, "%s: bad i16 len=%" PRIu32, key, valueLen); break; }
-                int16_t v = (int16_t)(val[0] | (val[1]<<8));
-                ESP_LOGI(TAG, "%s = %" PRId16, key, v);
-                break;
-            }
-            case BJD_T_U16: {
-                if (valueLen != 2) { ESP_LOGW(TAG, "%s: bad u16 len=%" PRIu32, key, valueLen); break; }
-                uint16_t v = (uint16_t)(val[0] | (val[1]<<8));
-                ESP_LOGI(TAG, "%s = %" PRIu16, key, v);
-                break;
-            }
-            case BJD_T_I32: {
-                if (valueLen != 4) { ESP_LOGW(TAG, "%s: bad i32 len=%" PRIu32, key, valueLen); break; }
-                int32_t v = (int32_t)rd_u32le(val);
-                ESP_LOGI(TAG, "%s = %" PRId32, key, v);
-                break;
-            }
-            case BJD_T_U32: {
-                if (valueLen != 4) { ESP_LOGW(TAG, "%s: bad u32 len=%" PRIu32, key, valueLen); break; }
-                uint32_t v = rd_u32le(val);
-                ESP_LOGI(TAG, "%s = %" PRIu32, key, v);
-                break;
-            }
-            default:
-                ESP_LOGW(TAG, "%s = (unknown type %u, len=%" PRIu32 ")", key, type, valueLen);
-                break;
-        }
 
-        // 다음 엔트리로 (4바이트 정렬)
-        const uint8_t* next = align4p(val + valueLen);
-        if (next <= cur) { ESP_LOGW(TAG, "pointer stall; abort"); break; }
-        cur = next;
-        if (cur > end) { ESP_LOGW(TAG, "cursor beyond end"); break; }
+/**
+ * @brief Log a BJSON document converted back to compact JSON.
+ *
+ * A size-only `bjd_to_json` call gives the exact length, so the heap
+ * buffer is allocated once and never truncated.
+ *
+ * @param doc Open document.
+ */
+static void bjson_log_json(const bjd_doc_t *doc)
+{
+    size_t len = 0;
+    if (bjd_to_json(doc, NULL, 0, &len) != BJD_EBUF) {
+        ESP_LOGE(TAG, "bjd_to_json: corrupt document");
+        return;
     }
-
-    ESP_LOGI(TAG, "---- Dump End ----");
+    char *txt = heap_caps_malloc(len, MALLOC_CAP_8BIT);
+    if (!txt) {
+        ESP_LOGE(TAG, "JSON buffer alloc failed (%u bytes)", (unsigned)len);
+        return;
+    }
+    if (bjd_to_json(doc, txt, len, &len) == BJD_OK) {
+        ESP_LOGI(TAG, "JSON (%u bytes): %.*s", (unsigned)len, (int)len, txt);
+    }
+    free(txt);
 }
 
-
-
+/**
+ * @brief Log the cost of bringing a document up (time and heap held).
+ *
+ * @param what Path name for the log.
+ * @param t0 esp_timer_get_time() when the path started.
+ * @param heap0 Free 8-bit heap when the path started.
+ */
+static void bjson_log_startup(const char *what, int64_t t0, size_t heap0)
+{
+    int64_t us = esp_timer_get_time() - t0;
+    size_t heap1 = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    ESP_LOGI(TAG, "%s: ready in %" PRId64 " us, heap held %d bytes", what, us, (int)(heap0 - heap1));
+}
 
 /**
- * @brief Encode JSON text into BJSON and dump the resulting document.
+ * @brief Encode a JSON file into BJSON at boot and dump the document.
  *
- * Allocates a temporary buffer from heap (PSRAM-aware via
- * `heap_caps_malloc`) and frees it before returning. Errors are logged
- * and cause an early return.
+ * The read-and-encode path: allocates a temporary buffer from heap
+ * (PSRAM-aware via `heap_caps_malloc`), encodes the SPIFFS file into it
+ * and frees it before returning. Errors are logged and cause an early
+ * return.
  *
- * @param json_text NUL-terminated JSON text to process.
+ * @param path Path of the JSON file to process.
  */
-static void bjson_process(const char *json_text)
+static void bjson_process(const char *path)
 {
+    size_t heap0 = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int64_t t0 = esp_timer_get_time();
 
     uint8_t *bin = heap_caps_malloc(TEST_BIN_SIZE, MALLOC_CAP_8BIT );
     if (!bin) {
@@ -257,26 +275,68 @@ static void bjson_process(const char *json_text)
         return;
     }
 
-    size_t bin_len = bjson_encode_from_text(json_text, bin, TEST_BIN_SIZE);
-    if (!bin_len) 
-      return;
+    size_t bin_len = bjson_encode_file(path, bin, TEST_BIN_SIZE);
+    if (!bin_len) {
+        free(bin);
+        return;
+    }
 
     // 바이너리를 파일로 저장하거나 네트워크 전송 가능
     // 예: fwrite(bin, 1, bin_len, fp);
 
-    bjson_dump_document(bin, bin_len);
+    bjd_doc_t doc;
+    bjd_err_t rc = bjd_open(bin, bin_len, &doc);
+    if (rc == BJD_OK) rc = bjd_validate(&doc);
+    if (rc != BJD_OK) {
+        ESP_LOGE(TAG, "bjd_open/validate failed: %d", rc);
+        free(bin);
+        return;
+    }
+    bjson_log_startup("read+encode", t0, heap0);
+
+    bjson_dump_document(&doc);
 
     free(bin);
 }
 
+/**
+ * @brief Map the precompiled BJSON image partition and dump it.
+ *
+ * The image is produced on the host by `bjsonc` at build time, so boot
+ * does no parsing and no copy: `bjd_open_mapped` maps the partition
+ * read-only and every read is served from flash.
+ *
+ * @param label Partition label of the image.
+ */
+static void bjson_process_mapped(const char *label)
+{
+    size_t heap0 = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    int64_t t0 = esp_timer_get_time();
+
+    bjd_map_t m;
+    bjd_err_t rc = bjd_open_mapped(label, 1, NULL, &m);   // bjsonc without -k: no dictionary
+    if (rc != BJD_OK) {
+        ESP_LOGE(TAG, "bjd_open_mapped(%s) failed: %d", label, rc);
+        return;
+    }
+    bjson_log_startup("mapped image", t0, heap0);
+    ESP_LOGI(TAG, "image size = %u bytes", (unsigned)m.doc.len);
+
+    bjson_dump_document(&m.doc);
+    bjson_log_json(&m.doc);
+
+    bjd_close_mapped(&m);
+}
+
 
 
 
 /**
  * @brief Application entry point for the ESP-JSON demo.
  *
- * Initializes system services, reads `/spiffs/test.json`, runs the
- * encoder/decoder demo, and cleans up.
+ * Initializes system services, then brings the same document up both
+ * ways, read-and-encode from `/spiffs/test.json` and the precompiled
+ * image in the "bjson" partition, logging startup time and heap for each.
  */
 void app_main(void)
 {
@@ -287,16 +347,8 @@ void app_main(void)
         return;
     }
 
-    char *json = read_json_file("/spiffs/test.json");
-    if (!json) {
-        ESP_LOGE(TAG, "JSON read failed");
-        return;
-    }
-
-    ESP_LOGI(TAG, "JSON content:\n%s", json);
-
-    bjson_process(json);
-    free(json);
+    bjson_process("/spiffs/test.json");
+    bjson_process_mapped(BJSON_PART_LABEL);
 
     ESP_LOGI(TAG, "=== Demo Completed ===");
 }
\ No newline at end of file